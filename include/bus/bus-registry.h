@@ -0,0 +1,93 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+
+#ifndef UNITY_INDICATOR_BUS_BUS_REGISTRY_H
+#define UNITY_INDICATOR_BUS_BUS_REGISTRY_H
+
+#include <core/signal.h>
+
+#include <gio/gio.h> // GDBusConnection, GBusType
+
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace unity {
+namespace indicator {
+namespace bus {
+
+/***
+****
+***/
+
+/**
+ * \brief The D-Bus connections and name watches shared by our components.
+ *
+ * This is built once at startup and handed to everything that talks
+ * to the bus, so nobody has to wait on their own g_bus_get() when an
+ * alarm fires and a name is only watched once no matter how many
+ * components care about its owner.
+ */
+class BusRegistry
+{
+public:
+    /**
+     * @param system_bus the system bus, or nullptr if it's unavailable
+     * @param session_bus the session bus, or nullptr if it's unavailable
+     */
+    BusRegistry(GDBusConnection* system_bus, GDBusConnection* session_bus);
+    ~BusRegistry();
+
+    GDBusConnection* system_bus() const;
+    GDBusConnection* session_bus() const;
+    GDBusConnection* bus(GBusType) const;
+
+    /**
+     * \brief Watch for a bus name's owner to change.
+     *
+     * The callback is passed the new unique name, or an empty
+     * string if the name vanished. If the name already has an
+     * owner, the callback is called right away.
+     */
+    core::Connection watch_name(GBusType bus_type,
+                                const std::string& name,
+                                std::function<void(const std::string& owner)> func);
+
+    /** \brief The name's current owner, or an empty string if it's unowned or unwatched */
+    std::string name_owner(GBusType bus_type, const std::string& name) const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl;
+
+    // we've got GDBusConnections and watch tags in here, so disable copying
+    BusRegistry(const BusRegistry&) =delete;
+    BusRegistry& operator=(const BusRegistry&) =delete;
+};
+
+/***
+****
+***/
+
+} // namespace bus
+} // namespace indicator
+} // namespace unity
+
+#endif // UNITY_INDICATOR_BUS_BUS_REGISTRY_H
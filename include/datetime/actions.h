@@ -21,6 +21,7 @@
 #define INDICATOR_DATETIME_ACTIONS_H
 
 #include <datetime/date-time.h>
+#include <datetime/day-occupancy.h>
 #include <datetime/state.h>
 
 #include <memory> // shared_ptr
@@ -63,8 +64,14 @@ protected:
 private:
     std::shared_ptr<State> m_state;
     GSimpleActionGroup* m_actions = nullptr;
+    DayOccupancy m_occupancy;
     void update_calendar_state();
 
+    // the calendar state that was last published
+    uint32_t m_calendar_days = 0;
+    int64_t m_calendar_day = 0;
+    bool m_show_week_numbers = false;
+
     // we've got raw pointers in here, so disable copying
     Actions(const Actions&) =delete;
     Actions& operator=(const Actions&) =delete;
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+
+#ifndef INDICATOR_DATETIME_ALARM_LATENCY_H
+#define INDICATOR_DATETIME_ALARM_LATENCY_H
+
+#include <datetime/appointment.h>
+#include <datetime/date-time.h>
+
+#include <array>
+#include <cstdint> // int64_t
+#include <functional>
+#include <set>
+#include <string>
+#include <utility> // std::pair
+#include <vector>
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/**
+ * \brief Traces how long it takes an alarm to go from its trigger time
+ *        to the notification being on the screen.
+ *
+ * Each stage of the chain is stamped with the monotonic clock:
+ * the wakeup timer firing, SimpleAlarmQueue requeueing, alarm_reached
+ * being emitted, and Snap bringing up the awake, sound, haptic and
+ * notification pieces. The most recent alarms' breakdowns are kept
+ * in a ring buffer, and every stage's delay relative to alarm_reached
+ * is folded into a histogram.
+ *
+ * Shortly after each alarm, a plain-text report is written to the
+ * user's cache dir so that late alarms (eg after suspend) can be
+ * diagnosed on a device without a debug build. Alarms that arrive
+ * late are also logged.
+ */
+class AlarmLatency
+{
+public:
+    enum Stage
+    {
+        WAKEUP,    // the wakeup timer fired
+        REQUEUE,   // the alarm queue started looking for due alarms
+        REACHED,   // alarm_reached is about to be emitted
+        NOTIFYING, // Snap started handling the alarm
+        AWAKE,     // the system was asked to stay awake
+        SOUND,     // the sound was started
+        HAPTIC,    // vibration was started
+        SHOWN,     // the notification server replied that it was shown
+        NUM_STAGES
+    };
+
+    struct Record
+    {
+        std::string uid;
+        DateTime alarm_time;
+        int64_t lateness_usec = 0; // wall clock, from alarm_time to REACHED
+        std::array<int64_t,NUM_STAGES> stamps {}; // monotonic usec; 0 if the stage was skipped
+    };
+
+    /** upper bounds, in msec, of the histogram buckets. The last bucket is unbounded. */
+    static constexpr int NUM_BUCKETS {11};
+    typedef std::array<unsigned int,NUM_BUCKETS> Histogram;
+
+    /**
+     * @param report_filename where to write the report after each alarm,
+     *        or an empty string to not write one
+     */
+    explicit AlarmLatency(const std::string& report_filename);
+    ~AlarmLatency();
+
+    /** \brief Where the service writes its report: the user's cache dir */
+    static std::string default_report_filename();
+
+    /**
+     * \brief Stamp a stage that happens before the alarm is known, ie WAKEUP or REQUEUE
+     *
+     * Every alarm reached after these stamps shares them, since
+     * several alarms may be due at once, but each alarm only once.
+     * The next pending stamp after that starts a new batch.
+     */
+    void mark_pending(Stage);
+
+    /** \brief Start tracing an alarm that's about to be reached */
+    void begin(const Appointment&, const Alarm&);
+
+    /** \brief Stamp a stage of the alarm being traced. A no-op if none is. */
+    void mark(Stage);
+
+    /**
+     * \brief Stamp a stage of a specific alarm, even after finish()
+     *
+     * Use this for stages that complete asynchronously, such as the
+     * notification server replying. A no-op if the alarm is neither
+     * being traced nor among the recent records.
+     */
+    void mark(const Appointment&, const Alarm&, Stage);
+
+    /** \brief Finish tracing the current alarm, update the histograms, and schedule a report */
+    void finish();
+
+    /** \brief The most recent records, oldest first */
+    std::vector<Record> records() const;
+
+    /** \brief Histogram of each stage's distance from REACHED */
+    const Histogram& histogram(Stage) const;
+
+    /** \brief Histogram of how late alarm_reached was emitted */
+    const Histogram& lateness_histogram() const;
+
+    /** \brief Include the wakeup timer's count of recent hardware wakeups in the report */
+    void set_hardware_wakeups_func(const std::function<unsigned int()>&);
+
+    static const char* stage_name(Stage);
+
+private:
+    static int bucket_for(int64_t usec);
+    static int on_report_timeout(void* gself);
+    static void log_if_late(const Record&);
+    void schedule_report();
+    void write_report() const;
+
+    static constexpr size_t MAX_RECORDS {32};
+
+    const std::string m_report_filename;
+    std::array<int64_t,NUM_STAGES> m_pending {};
+    std::set<std::pair<std::string,DateTime>> m_pending_used; // alarms that took the pending stamps
+    bool m_tracing = false;
+    Record m_current;
+    std::vector<Record> m_records;
+    size_t m_next_record = 0;
+    std::array<Histogram,NUM_STAGES> m_histograms {};
+    Histogram m_lateness {};
+    std::function<unsigned int()> m_hardware_wakeups;
+    unsigned int m_report_tag = 0;
+
+    // we've got a GSource tag in here, so disable copying
+    AlarmLatency(const AlarmLatency&) =delete;
+    AlarmLatency& operator=(const AlarmLatency&) =delete;
+};
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
+
+#endif // INDICATOR_DATETIME_ALARM_LATENCY_H
@@ -22,6 +22,7 @@
 
 #include <memory> // std::shared_ptr
 
+#include <datetime/alarm-latency.h>
 #include <datetime/alarm-queue.h>
 #include <datetime/clock.h>
 #include <datetime/planner.h>
@@ -37,11 +38,18 @@ namespace datetime {
 class SimpleAlarmQueue: public AlarmQueue
 {
 public:
+    /**
+     * @param latency traces how long each alarm takes to reach the user,
+     *        or nullptr to only keep the trace in memory
+     */
     SimpleAlarmQueue(const std::shared_ptr<Clock>& clock,
                      const std::shared_ptr<Planner>& upcoming_planner,
-                     const std::shared_ptr<WakeupTimer>& timer);
+                     const std::shared_ptr<WakeupTimer>& timer,
+                     const std::shared_ptr<AlarmLatency>& latency = nullptr);
     ~SimpleAlarmQueue();
     core::Signal<const Appointment&, const Alarm&>& alarm_reached() override;
+    core::Signal<const Appointment&, const Alarm&>& alarm_upcoming() override;
+    core::Signal<const Appointment&, const Alarm&>& alarm_withdrawn() override;
 
 private:
     class Impl;
@@ -46,6 +46,18 @@ public:
     AlarmQueue() =default;
     virtual ~AlarmQueue() =default;
     virtual core::Signal<const Appointment&, const Alarm&>& alarm_reached() =0;
+
+    /**
+     * \brief Emitted shortly before the next alarm is reached,
+     *        so that listeners can get ready for it.
+     */
+    virtual core::Signal<const Appointment&, const Alarm&>& alarm_upcoming() =0;
+
+    /**
+     * \brief Emitted when an alarm announced by alarm_upcoming()
+     *        won't be reached after all, eg because it was disabled.
+     */
+    virtual core::Signal<const Appointment&, const Alarm&>& alarm_withdrawn() =0;
 };
 
 /***
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#ifndef INDICATOR_DATETIME_APPOINTMENT_INDEX_H
+#define INDICATOR_DATETIME_APPOINTMENT_INDEX_H
+
+#include <datetime/appointment.h>
+#include <datetime/date-time.h>
+
+#include <cstdint> // int64_t
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/**
+ * \brief A read-only index of appointments for range and overlap queries.
+ *
+ * The appointments are kept sorted by begin time in an implicit
+ * interval tree: each node also records the latest end time in its
+ * subtree, so overlap queries can skip subtrees that end too soon.
+ * Overlap and "starts after" queries are O(log n + k).
+ *
+ * Appointments that span several days are also bucketed under every
+ * day that they touch, alarms are kept sorted by trigger time, and
+ * appointments can be looked up in O(1) by uid or by source.
+ *
+ * @see Planner
+ */
+class AppointmentIndex
+{
+public:
+    AppointmentIndex() =default;
+    explicit AppointmentIndex(const std::vector<Appointment>&);
+
+    /** \brief Rebuild the index from scratch */
+    void reset(const std::vector<Appointment>&);
+
+    /** \brief The indexed appointments, sorted by begin time */
+    const std::vector<Appointment>& appointments() const { return m_appointments; }
+    bool empty() const { return m_appointments.empty(); }
+
+    /** \brief Appointments overlapping the closed interval [begin..end] */
+    std::vector<Appointment> overlapping(const DateTime& begin, const DateTime& end) const;
+
+    /** \brief Appointments that haven't ended before the given time */
+    std::vector<Appointment> ending_after(const DateTime&) const;
+
+    /** \brief Appointments that begin at or after the given time */
+    std::vector<Appointment> starting_after(const DateTime&) const;
+
+    /** \brief Appointments that occupy any part of the given day */
+    std::vector<Appointment> on_day(const DateTime&) const;
+
+    /**
+     * \brief Find an appointment by its uid.
+     *
+     * Instances of a recurring event share a uid, so this
+     * returns the earliest one, or nullptr if there's no match.
+     */
+    const Appointment* find_uid(const std::string& uid) const;
+
+    /** \brief Appointments that came from the given calendar source */
+    std::vector<Appointment> from_source(const std::string& source_uid) const;
+
+    /**
+     * \brief Visit the alarms that trigger at or after the given time, soonest first.
+     *
+     * The walk stops when the visitor returns false.
+     */
+    void foreach_alarm_after(const DateTime&,
+                             const std::function<bool(const Appointment&, const Alarm&)>& visitor) const;
+
+    /** \brief Microseconds since the epoch, the index's internal time key */
+    static int64_t to_key(const DateTime&);
+
+    /** \brief A key for the date of a DateTime in its own timezone, eg 20201031 */
+    static int to_day_key(const DateTime&);
+
+    /**
+     * \brief The day keys of every day that an appointment touches.
+     *
+     * A day that starts exactly when the appointment ends
+     * (eg, the day after an all-day event) isn't touched.
+     */
+    static std::vector<int> to_day_keys(const Appointment&);
+
+private:
+    struct Node
+    {
+        int64_t begin;
+        int64_t end;
+        int64_t max_end; // latest end in this node's subtree
+    };
+
+    struct AlarmRef
+    {
+        int64_t time;
+        size_t appointment;
+        size_t alarm;
+    };
+
+    void build_tree();
+    void query(int64_t begin, int64_t end, std::vector<size_t>& setme) const;
+    std::vector<Appointment> collect(const std::vector<size_t>&) const;
+
+    std::vector<Appointment> m_appointments;
+    std::vector<Node> m_nodes;
+    int m_max_level = -1;
+    std::map<int,std::vector<size_t>> m_days;
+    std::vector<AlarmRef> m_alarms;
+    std::unordered_map<std::string,size_t> m_uids;
+    std::unordered_map<std::string,std::vector<size_t>> m_sources;
+};
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
+
+#endif // INDICATOR_DATETIME_APPOINTMENT_INDEX_H
@@ -63,6 +63,10 @@ public:
     DateTime begin;
     DateTime end;
 
+    // true if begin and end are floating or all-day times,
+    // ie they're resolved in whatever timezone is the default
+    bool floating = false;
+
     std::vector<Alarm> alarms;
 
     bool operator== (const Appointment& that) const;
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#ifndef INDICATOR_DATETIME_ARENA_H
+#define INDICATOR_DATETIME_ARENA_H
+
+#include <cstddef> // size_t, ptrdiff_t
+#include <functional> // std::less
+#include <map>
+#include <new>
+#include <set>
+#include <utility> // std::pair
+#include <vector>
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/**
+ * \brief A monotonic allocator for short-lived scratch data.
+ *
+ * Allocations are carved out of large blocks and are never freed one
+ * at a time; the whole arena is released at once when it's destroyed.
+ * This suits work like an EDS query, which builds lots of temporary
+ * containers that all die together when the query finishes.
+ *
+ * Not thread-safe.
+ *
+ * @see ArenaAllocator
+ */
+class Arena
+{
+public:
+    explicit Arena(size_t block_size=DEFAULT_BLOCK_SIZE);
+    ~Arena();
+
+    void* allocate(size_t n, size_t alignment);
+
+    /** \brief Bytes handed out so far */
+    size_t bytes_used() const { return m_bytes_used; }
+
+    /** \brief Bytes reserved from the heap so far */
+    size_t bytes_reserved() const { return m_bytes_reserved; }
+
+    static constexpr size_t DEFAULT_BLOCK_SIZE {16*1024};
+
+private:
+    struct Block
+    {
+        Block* next;
+    };
+    char* add_block(size_t size);
+
+    const size_t m_block_size;
+    Block* m_blocks = nullptr;
+    char* m_pos = nullptr;
+    char* m_end = nullptr;
+    size_t m_bytes_used = 0;
+    size_t m_bytes_reserved = 0;
+
+    // we own the blocks, so disable copying
+    Arena(const Arena&) =delete;
+    Arena& operator=(const Arena&) =delete;
+};
+
+/**
+ * \brief A standard allocator that draws from an #Arena.
+ *
+ * deallocate() is a no-op, so containers using this must not outlive the arena.
+ */
+template<typename T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template<typename U> struct rebind { typedef ArenaAllocator<U> other; };
+
+    explicit ArenaAllocator(Arena& arena) noexcept: m_arena(&arena) {}
+
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& that) noexcept: m_arena(that.arena()) {}
+
+    T* allocate(size_t n, const void* /*hint*/=nullptr) {
+        return static_cast<T*>(m_arena->allocate(n*sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) noexcept {}
+
+    size_t max_size() const noexcept { return size_t(-1) / sizeof(T); }
+
+    template<typename U, typename... Args>
+    void construct(U* p, Args&&... args) { ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...); }
+
+    template<typename U>
+    void destroy(U* p) { p->~U(); }
+
+    Arena* arena() const noexcept { return m_arena; }
+
+private:
+    Arena* m_arena;
+};
+
+template<typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena() == b.arena(); }
+
+template<typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena() != b.arena(); }
+
+template<typename T>
+using ArenaVector = std::vector<T,ArenaAllocator<T>>;
+
+template<typename K, typename V, typename Compare=std::less<K>>
+using ArenaMap = std::map<K,V,Compare,ArenaAllocator<std::pair<const K,V>>>;
+
+template<typename K, typename Compare=std::less<K>>
+using ArenaSet = std::set<K,Compare,ArenaAllocator<K>>;
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
+
+#endif // INDICATOR_DATETIME_ARENA_H
@@ -22,6 +22,8 @@
 
 #include <datetime/date-time.h>
 
+#include <bus/bus-registry.h>
+
 #include <core/property.h>
 #include <core/signal.h>
 
@@ -46,8 +48,21 @@ public:
     /** \brief A signal which fires when the clock's date changes */
     core::Signal<> date_changed;
 
+    /** \brief False while the display is off, as reported by Unity.Screen */
+    core::Property<bool> display_on {true};
+
+    /**
+     * \brief Whether anyone is subscribed to a menu that shows the time.
+     *
+     * Set by whoever exports the menus. If the display is off or no one
+     * is watching, a LiveClock stops its minute ticks and only wakes for
+     * date changes. It catches up when someone is watching again.
+     */
+    core::Property<bool> has_viewers {true};
+
 protected:
     Clock();
+    explicit Clock(const std::shared_ptr<unity::indicator::bus::BusRegistry>& buses);
 
     /** \brief Compares old and new times, emits minute_changed() or date_changed() signals if appropriate */
     void maybe_emit (const DateTime& a, const DateTime& b);
@@ -74,7 +89,8 @@ class Timezone;
 class LiveClock: public Clock
 {
 public:
-    LiveClock (const std::shared_ptr<const Timezone>& zones);
+    explicit LiveClock (const std::shared_ptr<const Timezone>& zones,
+                        const std::shared_ptr<unity::indicator::bus::BusRegistry>& buses = nullptr);
     virtual ~LiveClock();
     virtual DateTime localtime() const override;
 
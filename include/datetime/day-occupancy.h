@@ -0,0 +1,79 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+
+#ifndef INDICATOR_DATETIME_DAY_OCCUPANCY_H
+#define INDICATOR_DATETIME_DAY_OCCUPANCY_H
+
+#include <datetime/appointment.h>
+#include <datetime/date-time.h>
+
+#include <cstdint> // int64_t, uint32_t
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/**
+ * \brief Counts how many appointments occupy each day.
+ *
+ * Every day that an appointment touches is counted, so multi-day
+ * events occupy all of their days rather than just the first one.
+ *
+ * When a planner delivers a new set of appointments, only the
+ * appointments that were added or removed since the last set
+ * touch the counts, and any month's days can be read in O(days).
+ */
+class DayOccupancy
+{
+public:
+    /** \brief Update the counts to reflect a new set of appointments */
+    void set(const std::vector<Appointment>&);
+
+    /** \brief How many appointments occupy the given day */
+    int count(const DateTime& day) const;
+
+    /** \brief A bitmap of the given month's occupied days; bit N is day-of-month N */
+    uint32_t month_bitmap(const DateTime& month) const;
+
+private:
+    // source uid, uid, begin, end
+    typedef std::tuple<std::string,std::string,int64_t,int64_t> Key;
+
+    struct Entry
+    {
+        int refs;
+        std::vector<int> days;
+    };
+
+    void adjust(const std::vector<int>& days, int delta);
+
+    std::map<Key,Entry> m_entries;
+    std::map<int,int> m_counts;
+};
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
+
+#endif // INDICATOR_DATETIME_DAY_OCCUPANCY_H
@@ -46,14 +46,26 @@ class Myself;
 class EdsEngine: public Engine
 {
 public:
-    EdsEngine(const std::shared_ptr<Myself> &myself);
+    /**
+     * @param threaded if true, the fetched components are converted into
+     *        appointments on a worker pool. Otherwise the conversion runs
+     *        on the main loop in short idle slices, for when the main loop
+     *        must stay the only execution context. The service itself
+     *        always uses the worker pool.
+     */
+    EdsEngine(const std::shared_ptr<Myself> &myself, bool threaded=true);
     ~EdsEngine();
 
     void get_appointments(const DateTime& begin,
                           const DateTime& end,
                           const Timezone& default_timezone,
                           std::function<void(const std::vector<Appointment>&)> appointment_func) override;
+    void get_alarms(const DateTime& begin,
+                    const DateTime& end,
+                    const Timezone& default_timezone,
+                    std::function<void(const std::vector<Appointment>&)> appointment_func) override;
     void disable_ubuntu_alarm(const Appointment&) override;
+    void disable_ubuntu_alarms(const std::vector<Appointment>&) override;
 
     core::Signal<>& changed() override;
 
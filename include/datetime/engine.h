@@ -50,8 +50,34 @@ public:
                                   const DateTime& end,
                                   const Timezone& default_timezone,
                                   std::function<void(const std::vector<Appointment>&)> appointment_func) =0;
+
+    /**
+     * \brief Like get_appointments(), but only the appointments that have alarms.
+     *
+     * This is all the alarm queue needs, so engines that can
+     * skip the other appointments cheaply should override it.
+     */
+    virtual void get_alarms(const DateTime& begin,
+                            const DateTime& end,
+                            const Timezone& default_timezone,
+                            std::function<void(const std::vector<Appointment>&)> appointment_func) {
+        get_appointments(begin, end, default_timezone, [appointment_func](const std::vector<Appointment>& appointments){
+            std::vector<Appointment> alarms;
+            for (const auto& appointment : appointments)
+                if (!appointment.alarms.empty())
+                    alarms.push_back(appointment);
+            appointment_func(alarms);
+        });
+    }
+
     virtual void disable_ubuntu_alarm(const Appointment&) =0;
 
+    /** \brief Disable several one-time alarms at once */
+    virtual void disable_ubuntu_alarms(const std::vector<Appointment>& appointments) {
+        for (const auto& appointment : appointments)
+            disable_ubuntu_alarm(appointment);
+    }
+
     virtual core::Signal<>& changed() =0;
 
 protected:
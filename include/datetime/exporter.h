@@ -24,6 +24,7 @@
 #include <datetime/menu.h>
 #include <datetime/settings.h>
 
+#include <core/property.h>
 #include <core/signal.h>
 
 #include <memory> // std::shared_ptr
@@ -39,6 +40,8 @@ namespace datetime {
 class Exporter
 {
 public:
+    static constexpr unsigned int DEFAULT_SUSPEND_DELAY_MSEC {10000};
+
     explicit Exporter(const std::shared_ptr<Settings>&);
     ~Exporter();
 
@@ -47,6 +50,28 @@ public:
     void publish(const std::shared_ptr<Actions>& actions,
                  const std::vector<std::shared_ptr<Menu>>& menus);
 
+    /**
+     * \brief Publish every profile's menu, but only build the ones in use.
+     *
+     * Each profile's menu path is exported right away, but its Menu
+     * isn't built until a client subscribes to it. When the last
+     * subscriber leaves, the Menu is destroyed after a grace period
+     * so that profiles nobody watches cost no rebuilds or timers.
+     */
+    void publish(const std::shared_ptr<Actions>& actions,
+                 const std::shared_ptr<MenuFactory>& factory,
+                 unsigned int suspend_delay_msec=DEFAULT_SUSPEND_DELAY_MSEC);
+
+    /** \brief The profile's Menu, or nullptr if it's not instantiated */
+    std::shared_ptr<Menu> active_menu(Menu::Profile) const;
+
+    /**
+     * \brief Whether any client is subscribed to one of the menus.
+     *
+     * This is always true for menus published eagerly.
+     */
+    const core::Property<bool>& has_subscribers() const;
+
 private:
     class Impl;
     std::unique_ptr<Impl> p;
@@ -31,6 +31,7 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace unity {
 namespace indicator {
@@ -111,6 +112,7 @@ public:
 
 private:
     std::shared_ptr<const Settings> m_settings;
+    std::vector<core::ScopedConnection> m_connections;
 
     void rebuildHeaderFormat();
     const gchar* getFullTimeFormatString() const;
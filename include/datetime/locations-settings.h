@@ -41,11 +41,25 @@ public:
      */
     SettingsLocations (const std::shared_ptr<const Settings>& settings,
                        const std::shared_ptr<const Timezones>& timezones);
+    ~SettingsLocations();
 
 private:
     std::shared_ptr<const Settings> m_settings;
     std::shared_ptr<const Timezones> m_timezones;
+    std::vector<core::ScopedConnection> m_connections;
     void reload();
+
+    // reload when the next location's UTC offset changes
+    // or when someone sets the wall clock
+    void restart_transition_timer();
+    void unset_transition_timer();
+    static gboolean on_transition_timer(gint fd, GIOCondition, gpointer gself);
+    int m_transition_fd = -1;
+    guint m_transition_tag = 0;
+
+    // we've got a timerfd and GSource tag here, so disable copying
+    SettingsLocations(const SettingsLocations&) =delete;
+    SettingsLocations& operator=(const SettingsLocations&) =delete;
 };
 
 } // namespace datetime
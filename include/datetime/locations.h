@@ -42,6 +42,13 @@ public:
     Location (const std::string& zone, const std::string& name);
     const std::string& zone() const;
     const std::string& name() const;
+
+    /** \brief offset from UTC in microseconds */
+    int64_t offset() const;
+
+    /** \brief unix time of the next change to offset(), or 0 if none is known */
+    int64_t next_transition() const;
+
     bool operator== (const Location& that) const;
 
 private:
@@ -54,6 +61,9 @@ private:
 
     /** offset from UTC in microseconds */
     int64_t m_offset = 0;
+
+    /** unix time when m_offset will next change, eg at a DST boundary */
+    int64_t m_next_transition = 0;
 };
 
 /**
@@ -25,6 +25,7 @@
 #include <datetime/state.h>
 
 #include <memory> // std::shared_ptr
+#include <string>
 #include <vector>
 
 #include <gio/gio.h> // GMenuModel
@@ -46,8 +47,23 @@ public:
     enum Section { Calendar, Appointments, Locations, Settings, NUM_SECTIONS };
     const std::string& name() const;
     Profile profile() const;
+
+    /** \brief The name of a profile's menu, eg "desktop" */
+    static std::string profile_name(Profile);
     GMenuModel* menu_model();
 
+    /**
+     * \brief Counters for the section and header rebuilds.
+     *
+     * Changes are batched and flushed when the main loop goes idle,
+     * so several changes to the same section cost a single rebuild.
+     * A rebuild request that was folded into one already pending
+     * counts as coalesced; one that reached the exported menu
+     * or header action counts as emitted.
+     */
+    unsigned int rebuilds_emitted() const;
+    unsigned int rebuilds_coalesced() const;
+
     static std::vector<Appointment> get_display_appointments(
         const std::vector<Appointment>&,
         const DateTime& start,
@@ -57,6 +73,8 @@ protected:
     Menu (Profile profile_in, const std::string& name_in);
     virtual ~Menu() =default;
     GMenu* m_menu = nullptr;
+    unsigned int m_rebuilds_emitted = 0;
+    unsigned int m_rebuilds_coalesced = 0;
 
 private:
     const Profile m_profile;
@@ -22,6 +22,7 @@
 
 #include <core/property.h>
 
+#include <map>
 #include <string>
 #include <set>
 #include <memory.h>
@@ -37,8 +38,9 @@ class Myself
 {
 public:
      Myself();
+     virtual ~Myself() =default;
 
-     const core::Property<std::set<std::string>>& emails()
+     virtual const core::Property<std::set<std::string>>& emails()
      {
          return m_emails;
      }
@@ -47,10 +49,14 @@ public:
 
 private:
      std::shared_ptr<AgManager> m_accounts_manager;
+     std::map<guint,std::string> m_account_emails;
      core::Property<std::set<std::string> > m_emails;
 
      static void on_accounts_changed(AgManager*, guint, Myself*);
+     static void on_account_deleted(AgManager*, guint, Myself*);
      void reloadEmails();
+     void reloadAccount(guint account_id);
+     void publishEmails();
 
 };
 
@@ -39,6 +39,7 @@ public:
     void add(const std::shared_ptr<Planner>&);
 
     core::Property<std::vector<Appointment>>& appointments() override;
+    const AppointmentIndex& index() override;
 
 protected:
     class Impl;
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#ifndef INDICATOR_DATETIME_PLANNER_ALARMS_H
+#define INDICATOR_DATETIME_PLANNER_ALARMS_H
+
+#include <datetime/planner.h>
+
+#include <datetime/clock.h>
+#include <datetime/date-time.h>
+#include <datetime/engine.h>
+#include <datetime/timezone.h>
+
+#include <memory> // std::shared_ptr
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/**
+ * \brief A #Planner that holds just the next few alarms, for the alarm queue
+ *
+ * It only asks the #Engine for appointments that have alarms, starting
+ * at date() and looking ahead over a horizon that doubles until it holds
+ * MIN_ALARMS pending alarms or reaches MAX_HORIZON_DAYS. The horizon that
+ * worked is reused for the next fetch, and shrinks if it held far more
+ * alarms than needed, but never below the furthest that any alarm seen
+ * so far has triggered ahead of its appointment.
+ *
+ * @see SimpleAlarmQueue
+ */
+class AlarmPlanner: public Planner
+{
+public:
+    AlarmPlanner(const std::shared_ptr<Engine>& engine,
+                 const std::shared_ptr<Timezone>& timezone,
+                 const std::shared_ptr<Clock>& clock);
+    ~AlarmPlanner();
+
+    core::Property<std::vector<Appointment>>& appointments() override;
+    const AppointmentIndex& index() override;
+    core::Property<DateTime>& date();
+
+    /** \brief Look further ahead if too few alarms are still pending, eg after one triggers */
+    void refill();
+
+    /** \brief How many days past date() the planner currently looks */
+    int horizon_days() const { return m_horizon_days; }
+
+    static constexpr int MIN_ALARMS {3};
+    static constexpr int MIN_HORIZON_DAYS {1};
+    static constexpr int MAX_HORIZON_DAYS {366};
+
+private:
+    void rebuild_soon();
+    void rebuild_now();
+    static gboolean rebuild_now_static(gpointer);
+    void on_alarms_fetched(int horizon_days, const std::vector<Appointment>&);
+    int count_pending(const std::vector<Appointment>&) const;
+    void update_min_horizon(const std::vector<Appointment>&);
+    bool grow();
+
+    std::shared_ptr<Engine> m_engine;
+    std::shared_ptr<Timezone> m_timezone;
+    std::shared_ptr<Clock> m_clock;
+    core::Property<DateTime> m_date;
+    core::Property<std::vector<Appointment>> m_appointments;
+    AppointmentIndex m_index;
+    int m_horizon_days {7};
+    int m_min_horizon_days {MIN_HORIZON_DAYS}; // enough to reach past the earliest-triggering alarms
+    guint m_rebuild_tag = 0;
+    bool m_fetching = false;
+    bool m_refetch = false; // a rebuild was requested while fetching
+
+    // we've got a GSignal tag here, so disable copying
+    AlarmPlanner(const AlarmPlanner&) =delete;
+    AlarmPlanner& operator=(const AlarmPlanner&) =delete;
+};
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
+
+#endif // INDICATOR_DATETIME_PLANNER_ALARMS_H
@@ -42,6 +42,7 @@ public:
     ~MonthPlanner() =default;
 
     core::Property<std::vector<Appointment>>& appointments();
+    const AppointmentIndex& index();
     core::Property<DateTime>& month();
 
 private:
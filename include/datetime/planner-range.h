@@ -47,6 +47,10 @@ protected:
 /**
  * \brief A #RangePlanner that uses an #Engine to generate appointments
  *
+ * When the range slides forward, eg when an #UpcomingPlanner's date
+ * rolls over at midnight, the appointments that are over are dropped
+ * and only the newly-added part of the range is fetched.
+ *
  * @see Planner
  */
 class SimpleRangePlanner: public RangePlanner
@@ -57,6 +61,7 @@ public:
     virtual ~SimpleRangePlanner();
 
     core::Property<std::vector<Appointment>>& appointments();
+    const AppointmentIndex& index();
     core::Property<std::pair<DateTime,DateTime>>& range();
 
 private:
@@ -66,10 +71,30 @@ private:
     static gboolean rebuild_now_static(gpointer);
     guint m_rebuild_tag = 0;
 
+    // when the timezone changes, move the times we have into the new zone
+    // and only go back to the engine if there are floating times to resolve
+    void reproject(const std::string& zone);
+    static bool project(std::vector<Appointment>&, const std::string& zone);
+
+    // when the range slides forward, keep what we have and
+    // only ask the engine for the part that's new
+    void invalidate();
+    void on_appointments_fetched(const std::pair<DateTime,DateTime>& range,
+                                 bool sliding,
+                                 unsigned generation,
+                                 const std::string& zone,
+                                 const std::vector<Appointment>&);
+    std::pair<DateTime,DateTime> m_fetched; // the range m_appointments covers
+    bool m_fetched_valid = false;
+    unsigned m_generation = 0; // bumped when m_appointments goes stale
+    bool m_fetching = false;
+    bool m_refetch = false; // a rebuild was requested while fetching
+
     std::shared_ptr<Engine> m_engine;
     std::shared_ptr<Timezone> m_timezone;
     core::Property<std::pair<DateTime,DateTime>> m_range;
     core::Property<std::vector<Appointment>> m_appointments;
+    AppointmentIndex m_index;
 
     // we've got a GSignal tag here, so disable copying
     explicit SimpleRangePlanner(const RangePlanner&) =delete;
@@ -40,6 +40,7 @@ public:
                   const std::shared_ptr<Clock>&);
     ~SnoozePlanner();
     core::Property<std::vector<Appointment>>& appointments() override;
+    const AppointmentIndex& index() override;
     void add(const Appointment&, const Alarm&);
 
 protected:
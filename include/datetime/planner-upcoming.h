@@ -42,6 +42,7 @@ public:
     ~UpcomingPlanner() =default;
 
     core::Property<std::vector<Appointment>>& appointments();
+    const AppointmentIndex& index();
     core::Property<DateTime>& date();
 
 private:
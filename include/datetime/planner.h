@@ -21,6 +21,7 @@
 #define INDICATOR_DATETIME_PLANNER_H
 
 #include <datetime/appointment.h>
+#include <datetime/appointment-index.h>
 #include <datetime/date-time.h>
 
 #include <core/property.h>
@@ -40,6 +41,11 @@ public:
     virtual ~Planner();
     virtual core::Property<std::vector<Appointment>>& appointments() =0;
 
+    /** \brief An index of appointments() for range and overlap queries.
+               It's refreshed before appointments().changed() reaches
+               anyone outside the planner. */
+    virtual const AppointmentIndex& index() =0;
+
 protected:
     Planner();
     static void sort(std::vector<Appointment>&);
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#ifndef INDICATOR_DATETIME_RECURRENCE_CACHE_H
+#define INDICATOR_DATETIME_RECURRENCE_CACHE_H
+
+#include <libical/ical.h>
+
+#include <cstdint> // int64_t
+#include <ctime> // time_t
+#include <functional>
+#include <map>
+#include <memory> // std::unique_ptr
+#include <string>
+#include <vector>
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/**
+ * \brief Expands recurring calendar components and remembers the results.
+ *
+ * Each series keeps its icalrecur_iterators alive along with the
+ * occurrences that they've already produced, so asking for a later
+ * window only iterates the new occurrences instead of walking the
+ * series from its DTSTART again. RDATEs are merged in and EXDATEs are
+ * dropped as the series is walked.
+ *
+ * Occurrences before the earliest of the last few windows are dropped,
+ * so asking for a window before that walks the series again.
+ *
+ * A series is re-expanded from scratch if its component changes, as told
+ * by its SEQUENCE and LAST-MODIFIED. Series that end before the window,
+ * by UNTIL or by running out their COUNT, are skipped without walking.
+ * Detached instances (RECURRENCE-ID overrides) aren't handled here;
+ * callers replace the matching occurrences themselves.
+ *
+ * @see EdsEngine
+ */
+class RecurrenceCache
+{
+public:
+    RecurrenceCache();
+    ~RecurrenceCache();
+
+    /** \brief One occurrence of a series, in the wall-clock time of its DTSTART */
+    struct Occurrence
+    {
+        struct icaltimetype begin;
+        struct icaltimetype end;
+    };
+
+    /**
+     * \brief Get the occurrences of a series that overlap [begin..end).
+     *
+     * @param source_uid the calendar source that the series came from
+     * @param master the series' master component
+     * @param zone the zone that DTSTART is in. For floating times,
+     *        this is the zone they're being shown in.
+     * @param begin the start of the window, in unix time
+     * @param end the end of the window, in unix time
+     */
+    std::vector<Occurrence> occurrences(const std::string& source_uid,
+                                        icalcomponent* master,
+                                        icaltimezone* zone,
+                                        time_t begin,
+                                        time_t end);
+
+    /** \brief Forget every series from a source whose uid fails the test */
+    void retain(const std::string& source_uid, const std::function<bool(const std::string& uid)>& keep);
+
+    /** \brief Forget every series from a source */
+    void clear(const std::string& source_uid);
+
+    /** \brief True if the component has an RRULE or RDATE */
+    static bool is_recurring(icalcomponent*);
+
+    /**
+     * \brief True if every RRULE has an UNTIL and the series ends before t.
+     *
+     * This is a cheap test that doesn't walk the rules, so a series
+     * that ends by COUNT isn't caught here. occurrences() skips those
+     * once it's walked them to the end.
+     */
+    static bool ends_before(icalcomponent* master, time_t t);
+
+private:
+    struct Series;
+    static std::unique_ptr<Series> create_series(icalcomponent* master, icaltimezone* zone);
+
+    std::map<std::string,std::map<std::string,std::unique_ptr<Series>>> m_sources;
+
+    // we own icalrecur_iterators, so disable copying
+    RecurrenceCache(const RecurrenceCache&) =delete;
+    RecurrenceCache& operator=(const RecurrenceCache&) =delete;
+};
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
+
+#endif // INDICATOR_DATETIME_RECURRENCE_CACHE_H
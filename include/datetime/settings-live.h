@@ -30,6 +30,10 @@ namespace datetime {
 
 /**
  * \brief #Settings implementation which uses GSettings.
+ *
+ * Each GSettings change-event batch is applied as a single
+ * Settings::Transaction, so a batch of changed keys only
+ * triggers one changed_keys emission.
  */
 class LiveSettings: public Settings
 {
@@ -38,13 +42,14 @@ public:
     virtual ~LiveSettings();
 
 private:
-    static void on_changed_ccid(GSettings*, gchar*, gpointer);
-    static void on_changed_cal_notification(GSettings*, gchar*, gpointer);
-    static void on_changed_general_notification(GSettings*, gchar*, gpointer);
+    static gboolean on_change_event(GSettings*, gpointer, gint, gpointer);
+    void update_keys(GSettings*, const GQuark* keys, int n_keys);
     void update_key_ccid(const std::string& key);
     void update_key_cal_notification(const std::string& key);
     void update_key_general_notification(const std::string& key);
 
+    void update_all();
+
     void update_custom_time_format();
     void update_locations();
     void update_show_calendar();
@@ -23,7 +23,10 @@
 #include <datetime/settings-shared.h>
 
 #include <core/property.h>
+#include <core/signal.h>
 
+#include <set>
+#include <string>
 #include <vector>
 
 namespace unity {
@@ -39,7 +42,7 @@ namespace datetime {
 class Settings 
 {
 public:
-    Settings() =default;
+    Settings();
     virtual ~Settings() =default;
 
     core::Property<std::string> custom_time_format;
@@ -68,6 +71,40 @@ public:
     core::Property<bool> cal_notification_bubbles;
     core::Property<bool> cal_notification_list;
     core::Property<bool> vibrate_silent_mode;
+
+    /**
+     * \brief Emitted once per batch of changes with the keys that changed.
+     *
+     * Each property still emits its own changed() signal, but listeners
+     * that depend on several keys should use this instead so that a
+     * batch of changes costs them a single rebuild.
+     * The keys are the GSettings key names, eg SETTINGS_SHOW_DAY_S.
+     */
+    core::Signal<const std::set<std::string>&> changed_keys;
+
+    /**
+     * \brief Collects property changes into a single changed_keys emission.
+     *
+     * Transactions nest; changed_keys is emitted when the outermost one ends.
+     */
+    class Transaction
+    {
+    public:
+        explicit Transaction(Settings&);
+        ~Transaction();
+
+    private:
+        Settings& m_settings;
+        Transaction(const Transaction&) =delete;
+        Transaction& operator=(const Transaction&) =delete;
+    };
+
+private:
+    void on_key_changed(const char* key);
+    void flush_changed_keys();
+
+    int m_transaction_depth = 0;
+    std::set<std::string> m_changed_keys;
 };
 
 } // namespace datetime
@@ -20,14 +20,14 @@
 #ifndef INDICATOR_DATETIME_SNAP_H
 #define INDICATOR_DATETIME_SNAP_H
 
+#include <datetime/alarm-latency.h>
 #include <datetime/appointment.h>
 #include <datetime/settings.h>
 
+#include <bus/bus-registry.h>
 #include <notifications/notifications.h>
 #include <notifications/sound.h>
 
-#include <gio/gio.h> // GDBusConnection
-
 #include <functional>
 #include <memory>
 
@@ -44,7 +44,8 @@ public:
     Snap(const std::shared_ptr<unity::indicator::notifications::Engine>& engine,
          const std::shared_ptr<unity::indicator::notifications::SoundBuilder>& sound_builder,
          const std::shared_ptr<const Settings>& settings,
-         GDBusConnection* system_bus);
+         const std::shared_ptr<unity::indicator::bus::BusRegistry>& buses,
+         const std::shared_ptr<AlarmLatency>& latency = nullptr);
     virtual ~Snap();
 
     enum class Response { None, Snooze, ShowApp };
@@ -53,6 +54,14 @@ public:
                     const Alarm& alarm,
                     response_func on_response);
 
+    /** \brief Get ready to show an appointment's alarm that will be reached soon */
+    void prepare(const Appointment& appointment,
+                 const Alarm& alarm);
+
+    /** \brief Let go of what prepare() set up for an alarm that won't be reached */
+    void unprepare(const Appointment& appointment,
+                   const Alarm& alarm);
+
 private:
     class Impl;
     std::unique_ptr<Impl> impl;
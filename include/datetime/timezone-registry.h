@@ -0,0 +1,92 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#ifndef INDICATOR_DATETIME_TIMEZONE_REGISTRY_H
+#define INDICATOR_DATETIME_TIMEZONE_REGISTRY_H
+
+#include <core/signal.h>
+
+#include <glib.h> // GTimeZone
+
+#include <cstdint> // int64_t
+#include <memory> // std::shared_ptr, std::unique_ptr
+#include <string>
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/**
+ * \brief Process-wide cache of parsed GTimeZones.
+ *
+ * g_time_zone_new() reads and parses the tzfile from disk, so rather
+ * than building a new GTimeZone every time we convert a DateTime,
+ * everyone shares the zones interned here. Each zone also keeps a
+ * lazily-built table of its upcoming UTC offset transitions.
+ *
+ * The registry is flushed when /etc/localtime or the tzdata changes.
+ *
+ * The lookups and clear() are safe to call from any thread.
+ * The file monitors run in the default main context, so changed()
+ * is emitted from whichever thread iterates that context.
+ */
+class TimezoneRegistry
+{
+public:
+    static TimezoneRegistry& instance();
+
+    /** \brief Get the named zone, eg "America/Chicago" */
+    std::shared_ptr<GTimeZone> get(const std::string& zone);
+
+    /** \brief Get the system's local zone */
+    std::shared_ptr<GTimeZone> get_local();
+
+    /**
+     * \brief Find the zone's next UTC offset change after a given time.
+     *
+     * @param zone the zone name, eg "America/Chicago"
+     * @param after the unix time to search after
+     * @return the unix time of the next transition, or 0 if the zone
+     *         has no transitions in the year following @after
+     */
+    int64_t next_transition(const std::string& zone, int64_t after);
+
+    /** \brief Drop all cached zones */
+    void clear();
+
+    /** \brief Emitted after the registry is flushed due to a tzdata change */
+    core::Signal<>& changed();
+
+    ~TimezoneRegistry();
+
+private:
+    TimezoneRegistry();
+    class Impl;
+    std::unique_ptr<Impl> impl;
+
+    // we've got GFileMonitors in here, so disable copying
+    TimezoneRegistry(const TimezoneRegistry&) =delete;
+    TimezoneRegistry& operator=(const TimezoneRegistry&) =delete;
+};
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
+
+#endif // INDICATOR_DATETIME_TIMEZONE_REGISTRY_H
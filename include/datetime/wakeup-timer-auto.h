@@ -0,0 +1,78 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#ifndef INDICATOR_DATETIME_WAKEUP_TIMER_AUTO_H
+#define INDICATOR_DATETIME_WAKEUP_TIMER_AUTO_H
+
+#include <datetime/clock.h>
+#include <datetime/wakeup-timer.h>
+
+#include <bus/bus-registry.h>
+
+#include <memory> // std::unique_ptr, std::shared_ptr
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****
+***/
+
+/**
+ * \brief a WakeupTimer that uses powerd if it's available
+ *
+ * Asking the bus whether powerd is running or activatable would block
+ * startup, so this starts out with a fallback timer and switches to a
+ * PowerdWakeupTimer as soon as the bus registry sees powerd's name
+ * get an owner or an async ListActivatableNames call finds it.
+ * The pending wakeup time is carried over to the new timer.
+ */
+class AutoWakeupTimer: public WakeupTimer
+{
+public:
+    AutoWakeupTimer(const std::shared_ptr<Clock>&,
+                    const std::shared_ptr<unity::indicator::bus::BusRegistry>&,
+                    const std::shared_ptr<WakeupTimer>& fallback);
+    ~AutoWakeupTimer();
+    void set_wakeup_time(const DateTime&) override;
+    core::Signal<>& timeout() override;
+
+    /** \brief True once we've switched over to powerd */
+    bool uses_powerd() const;
+
+    /** \brief How many times powerd woke the hardware for us in the last 24 hours */
+    unsigned int hardware_wakeups_per_day() const;
+
+private:
+    AutoWakeupTimer(const AutoWakeupTimer&) =delete;
+    AutoWakeupTimer& operator=(const AutoWakeupTimer&) =delete;
+    class Impl;
+    std::unique_ptr<Impl> p;
+};
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
+
+#endif // INDICATOR_DATETIME_WAKEUP_TIMER_AUTO_H
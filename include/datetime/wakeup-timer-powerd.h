@@ -23,6 +23,8 @@
 #include <datetime/clock.h>
 #include <datetime/wakeup-timer.h>
 
+#include <bus/bus-registry.h>
+
 #include <memory> // std::unique_ptr, std::shared_ptr
 
 namespace unity {
@@ -34,16 +36,31 @@ namespace datetime {
 ***/
 
 /**
- * \brief a WakeupTimer implemented with g_timeout_add() 
+ * \brief a WakeupTimer implemented with powerd's hardware wakeups
+ *
+ * Asking for the time that's already been requested is a no-op, and
+ * a new cookie is in hand before the old one is cleared so there's
+ * never a window without a wakeup.
+ *
+ * Wakeup times that fall within a slack after a hardware wakeup that's
+ * already pending, or right after one fired, share that wakeup: the
+ * system is kept awake until the later time instead of being woken twice.
  */
 class PowerdWakeupTimer: public WakeupTimer
 {
 public:
-    explicit PowerdWakeupTimer(const std::shared_ptr<Clock>&);
+    static constexpr int DEFAULT_SLACK_SECONDS {60};
+
+    PowerdWakeupTimer(const std::shared_ptr<Clock>&,
+                      const std::shared_ptr<unity::indicator::bus::BusRegistry>&,
+                      int slack_seconds=DEFAULT_SLACK_SECONDS);
     ~PowerdWakeupTimer();
     void set_wakeup_time(const DateTime&) override;
     core::Signal<>& timeout() override;
 
+    /** \brief How many times this timer woke the hardware in the last 24 hours */
+    unsigned int hardware_wakeups_per_day() const;
+
 private:
     PowerdWakeupTimer(const PowerdWakeupTimer&) =delete;
     PowerdWakeupTimer& operator=(const PowerdWakeupTimer&) =delete;
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+
+#ifndef INDICATOR_DATETIME_WAKEUP_TIMER_TIMERFD_H
+#define INDICATOR_DATETIME_WAKEUP_TIMER_TIMERFD_H
+
+#include <datetime/wakeup-timer.h>
+
+#include <memory> // std::unique_ptr
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****
+***/
+
+/**
+ * \brief a WakeupTimer implemented with an absolute-time timerfd
+ *
+ * This is for systems without powerd. If the process may use
+ * CLOCK_REALTIME_ALARM, the timer wakes the system from suspend;
+ * otherwise it falls back to CLOCK_REALTIME, which still fires at
+ * the right wall-clock time after a resume.
+ *
+ * Either way the timer is re-armed if the wall clock is set.
+ */
+class TimerfdWakeupTimer: public WakeupTimer
+{
+public:
+    TimerfdWakeupTimer();
+    ~TimerfdWakeupTimer();
+    void set_wakeup_time(const DateTime&) override;
+    core::Signal<>& timeout() override;
+
+    /** \brief True if the timer can wake the system from suspend */
+    bool wakes_system() const;
+
+    /** \brief True if timerfds are available at all */
+    static bool is_supported();
+
+private:
+    TimerfdWakeupTimer(const TimerfdWakeupTimer&) =delete;
+    TimerfdWakeupTimer& operator=(const TimerfdWakeupTimer&) =delete;
+    class Impl;
+    std::unique_ptr<Impl> p;
+};
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
+
+#endif // INDICATOR_DATETIME_WAKEUP_TIMER_TIMERFD_H
@@ -33,4 +33,8 @@
 #define BUS_HAPTIC_PATH      "/com/canonical/usensord/haptic"
 #define BUS_HAPTIC_INTERFACE "com.canonical.usensord.haptic"
 
+#define BUS_NOTIFY_NAME      "org.freedesktop.Notifications"
+#define BUS_NOTIFY_PATH      "/org/freedesktop/Notifications"
+#define BUS_NOTIFY_INTERFACE "org.freedesktop.Notifications"
+
 #endif /* INDICATOR_NOTIFICATIONS_DBUS_SHARED_H */
@@ -20,6 +20,8 @@
 #ifndef UNITY_INDICATOR_NOTIFICATIONS_HAPTIC_H
 #define UNITY_INDICATOR_NOTIFICATIONS_HAPTIC_H
 
+#include <gio/gio.h> // GDBusConnection
+
 #include <memory>
 
 namespace unity {
@@ -41,7 +43,7 @@ public:
       MODE_PULSE
     };
 
-    explicit Haptic(const Mode& mode = MODE_PULSE, bool repeat = false);
+    explicit Haptic(GDBusConnection* session_bus, const Mode& mode = MODE_PULSE, bool repeat = false);
     ~Haptic();
 
 private:
@@ -27,6 +27,11 @@
 
 namespace unity {
 namespace indicator {
+
+namespace bus {
+class BusRegistry;
+}
+
 namespace notifications {
 
 class Engine;
@@ -95,23 +100,34 @@ private:
  *
  * When this class is destroyed, any remaining notifications it created
  * will be closed and their closed() callbacks will be invoked.
+ *
+ * None of this blocks on the notification server: its capabilities are
+ * fetched at startup and whenever a new server appears, and show() and
+ * close() are sent asynchronously.
  */
 class Engine
 {
 public:
-    explicit Engine(const std::string& app_name);
+    /** @param buses the bus connections to use. If null, the Engine gets its own. */
+    explicit Engine(const std::string& app_name,
+                    const std::shared_ptr<bus::BusRegistry>& buses=nullptr);
     ~Engine();
 
-    /** @see Builder::set_action() */
+    /** @see Builder::set_action()
+        @return the server's last known capability, or true if the server hasn't replied yet */
     bool supports_actions() const;
 
     /** Show a notification.
+        The request is queued; on_shown is called when the server has replied.
         @return zero on failure, or a key that can be passed to close() */
-    int show(const Builder& builder);
+    int show(const Builder& builder,
+             std::function<void(int key, bool shown)> on_shown=nullptr);
 
     /** Close a notification.
+        The closed callback is called right away; on_closed is called
+        when the server has replied.
         @param key the int returned by show() */
-    void close(int key);
+    void close(int key, std::function<void(bool closed)> on_closed=nullptr);
 
     /** Close all remaining notifications. */
     void close_all();
@@ -37,13 +37,20 @@ namespace notifications {
  * @param uri the file to play
  * @param volume the volume at which to play the sound, [0..100]
  * @param loop if true, loop the sound for the lifespan of the object
+ * @param autoplay if false, the sound is only prerolled until play() is called
  */
 class Sound
 {
 public:
-    Sound(const std::string& role, const std::string& uri, unsigned int volume, bool loop);
+    Sound(const std::string& role, const std::string& uri, unsigned int volume, bool loop, bool autoplay=true);
     ~Sound();
 
+    /** \brief Start playing a sound that was created without autoplay */
+    void play();
+
+    /** \brief True if the sound's pipeline hit an error, eg a bad uri */
+    bool is_broken() const;
+
 private:
     class Impl;
     std::unique_ptr<Impl> impl;
@@ -59,16 +66,46 @@ public:
     SoundBuilder() =default;
     virtual ~SoundBuilder() =default;
     virtual std::shared_ptr<Sound> create(const std::string& role, const std::string& uri, unsigned int volume, bool loop) =0;
+
+    /**
+     * \brief Hint that a sound with these parameters will be created soon.
+     *
+     * Builders may use this to get the sound ready ahead of time.
+     */
+    virtual void preload(const std::string& /*role*/, const std::string& /*uri*/, unsigned int /*volume*/, bool /*loop*/) {}
+
+    /** \brief Hint that a sound passed to preload() won't be needed after all */
+    virtual void unload(const std::string& /*role*/, const std::string& /*uri*/, unsigned int /*volume*/, bool /*loop*/) {}
 };
 
+/**
+ * Builds Sounds, prerolling the one passed to preload()
+ * so that creating it later only needs to start playback.
+ */
 class DefaultSoundBuilder: public SoundBuilder
 {
 public:
     DefaultSoundBuilder() =default;
-    ~DefaultSoundBuilder() =default;
-    virtual std::shared_ptr<Sound> create(const std::string& role, const std::string& uri, unsigned int volume, bool loop) override {
-        return std::make_shared<Sound>(role, uri, volume, loop);
-    }
+    ~DefaultSoundBuilder();
+    virtual std::shared_ptr<Sound> create(const std::string& role, const std::string& uri, unsigned int volume, bool loop) override;
+    virtual void preload(const std::string& role, const std::string& uri, unsigned int volume, bool loop) override;
+    virtual void unload(const std::string& role, const std::string& uri, unsigned int volume, bool loop) override;
+
+private:
+    static int on_preload_expired(void* gself);
+    void clear_preload();
+    bool preloaded_matches(const std::string& role, const std::string& uri, unsigned int volume, bool loop) const;
+
+    std::shared_ptr<Sound> m_preloaded;
+    std::string m_role;
+    std::string m_uri;
+    unsigned int m_volume = 0;
+    bool m_loop = false;
+    unsigned int m_expire_tag = 0;
+
+    // we've got a GSource tag in here, so disable copying
+    DefaultSoundBuilder(const DefaultSoundBuilder&) =delete;
+    DefaultSoundBuilder& operator=(const DefaultSoundBuilder&) =delete;
 };
 
 /***
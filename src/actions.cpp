@@ -50,16 +50,12 @@ DateTime datetime_from_timet_variant(GVariant* v)
 
 bool lookup_appointment_by_uid(const std::shared_ptr<State>& state, const gchar* uid, Appointment& setme)
 {
-    for(const auto& appt : state->calendar_upcoming->appointments().get())
-    {
-        if (appt.uid == uid)
-        {
-            setme = appt;
-            return true;
-        }
-    }
+    const auto appt = state->calendar_upcoming->index().find_uid(uid);
+    if (appt == nullptr)
+        return false;
 
-    return false;
+    setme = *appt;
+    return true;
 }
 
 void on_appointment_activated (GSimpleAction*, GVariant *vdata, gpointer gself)
@@ -135,16 +131,12 @@ GVariant* create_default_header_state()
     return g_variant_builder_end(&b);
 }
 
-GVariant* create_calendar_state(const std::shared_ptr<State>& state)
+GVariant* create_calendar_state(uint32_t days, int64_t calendar_day, bool show_week_numbers)
 {
-    gboolean days[32] = { 0 };
-    for (const auto& appt : state->calendar_month->appointments().get())
-        days[appt.begin.day_of_month()] = true;
-
     GVariantBuilder day_builder;
     g_variant_builder_init(&day_builder, G_VARIANT_TYPE("ai"));
-    for (guint i=0; i<G_N_ELEMENTS(days); i++)
-        if (days[i])
+    for (gint i=1; i<32; i++)
+        if (days & (uint32_t(1) << i))
             g_variant_builder_add(&day_builder, "i", i);
 
     GVariantBuilder dict_builder;
@@ -155,11 +147,11 @@ GVariant* create_calendar_state(const std::shared_ptr<State>& state)
     g_variant_builder_add(&dict_builder, "{sv}", key, v);
 
     key = "calendar-day";
-    v = g_variant_new_int64(state->calendar_month->month().get().to_unix());
+    v = g_variant_new_int64(calendar_day);
     g_variant_builder_add(&dict_builder, "{sv}", key, v);
 
     key = "show-week-numbers";
-    v = g_variant_new_boolean(state->settings->show_week_numbers.get());
+    v = g_variant_new_boolean(show_week_numbers);
     g_variant_builder_add(&dict_builder, "{sv}", key, v);
 
     return g_variant_builder_end(&dict_builder);
@@ -215,7 +207,11 @@ Actions::Actions(const std::shared_ptr<State>& state):
     g_object_unref(a);
 
     // add the calendar action
-    v = create_calendar_state(state);
+    m_occupancy.set(m_state->calendar_month->appointments().get());
+    m_calendar_days = m_occupancy.month_bitmap(m_state->calendar_month->month().get());
+    m_calendar_day = m_state->calendar_month->month().get().to_unix();
+    m_show_week_numbers = m_state->settings->show_week_numbers.get();
+    v = create_calendar_state(m_calendar_days, m_calendar_day, m_show_week_numbers);
     a = g_simple_action_new_stateful("calendar", G_VARIANT_TYPE_INT64, v);
     g_action_map_add_action(gam, G_ACTION(a));
     g_signal_connect(a, "activate", G_CALLBACK(on_calendar_date_activated), this);
@@ -228,14 +224,13 @@ Actions::Actions(const std::shared_ptr<State>& state):
     m_state->calendar_month->month().changed().connect([this](const DateTime&){
         update_calendar_state();
     });
-    m_state->calendar_month->appointments().changed().connect([this](const std::vector<Appointment>&){
+    m_state->calendar_month->appointments().changed().connect([this](const std::vector<Appointment>& appointments){
+        m_occupancy.set(appointments);
         update_calendar_state();
     });
     m_state->settings->show_week_numbers.changed().connect([this](bool){
         update_calendar_state();
     });
-
-    // FIXME: rebuild the calendar state when show-week-number changes
 }
 
 Actions::~Actions()
@@ -245,9 +240,22 @@ Actions::~Actions()
 
 void Actions::update_calendar_state()
 {
+    // appointments churn often without changing which days are busy,
+    // so only bother the shell when the visible state really changes
+    const auto days = m_occupancy.month_bitmap(m_state->calendar_month->month().get());
+    const auto calendar_day = m_state->calendar_month->month().get().to_unix();
+    const bool show_week_numbers = m_state->settings->show_week_numbers.get();
+    if ((days == m_calendar_days) &&
+        (calendar_day == m_calendar_day) &&
+        (show_week_numbers == m_show_week_numbers))
+        return;
+
+    m_calendar_days = days;
+    m_calendar_day = calendar_day;
+    m_show_week_numbers = show_week_numbers;
     g_action_group_change_action_state(action_group(),
                                        "calendar",
-                                       create_calendar_state(m_state));
+                                       create_calendar_state(days, calendar_day, show_week_numbers));
 }
 
 void Actions::set_calendar_date(const DateTime& date)
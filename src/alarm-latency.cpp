@@ -0,0 +1,289 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+
+#include <datetime/alarm-latency.h>
+
+#include <glib.h>
+
+#include <algorithm> // std::max()
+#include <cstdlib> // std::llabs()
+#include <sstream>
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****
+***/
+
+namespace
+{
+    constexpr int BUCKET_MSEC[AlarmLatency::NUM_BUCKETS-1] {10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000};
+
+    // log alarms that reach the user later than this
+    constexpr int64_t LATE_USEC {2 * G_USEC_PER_SEC};
+
+    // a wakeup this long before an alarm isn't what woke us for it
+    constexpr int64_t PENDING_MAX_AGE_USEC {60 * G_USEC_PER_SEC};
+
+    // write the report after the alarm's been handled, not while it's happening
+    constexpr guint REPORT_DELAY_SECONDS {2};
+}
+
+AlarmLatency::AlarmLatency(const std::string& report_filename):
+    m_report_filename(report_filename)
+{
+}
+
+AlarmLatency::~AlarmLatency()
+{
+    if (m_report_tag)
+    {
+        g_source_remove(m_report_tag);
+        write_report();
+    }
+}
+
+std::string AlarmLatency::default_report_filename()
+{
+    auto filename = g_build_filename(g_get_user_cache_dir(), "indicator-datetime", "alarm-latency.txt", nullptr);
+    std::string ret = filename;
+    g_free(filename);
+    return ret;
+}
+
+const char* AlarmLatency::stage_name(Stage stage)
+{
+    static constexpr const char* names[NUM_STAGES] {
+        "wakeup", "requeue", "reached", "notifying", "awake", "sound", "haptic", "shown"
+    };
+    return names[stage];
+}
+
+void AlarmLatency::mark_pending(Stage stage)
+{
+    // if any alarms used the last batch of stamps, start a new one
+    if (!m_pending_used.empty())
+    {
+        m_pending.fill(0);
+        m_pending_used.clear();
+    }
+
+    m_pending[stage] = g_get_monotonic_time();
+}
+
+void AlarmLatency::begin(const Appointment& appointment, const Alarm& alarm)
+{
+    const auto now = g_get_monotonic_time();
+
+    m_tracing = true;
+    m_current = Record();
+    m_current.uid = appointment.uid;
+    m_current.alarm_time = alarm.time;
+    m_current.lateness_usec = DateTime::NowLocal() - alarm.time;
+    if (m_pending_used.insert(std::make_pair(appointment.uid, alarm.time)).second)
+        for (int i=0; i<NUM_STAGES; ++i)
+            if (m_pending[i] && (now - m_pending[i] < PENDING_MAX_AGE_USEC))
+                m_current.stamps[i] = m_pending[i];
+    m_current.stamps[REACHED] = now;
+}
+
+void AlarmLatency::mark(Stage stage)
+{
+    if (m_tracing)
+        m_current.stamps[stage] = g_get_monotonic_time();
+}
+
+void AlarmLatency::mark(const Appointment& appointment, const Alarm& alarm, Stage stage)
+{
+    if (m_tracing && (m_current.uid == appointment.uid) && (m_current.alarm_time == alarm.time))
+    {
+        mark(stage);
+        return;
+    }
+
+    // the alarm's already finished, so update its record and the histogram
+    for (size_t i=0, n=m_records.size(); i<n; ++i)
+    {
+        auto& record = m_records[(m_next_record + n - 1 - i) % n]; // newest first
+        if ((record.uid != appointment.uid) || (record.alarm_time != alarm.time))
+            continue;
+        if (record.stamps[stage])
+            return;
+
+        record.stamps[stage] = g_get_monotonic_time();
+        ++m_histograms[stage][bucket_for(std::llabs(record.stamps[stage] - record.stamps[REACHED]))];
+        if (stage == SHOWN)
+            log_if_late(record);
+        schedule_report();
+        return;
+    }
+}
+
+void AlarmLatency::finish()
+{
+    if (!m_tracing)
+        return;
+    m_tracing = false;
+
+    const auto& stamps = m_current.stamps;
+    for (int i=0; i<NUM_STAGES; ++i)
+        if (stamps[i])
+            ++m_histograms[i][bucket_for(std::llabs(stamps[i] - stamps[REACHED]))];
+    ++m_lateness[bucket_for(std::max(int64_t(0), m_current.lateness_usec))];
+
+    if (stamps[SHOWN])
+        log_if_late(m_current);
+
+    if (m_records.size() < MAX_RECORDS)
+        m_records.push_back(m_current);
+    else
+        m_records[m_next_record] = m_current;
+    m_next_record = (m_next_record + 1) % MAX_RECORDS;
+
+    schedule_report();
+}
+
+void AlarmLatency::log_if_late(const Record& record)
+{
+    const auto& stamps = record.stamps;
+    const auto late_usec = record.lateness_usec + (stamps[SHOWN] - stamps[REACHED]);
+    if (late_usec > LATE_USEC)
+    {
+        g_message("alarm '%s' for %s was shown %.1f seconds late",
+                  record.uid.c_str(),
+                  record.alarm_time.format("%F %T").c_str(),
+                  late_usec / double(G_USEC_PER_SEC));
+    }
+}
+
+void AlarmLatency::schedule_report()
+{
+    if (!m_report_filename.empty() && !m_report_tag)
+        m_report_tag = g_timeout_add_seconds(REPORT_DELAY_SECONDS, on_report_timeout, this);
+}
+
+int AlarmLatency::on_report_timeout(void* gself)
+{
+    auto self = static_cast<AlarmLatency*>(gself);
+    self->m_report_tag = 0;
+    self->write_report();
+    return G_SOURCE_REMOVE;
+}
+
+std::vector<AlarmLatency::Record> AlarmLatency::records() const
+{
+    // unroll the ring buffer
+    std::vector<Record> ret;
+    ret.reserve(m_records.size());
+    const auto start = m_records.size() < MAX_RECORDS ? 0 : m_next_record;
+    for (size_t i=0, n=m_records.size(); i<n; ++i)
+        ret.push_back(m_records[(start + i) % n]);
+    return ret;
+}
+
+const AlarmLatency::Histogram& AlarmLatency::histogram(Stage stage) const
+{
+    return m_histograms[stage];
+}
+
+const AlarmLatency::Histogram& AlarmLatency::lateness_histogram() const
+{
+    return m_lateness;
+}
+
+void AlarmLatency::set_hardware_wakeups_func(const std::function<unsigned int()>& func)
+{
+    m_hardware_wakeups = func;
+}
+
+int AlarmLatency::bucket_for(int64_t usec)
+{
+    const auto msec = usec / 1000;
+    int i = 0;
+    while ((i < NUM_BUCKETS-1) && (BUCKET_MSEC[i] <= msec))
+        ++i;
+    return i;
+}
+
+void AlarmLatency::write_report() const
+{
+    if (m_report_filename.empty())
+        return;
+
+    std::ostringstream o;
+
+    o << "# recent alarms, oldest first. msec relative to 'reached'; '-' if skipped\n";
+    o << "# uid alarm-time late";
+    for (int i=0; i<NUM_STAGES; ++i)
+        o << ' ' << stage_name(Stage(i));
+    o << '\n';
+    for (const auto& record : records())
+    {
+        o << record.uid << ' ' << record.alarm_time.format("%FT%T%z") << ' ' << record.lateness_usec/1000;
+        for (const auto& stamp : record.stamps)
+        {
+            if (stamp)
+                o << ' ' << (stamp - record.stamps[REACHED]) / 1000;
+            else
+                o << " -";
+        }
+        o << '\n';
+    }
+
+    o << "\n# histograms: count of alarms per bucket; buckets are msec upper bounds\n";
+    o << "# stage";
+    for (const auto& msec : BUCKET_MSEC)
+        o << " <" << msec;
+    o << " >=" << BUCKET_MSEC[NUM_BUCKETS-2] << '\n';
+    auto write_histogram = [&o](const char* name, const Histogram& h){
+        o << name;
+        for (const auto& n : h)
+            o << ' ' << n;
+        o << '\n';
+    };
+    write_histogram("late", m_lateness);
+    for (int i=0; i<NUM_STAGES; ++i)
+        write_histogram(stage_name(Stage(i)), m_histograms[i]);
+
+    if (m_hardware_wakeups)
+        o << "\n# hardware wakeups in the last 24 hours\n" << m_hardware_wakeups() << '\n';
+
+    auto dirname = g_path_get_dirname(m_report_filename.c_str());
+    g_mkdir_with_parents(dirname, 0700);
+    g_free(dirname);
+
+    const auto str = o.str();
+    GError* error = nullptr;
+    if (!g_file_set_contents(m_report_filename.c_str(), str.c_str(), str.size(), &error))
+    {
+        g_warning("couldn't write '%s': %s", m_report_filename.c_str(), error->message);
+        g_error_free(error);
+    }
+}
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
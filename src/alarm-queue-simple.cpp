@@ -17,10 +17,13 @@
  *   Charles Kerr <charles.kerr@canonical.com>
  */
 
+#include <datetime/alarm-latency.h>
 #include <datetime/alarm-queue-simple.h>
 
 #include <cmath>
 #include <set>
+#include <utility> // std::pair
+#include <vector>
 
 namespace unity {
 namespace indicator {
@@ -36,10 +39,12 @@ public:
 
     Impl(const std::shared_ptr<Clock>& clock,
          const std::shared_ptr<Planner>& planner,
-         const std::shared_ptr<WakeupTimer>& timer):
+         const std::shared_ptr<WakeupTimer>& timer,
+         const std::shared_ptr<AlarmLatency>& latency):
       m_clock{clock},
       m_planner{planner},
       m_timer{timer},
+      m_latency{latency ? latency : std::make_shared<AlarmLatency>("")},
       m_datetime{clock->localtime()}
     {
         m_planner->appointments().changed().connect([this](const std::vector<Appointment>&){
@@ -55,11 +60,15 @@ public:
             if (clock_jumped) {
                 g_debug("AlarmQueue %p calling requeue() due to clock skew", this);
                 requeue();
+            } else {
+                // we're awake anyway, so see if the next alarm is close
+                maybe_prepare();
             }
         });
 
         m_timer->timeout().connect([this](){
             g_debug("AlarmQueue %p calling requeue() due to timeout", this);
+            m_latency->mark_pending(AlarmLatency::WAKEUP);
             requeue();
         });
 
@@ -68,6 +77,7 @@ public:
 
     ~Impl()
     {
+        unset_prepare_timer();
     }
 
     core::Signal<const Appointment&, const Alarm&>& alarm_reached()
@@ -75,88 +85,171 @@ public:
         return m_alarm_reached;
     }
 
+    core::Signal<const Appointment&, const Alarm&>& alarm_upcoming()
+    {
+        return m_alarm_upcoming;
+    }
+
+    core::Signal<const Appointment&, const Alarm&>& alarm_withdrawn()
+    {
+        return m_alarm_withdrawn;
+    }
+
 private:
 
     void requeue()
     {
-        const auto appointments = m_planner->appointments().get();
-        const Alarm* alarm;
+        m_latency->mark_pending(AlarmLatency::REQUEUE);
+
+        const auto& index = m_planner->index();
+        const auto beginning_of_minute = m_clock->localtime().start_of_minute();
+        const auto next_minute = beginning_of_minute.add_full(0,0,0,0,1,0);
+
+        g_debug ("planner has %zu appointments in it", (size_t)index.appointments().size());
+
+        // find the current alarms. Copy them out before kicking them
+        // because a listener may change the planner's appointments
+        std::vector<std::pair<Appointment,Alarm>> current;
+        index.foreach_alarm_after(beginning_of_minute, [this,&current,&next_minute](const Appointment& appointment, const Alarm& alarm){
+            if (next_minute <= alarm.time)
+                return false;
+            if (!already_triggered(appointment, alarm))
+                current.push_back(std::make_pair(appointment, alarm));
+            return true;
+        });
 
         // kick any current alarms
-        for (const auto& appointment : appointments)
+        for (const auto& c : current)
         {
-            if ((alarm = appointment_get_current_alarm(appointment)))
-            {
-                m_triggered.insert(std::make_pair(appointment.uid, alarm->time));
-                m_alarm_reached(appointment, *alarm);
-            }
+            m_triggered.insert(std::make_pair(c.first.uid, c.second.time));
+            m_latency->begin(c.first, c.second);
+            m_alarm_reached(c.first, c.second);
+            m_latency->finish();
+        }
+
+        // find the next alarm
+        m_next_appointment = Appointment();
+        m_next = Alarm();
+        m_planner->index().foreach_alarm_after(beginning_of_minute, [this](const Appointment& appointment, const Alarm& alarm){
+            if (already_triggered(appointment, alarm))
+                return true;
+            m_next_appointment = appointment;
+            m_next = alarm;
+            return false;
+        });
+
+        // if the alarm that listeners got ready for isn't next anymore
+        // and wasn't reached, eg it was disabled, let them stand down
+        if (m_upcoming.time.is_set()
+            && !already_triggered(m_upcoming_appointment, m_upcoming)
+            && !is_next(m_upcoming_appointment, m_upcoming))
+        {
+            const auto appointment = m_upcoming_appointment;
+            const auto alarm = m_upcoming;
+            m_upcoming_appointment = Appointment();
+            m_upcoming = Alarm();
+            m_alarm_withdrawn(appointment, alarm);
         }
 
+        maybe_prepare();
+
         // idle until the next alarm
-        if ((alarm = find_next_alarm(appointments)))
+        if (m_next.time.is_set())
         {
-            g_debug ("setting timer to wake up for next appointment '%s' at %s", 
-                     alarm->text.c_str(),
-                     alarm->time.format("%F %T").c_str());
+            g_debug ("setting timer to wake up for next appointment '%s' at %s",
+                     m_next.text.c_str(),
+                     m_next.time.format("%F %T").c_str());
 
-            m_timer->set_wakeup_time(alarm->time);
+            m_timer->set_wakeup_time(m_next.time);
         }
     }
 
-    bool already_triggered (const Appointment& appt, const Alarm& alarm) const
+    /**
+     * Give listeners a head start on the next alarm if it's close.
+     *
+     * If it isn't close yet, a plain main loop timeout comes back for it.
+     * That doesn't cost a hardware wakeup: if the device is suspended,
+     * the alarm's own wakeup gets us there. Minute ticks can't be relied
+     * on, since the clock stops them while the display is off.
+     */
+    void maybe_prepare()
     {
-        const std::pair<const std::string&,const DateTime&> key{appt.uid, alarm.time};
-        return m_triggered.count(key) != 0;
-    }
+        unset_prepare_timer();
 
-    // return the next Alarm (if any) that will kick now or in the future
-    const Alarm* find_next_alarm(const std::vector<Appointment>& appointments) const
-    {
-        const Alarm* best {};
-        const auto now = m_clock->localtime();
-        const auto beginning_of_minute = now.start_of_minute();
+        if (!m_next.time.is_set() || is_upcoming(m_next_appointment, m_next))
+            return;
 
-        g_debug ("planner has %zu appointments in it", (size_t)appointments.size());
-
-        for(const auto& appointment : appointments)
+        const auto prepare_time = m_next.time.add_full(0,0,0,0,0,-PREPARE_SECONDS);
+        const auto now = m_clock->localtime();
+        if (now < prepare_time)
         {
-            for(const auto& alarm : appointment.alarms)
-            {
-                if (already_triggered(appointment, alarm))
-                    continue;
-
-                if (alarm.time < beginning_of_minute) // has this one already passed?
-                    continue;
+            const auto usec = prepare_time - now;
+            const auto seconds = guint((usec + G_USEC_PER_SEC - 1) / G_USEC_PER_SEC);
+            m_prepare_tag = g_timeout_add_seconds(seconds, on_prepare_timeout, this);
+            return;
+        }
 
-                if (best && (best->time < alarm.time)) // do we already have a better match?
-                    continue;
+        prepare();
+    }
 
-                best = &alarm;
-            }
-        }
+    static gboolean on_prepare_timeout(gpointer gself)
+    {
+        auto self = static_cast<Impl*>(gself);
+        self->m_prepare_tag = 0;
+        if (self->m_next.time.is_set() && !self->is_upcoming(self->m_next_appointment, self->m_next))
+            self->prepare();
+        return G_SOURCE_REMOVE;
+    }
 
-        return best;
+    void prepare()
+    {
+        m_upcoming_appointment = m_next_appointment;
+        m_upcoming = m_next;
+        m_alarm_upcoming(m_upcoming_appointment, m_upcoming);
     }
 
-    // return the Appointment's current Alarm (if any)
-    const Alarm* appointment_get_current_alarm(const Appointment& appointment) const
+    void unset_prepare_timer()
     {
-        const auto now = m_clock->localtime();
+        if (m_prepare_tag != 0)
+        {
+            g_source_remove(m_prepare_tag);
+            m_prepare_tag = 0;
+        }
+    }
 
-        for (const auto& alarm : appointment.alarms)
-            if (!already_triggered(appointment, alarm) && DateTime::is_same_minute(now, alarm.time))
-                return &alarm;
+    // enough time to get a sound file off the disk
+    static constexpr int PREPARE_SECONDS {60};
 
-        return nullptr;
+    bool is_next(const Appointment& appt, const Alarm& alarm) const
+    {
+        return (appt.uid == m_next_appointment.uid) && (alarm.time == m_next.time);
     }
 
+    bool is_upcoming(const Appointment& appt, const Alarm& alarm) const
+    {
+        return (appt.uid == m_upcoming_appointment.uid) && (alarm.time == m_upcoming.time);
+    }
+
+    bool already_triggered (const Appointment& appt, const Alarm& alarm) const
+    {
+        const std::pair<const std::string&,const DateTime&> key{appt.uid, alarm.time};
+        return m_triggered.count(key) != 0;
+    }
 
     std::set<std::pair<std::string,DateTime>> m_triggered;
     const std::shared_ptr<Clock> m_clock;
     const std::shared_ptr<Planner> m_planner;
     const std::shared_ptr<WakeupTimer> m_timer;
+    const std::shared_ptr<AlarmLatency> m_latency;
     core::Signal<const Appointment&, const Alarm&> m_alarm_reached;
+    core::Signal<const Appointment&, const Alarm&> m_alarm_upcoming;
+    core::Signal<const Appointment&, const Alarm&> m_alarm_withdrawn;
+    Appointment m_next_appointment;
+    Alarm m_next;
+    Appointment m_upcoming_appointment;
+    Alarm m_upcoming;
     DateTime m_datetime;
+    guint m_prepare_tag = 0;
 };
 
 /***
@@ -166,8 +259,9 @@ private:
 
 SimpleAlarmQueue::SimpleAlarmQueue(const std::shared_ptr<Clock>& clock,
                                    const std::shared_ptr<Planner>& planner,
-                                   const std::shared_ptr<WakeupTimer>& timer):
-    impl{new Impl{clock, planner, timer}}
+                                   const std::shared_ptr<WakeupTimer>& timer,
+                                   const std::shared_ptr<AlarmLatency>& latency):
+    impl{new Impl{clock, planner, timer, latency}}
 {
 }
 
@@ -181,6 +275,18 @@ SimpleAlarmQueue::alarm_reached()
     return impl->alarm_reached();
 }
 
+core::Signal<const Appointment&, const Alarm&>&
+SimpleAlarmQueue::alarm_upcoming()
+{
+    return impl->alarm_upcoming();
+}
+
+core::Signal<const Appointment&, const Alarm&>&
+SimpleAlarmQueue::alarm_withdrawn()
+{
+    return impl->alarm_withdrawn();
+}
+
 /***
 ****
 ***/
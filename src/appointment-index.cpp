@@ -0,0 +1,287 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include <datetime/appointment-index.h>
+
+#include <algorithm> // std::stable_sort(), std::lower_bound()
+#include <limits>
+#include <utility> // std::pair
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****
+***/
+
+AppointmentIndex::AppointmentIndex(const std::vector<Appointment>& appointments)
+{
+    reset(appointments);
+}
+
+int64_t AppointmentIndex::to_key(const DateTime& dt)
+{
+    auto gdt = dt.get();
+    return g_date_time_to_unix(gdt) * G_USEC_PER_SEC + g_date_time_get_microsecond(gdt);
+}
+
+int AppointmentIndex::to_day_key(const DateTime& dt)
+{
+    int year=0, month=0, day=0;
+    dt.ymd(year, month, day);
+    return year*10000 + month*100 + day;
+}
+
+std::vector<int> AppointmentIndex::to_day_keys(const Appointment& appointment)
+{
+    std::vector<int> keys;
+
+    const auto begin = to_key(appointment.begin);
+    const auto end = appointment.end.is_set() ? std::max(begin, to_key(appointment.end)) : begin;
+    auto day = appointment.begin.start_of_day();
+    for (;;)
+    {
+        keys.push_back(to_day_key(day));
+        day = day.add_days(1);
+        if (to_key(day) >= end)
+            break;
+    }
+
+    return keys;
+}
+
+void AppointmentIndex::reset(const std::vector<Appointment>& appointments)
+{
+    m_appointments.clear();
+    m_nodes.clear();
+    m_days.clear();
+    m_alarms.clear();
+    m_uids.clear();
+    m_sources.clear();
+
+    // sort by begin time, computing each key only once
+    std::vector<std::pair<int64_t,size_t>> order;
+    order.reserve(appointments.size());
+    for (size_t i=0, n=appointments.size(); i<n; ++i)
+        order.push_back(std::make_pair(to_key(appointments[i].begin), i));
+    std::stable_sort(order.begin(), order.end(),
+                     [](const std::pair<int64_t,size_t>& a, const std::pair<int64_t,size_t>& b){return a.first < b.first;});
+
+    m_appointments.reserve(order.size());
+    m_nodes.reserve(order.size());
+    for (const auto& o : order)
+    {
+        const auto& appointment = appointments[o.second];
+        const auto begin = o.first;
+        const auto end = appointment.end.is_set() ? std::max(begin, to_key(appointment.end)) : begin;
+        m_appointments.push_back(appointment);
+        m_nodes.push_back(Node{begin, end, end});
+    }
+
+    build_tree();
+
+    for (size_t i=0, n=m_appointments.size(); i<n; ++i)
+    {
+        const auto& appointment = m_appointments[i];
+
+        for (const auto& day : to_day_keys(appointment))
+            m_days[day].push_back(i);
+
+        // sorted by begin, so the first instance of a uid is the earliest
+        m_uids.insert(std::make_pair(appointment.uid, i));
+        m_sources[appointment.source_uid].push_back(i);
+
+        for (size_t j=0, jn=appointment.alarms.size(); j<jn; ++j)
+            if (appointment.alarms[j].time.is_set())
+                m_alarms.push_back(AlarmRef{to_key(appointment.alarms[j].time), i, j});
+    }
+
+    std::stable_sort(m_alarms.begin(), m_alarms.end(),
+                     [](const AlarmRef& a, const AlarmRef& b){return a.time < b.time;});
+}
+
+/**
+ * Build the implicit interval tree over m_nodes, which is sorted by begin.
+ *
+ * Nodes at level 0 are the even indices; nodes at level k are the indices
+ * whose lowest k+1 bits are 0 followed by k 1s, and their children are
+ * at index +/- 2^(k-1). Each node's max_end is the latest end in its
+ * subtree. Children past the end of the array are 'virtual' and inherit
+ * the max_end of the last real node beneath them.
+ */
+void AppointmentIndex::build_tree()
+{
+    const size_t n = m_nodes.size();
+
+    m_max_level = -1;
+    if (n == 0)
+        return;
+
+    size_t last_i = 0;
+    int64_t last = 0;
+    for (size_t i=0; i<n; i+=2)
+    {
+        last_i = i;
+        last = m_nodes[i].max_end = m_nodes[i].end;
+    }
+
+    int k;
+    for (k=1; (size_t(1)<<k) <= n; ++k)
+    {
+        const size_t x = size_t(1) << (k-1);
+        const size_t i0 = (x<<1) - 1;
+        const size_t step = x<<2;
+        for (size_t i=i0; i<n; i+=step)
+        {
+            const auto left = m_nodes[i-x].max_end;
+            const auto right = i+x < n ? m_nodes[i+x].max_end : last;
+            m_nodes[i].max_end = std::max(m_nodes[i].end, std::max(left, right));
+        }
+        last_i = ((last_i>>k) & 1) ? last_i - x : last_i + x;
+        if ((last_i < n) && (m_nodes[last_i].max_end > last))
+            last = m_nodes[last_i].max_end;
+    }
+
+    m_max_level = k - 1;
+}
+
+void AppointmentIndex::query(int64_t begin, int64_t end, std::vector<size_t>& setme) const
+{
+    struct Frame
+    {
+        size_t x;
+        int k;
+        bool left_done;
+    };
+
+    const size_t n = m_nodes.size();
+    if (m_max_level < 0)
+        return;
+
+    std::vector<Frame> stack;
+    stack.push_back(Frame{(size_t(1)<<m_max_level) - 1, m_max_level, false});
+    while (!stack.empty())
+    {
+        const auto z = stack.back();
+        stack.pop_back();
+
+        if (z.k <= 3) // small subtree; a linear scan is faster
+        {
+            const size_t i0 = z.x >> z.k << z.k;
+            const size_t i1 = std::min(n, i0 + (size_t(1)<<(z.k+1)) - 1);
+            for (size_t i=i0; i<i1 && m_nodes[i].begin<=end; ++i)
+                if (begin <= m_nodes[i].end)
+                    setme.push_back(i);
+        }
+        else if (!z.left_done)
+        {
+            // revisit this node after its left subtree
+            stack.push_back(Frame{z.x, z.k, true});
+
+            // walk the left subtree if it's virtual or might overlap
+            const size_t y = z.x - (size_t(1)<<(z.k-1));
+            if ((y >= n) || (m_nodes[y].max_end >= begin))
+                stack.push_back(Frame{y, z.k-1, false});
+        }
+        else if ((z.x < n) && (m_nodes[z.x].begin <= end))
+        {
+            if (begin <= m_nodes[z.x].end)
+                setme.push_back(z.x);
+
+            stack.push_back(Frame{z.x + (size_t(1)<<(z.k-1)), z.k-1, false});
+        }
+    }
+}
+
+std::vector<Appointment> AppointmentIndex::collect(const std::vector<size_t>& indices) const
+{
+    std::vector<Appointment> ret;
+    ret.reserve(indices.size());
+    for (const auto& i : indices)
+        ret.push_back(m_appointments[i]);
+    return ret;
+}
+
+/***
+****
+***/
+
+std::vector<Appointment> AppointmentIndex::overlapping(const DateTime& begin, const DateTime& end) const
+{
+    std::vector<size_t> indices;
+    query(to_key(begin), to_key(end), indices);
+    return collect(indices);
+}
+
+std::vector<Appointment> AppointmentIndex::ending_after(const DateTime& t) const
+{
+    std::vector<size_t> indices;
+    query(to_key(t), std::numeric_limits<int64_t>::max(), indices);
+    return collect(indices);
+}
+
+std::vector<Appointment> AppointmentIndex::starting_after(const DateTime& t) const
+{
+    const auto key = to_key(t);
+    const auto it = std::lower_bound(m_nodes.begin(), m_nodes.end(), key,
+                                     [](const Node& node, int64_t k){return node.begin < k;});
+    return std::vector<Appointment>(m_appointments.begin() + (it - m_nodes.begin()),
+                                    m_appointments.end());
+}
+
+std::vector<Appointment> AppointmentIndex::on_day(const DateTime& day) const
+{
+    const auto it = m_days.find(to_day_key(day));
+    return it != m_days.end() ? collect(it->second) : std::vector<Appointment>();
+}
+
+const Appointment* AppointmentIndex::find_uid(const std::string& uid) const
+{
+    const auto it = m_uids.find(uid);
+    return it != m_uids.end() ? &m_appointments[it->second] : nullptr;
+}
+
+std::vector<Appointment> AppointmentIndex::from_source(const std::string& source_uid) const
+{
+    const auto it = m_sources.find(source_uid);
+    return it != m_sources.end() ? collect(it->second) : std::vector<Appointment>();
+}
+
+void AppointmentIndex::foreach_alarm_after(const DateTime& t,
+                                           const std::function<bool(const Appointment&, const Alarm&)>& visitor) const
+{
+    const auto key = to_key(t);
+    auto it = std::lower_bound(m_alarms.begin(), m_alarms.end(), key,
+                               [](const AlarmRef& ref, int64_t k){return ref.time < k;});
+    for ( ; it!=m_alarms.end(); ++it)
+    {
+        const auto& appointment = m_appointments[it->appointment];
+        if (!visitor(appointment, appointment.alarms[it->alarm]))
+            break;
+    }
+}
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
@@ -52,6 +52,7 @@ bool Appointment::operator==(const Appointment& that) const
         && (summary==that.summary)
         && (begin==that.begin)
         && (end==that.end)
+        && (floating==that.floating)
         && (alarms==that.alarms);
 }
 
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include <datetime/arena.h>
+
+#include <cstdint> // uintptr_t
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****
+***/
+
+constexpr size_t Arena::DEFAULT_BLOCK_SIZE;
+
+Arena::Arena(size_t block_size):
+    m_block_size(block_size)
+{
+}
+
+Arena::~Arena()
+{
+    while (m_blocks != nullptr)
+    {
+        auto next = m_blocks->next;
+        ::operator delete(m_blocks);
+        m_blocks = next;
+    }
+}
+
+// reserve a block with room for @size bytes and return its usable start
+char* Arena::add_block(size_t size)
+{
+    const size_t total = sizeof(Block) + size;
+    auto block = static_cast<Block*>(::operator new(total));
+    m_bytes_reserved += total;
+
+    // keep the current block at the head of the list so that
+    // an oversized one-off block doesn't end its run
+    if ((m_blocks != nullptr) && (size > m_block_size))
+    {
+        block->next = m_blocks->next;
+        m_blocks->next = block;
+    }
+    else
+    {
+        block->next = m_blocks;
+        m_blocks = block;
+    }
+
+    return reinterpret_cast<char*>(block + 1);
+}
+
+void* Arena::allocate(size_t n, size_t alignment)
+{
+    const auto align = [alignment](char* p){
+        const auto u = reinterpret_cast<uintptr_t>(p);
+        return reinterpret_cast<char*>((u + alignment - 1) & ~uintptr_t(alignment - 1));
+    };
+
+    m_bytes_used += n;
+
+    auto p = m_pos ? align(m_pos) : nullptr;
+    if ((p != nullptr) && (p + n <= m_end))
+    {
+        m_pos = p + n;
+        return p;
+    }
+
+    // big allocations get a block of their own
+    const size_t needed = n + alignment;
+    if (needed > m_block_size)
+        return align(add_block(needed));
+
+    m_pos = add_block(m_block_size);
+    m_end = m_pos + m_block_size;
+    p = align(m_pos);
+    m_pos = p + n;
+    return p;
+}
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
@@ -0,0 +1,181 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+
+#include <bus/bus-registry.h>
+
+#include <map>
+#include <utility> // std::pair
+
+namespace unity {
+namespace indicator {
+namespace bus {
+
+/***
+****
+***/
+
+class BusRegistry::Impl
+{
+public:
+
+    Impl(GDBusConnection* system_bus, GDBusConnection* session_bus):
+        m_system_bus(system_bus ? G_DBUS_CONNECTION(g_object_ref(system_bus)) : nullptr),
+        m_session_bus(session_bus ? G_DBUS_CONNECTION(g_object_ref(session_bus)) : nullptr)
+    {
+    }
+
+    ~Impl()
+    {
+        for (auto& kv : m_watches)
+            g_bus_unwatch_name(kv.second->tag);
+        m_watches.clear();
+
+        g_clear_object(&m_session_bus);
+        g_clear_object(&m_system_bus);
+    }
+
+    GDBusConnection* bus(GBusType bus_type) const
+    {
+        switch (bus_type)
+        {
+            case G_BUS_TYPE_SYSTEM: return m_system_bus;
+            case G_BUS_TYPE_SESSION: return m_session_bus;
+            default: return nullptr;
+        }
+    }
+
+    core::Connection watch_name(GBusType bus_type,
+                                const std::string& name,
+                                std::function<void(const std::string&)> func)
+    {
+        auto& watch = m_watches[std::make_pair(bus_type, name)];
+        if (!watch)
+        {
+            watch.reset(new Watch);
+            auto connection = bus(bus_type);
+            if (connection != nullptr)
+            {
+                watch->tag = g_bus_watch_name_on_connection(connection,
+                                                            name.c_str(),
+                                                            G_BUS_NAME_WATCHER_FLAGS_NONE,
+                                                            on_name_appeared,
+                                                            on_name_vanished,
+                                                            watch.get(),
+                                                            nullptr);
+            }
+        }
+
+        auto c = watch->owner_changed.connect(func);
+        if (!watch->owner.empty())
+            func(watch->owner);
+        return c;
+    }
+
+    std::string name_owner(GBusType bus_type, const std::string& name) const
+    {
+        const auto it = m_watches.find(std::make_pair(bus_type, name));
+        return it != m_watches.end() ? it->second->owner : std::string();
+    }
+
+private:
+
+    struct Watch
+    {
+        guint tag = 0;
+        std::string owner;
+        core::Signal<const std::string&> owner_changed;
+    };
+
+    static void on_name_appeared(GDBusConnection * /*connection*/,
+                                 const gchar     * name,
+                                 const gchar     * name_owner,
+                                 gpointer          gwatch)
+    {
+        g_debug("%s %s owns %s now", G_STRLOC, name_owner, name);
+        auto watch = static_cast<Watch*>(gwatch);
+        watch->owner = name_owner;
+        watch->owner_changed(watch->owner);
+    }
+
+    static void on_name_vanished(GDBusConnection * /*connection*/,
+                                 const gchar     * name,
+                                 gpointer          gwatch)
+    {
+        auto watch = static_cast<Watch*>(gwatch);
+        if (!watch->owner.empty())
+        {
+            g_debug("%s %s vanished", G_STRLOC, name);
+            watch->owner.clear();
+            watch->owner_changed(watch->owner);
+        }
+    }
+
+    GDBusConnection* m_system_bus = nullptr;
+    GDBusConnection* m_session_bus = nullptr;
+    std::map<std::pair<GBusType,std::string>,std::unique_ptr<Watch>> m_watches;
+};
+
+/***
+****
+***/
+
+BusRegistry::BusRegistry(GDBusConnection* system_bus, GDBusConnection* session_bus):
+    impl(new Impl(system_bus, session_bus))
+{
+}
+
+BusRegistry::~BusRegistry()
+{
+}
+
+GDBusConnection* BusRegistry::system_bus() const
+{
+    return impl->bus(G_BUS_TYPE_SYSTEM);
+}
+
+GDBusConnection* BusRegistry::session_bus() const
+{
+    return impl->bus(G_BUS_TYPE_SESSION);
+}
+
+GDBusConnection* BusRegistry::bus(GBusType bus_type) const
+{
+    return impl->bus(bus_type);
+}
+
+core::Connection BusRegistry::watch_name(GBusType bus_type,
+                                         const std::string& name,
+                                         std::function<void(const std::string&)> func)
+{
+    return impl->watch_name(bus_type, name, func);
+}
+
+std::string BusRegistry::name_owner(GBusType bus_type, const std::string& name) const
+{
+    return impl->name_owner(bus_type, name);
+}
+
+/***
+****
+***/
+
+} // namespace bus
+} // namespace indicator
+} // namespace unity
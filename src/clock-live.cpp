@@ -19,12 +19,15 @@
 
 #include <datetime/clock.h>
 #include <datetime/timezone.h>
+#include <datetime/timezone-registry.h>
 
 #include <glib-unix.h> // g_unix_fd_add()
 
 #include <sys/timerfd.h>
 #include <unistd.h> // close()
 
+#include <vector>
+
 #ifndef TFD_TIMER_CANCEL_ON_SET
  #define TFD_TIMER_CANCEL_ON_SET (1 << 1)
 #endif
@@ -50,8 +53,19 @@ public:
             auto setter = [this](const std::string& z){setTimezone(z);};
             m_timezone->timezone.changed().connect(setter);
             setter(m_timezone->timezone.get());
+
+            // if the tzdata changed, our zone's rules may have too
+            m_connections.push_back(TimezoneRegistry::instance().changed().connect([this](){
+                setTimezone(m_timezone->timezone.get());
+            }));
         }
 
+        // stop ticking while no one can see us
+        auto on_visibility_changed = [this](bool){update_ticking();};
+        m_connections.push_back(m_owner.display_on.changed().connect(on_visibility_changed));
+        m_connections.push_back(m_owner.has_viewers.changed().connect(on_visibility_changed));
+        m_ticking = wants_ticks();
+
         reset_timer();
         refresh();
     }
@@ -75,6 +89,26 @@ public:
 
 private:
 
+    bool wants_ticks() const
+    {
+        return m_owner.display_on.get() && m_owner.has_viewers.get();
+    }
+
+    void update_ticking()
+    {
+        const auto ticking = wants_ticks();
+        if (m_ticking == ticking)
+            return;
+
+        g_debug("%s %s minute ticks", G_STRLOC, ticking ? "resuming" : "suspending");
+        m_ticking = ticking;
+        reset_timer();
+
+        // catch up on whatever we missed while we weren't ticking
+        if (ticking)
+            refresh();
+    }
+
     void unset_timer()
     {
         if (m_timerfd_tag != 0)
@@ -100,20 +134,32 @@ private:
         if (m_timerfd == -1)
             g_error("unable to create realtime timer: %s", g_strerror(errno));
 
-        // set args to fire at the beginning of the next minute...
         struct itimerspec timerval;
         int flags = TFD_TIMER_ABSTIME;
-        auto now = g_date_time_new_now(m_gtimezone);
-        auto next = g_date_time_add_minutes(now, 1);
-        auto start_of_next = g_date_time_add_seconds(next, -g_date_time_get_seconds(next));
-        timerval.it_value.tv_sec = g_date_time_to_unix(start_of_next);
-        timerval.it_value.tv_nsec = 0;
-        g_date_time_unref(start_of_next);
-        g_date_time_unref(next);
-        g_date_time_unref(now);
-        // ...and also to fire at the beginning of every subsequent minute...
-        timerval.it_interval.tv_sec = 60;
-        timerval.it_interval.tv_nsec = 0;
+        if (m_ticking)
+        {
+            // set args to fire at the beginning of the next minute...
+            auto now = g_date_time_new_now(m_gtimezone);
+            auto next = g_date_time_add_minutes(now, 1);
+            auto start_of_next = g_date_time_add_seconds(next, -g_date_time_get_seconds(next));
+            timerval.it_value.tv_sec = g_date_time_to_unix(start_of_next);
+            timerval.it_value.tv_nsec = 0;
+            g_date_time_unref(start_of_next);
+            g_date_time_unref(next);
+            g_date_time_unref(now);
+            // ...and also to fire at the beginning of every subsequent minute...
+            timerval.it_interval.tv_sec = 60;
+            timerval.it_interval.tv_nsec = 0;
+        }
+        else
+        {
+            // no one's watching, so only fire when the date changes;
+            // alarms have wakeup timers of their own
+            timerval.it_value.tv_sec = localtime().add_days(1).start_of_day().to_unix();
+            timerval.it_value.tv_nsec = 0;
+            timerval.it_interval.tv_sec = 0;
+            timerval.it_interval.tv_nsec = 0;
+        }
         // ...and also to fire if someone changes the time
         // manually (eg toggling from manual<->ntp)
         flags |= TFD_TIMER_CANCEL_ON_SET;
@@ -150,7 +196,12 @@ private:
             // reset the timer in case someone changed the system clock
             self->reset_timer();
         }
-  
+        else if (!self->m_ticking)
+        {
+            // the one-shot date timer fired; arm the next one
+            self->reset_timer();
+        }
+
         self->refresh();
         return G_SOURCE_CONTINUE;
     }
@@ -162,7 +213,13 @@ private:
     void setTimezone(const std::string& str)
     {
         g_clear_pointer(&m_gtimezone, g_time_zone_unref);
-        m_gtimezone = g_time_zone_new(str.c_str());
+        m_gtimezone = g_time_zone_ref(TimezoneRegistry::instance().get(str).get());
+
+        // while suspended, the date timer was armed for the old zone's midnight.
+        // (the constructor arms the first timer once it knows m_ticking)
+        if (m_timerfd != -1)
+            reset_timer();
+
         m_owner.minute_changed();
     }
 
@@ -188,13 +245,17 @@ protected:
     LiveClock& m_owner;
     GTimeZone* m_gtimezone = nullptr;
     std::shared_ptr<const Timezone> m_timezone;
+    std::vector<core::ScopedConnection> m_connections;
 
     DateTime m_prev_datetime;
+    bool m_ticking = true;
     int m_timerfd = -1;
     guint m_timerfd_tag = 0;
 };
 
-LiveClock::LiveClock(const std::shared_ptr<const Timezone>& timezone_):
+LiveClock::LiveClock(const std::shared_ptr<const Timezone>& timezone_,
+                     const std::shared_ptr<unity::indicator::bus::BusRegistry>& buses):
+    Clock(buses),
     p(new Impl(*this, timezone_))
 {
 }
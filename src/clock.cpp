@@ -20,11 +20,12 @@
 #include <datetime/clock.h>
 #include <datetime/dbus-shared.h>
 
+#include <notifications/dbus-shared.h>
+
 #include <glib.h>
 #include <gio/gio.h>
 
 #include <map>
-#include <set>
 #include <string>
 #include <vector>
 
@@ -40,20 +41,20 @@ class Clock::Impl
 {
 public:
 
-    Impl(Clock& owner):
+    Impl(Clock& owner, const std::shared_ptr<unity::indicator::bus::BusRegistry>& buses):
         m_owner(owner),
         m_cancellable(g_cancellable_new())
     {
-        g_bus_get(G_BUS_TYPE_SYSTEM, m_cancellable, on_bus_ready, this);
+        if (buses)
+            init_buses(buses);
+        else
+            g_bus_get(G_BUS_TYPE_SYSTEM, m_cancellable, on_bus_ready, this);
     }
 
     ~Impl()
     {
         g_cancellable_cancel(m_cancellable);
         g_object_unref(m_cancellable);
-
-        for(const auto& tag : m_watched_names)
-            g_bus_unwatch_name(tag);
     }
 
 private:
@@ -67,24 +68,8 @@ private:
 
         if ((bus = g_bus_get_finish(res, &error)))
         {
-            auto self = static_cast<Impl*>(gself);
-
-            auto tag = g_bus_watch_name_on_connection(bus,
-                                                      "org.freedesktop.login1",
-                                                      G_BUS_NAME_WATCHER_FLAGS_NONE,
-                                                      on_login1_appeared,
-                                                      on_login1_vanished,
-                                                      gself, nullptr);
-            self->m_watched_names.insert(tag);
-
-            tag = g_bus_watch_name_on_connection(bus,
-                                                 BUS_POWERD_NAME,
-                                                 G_BUS_NAME_WATCHER_FLAGS_NONE,
-                                                 on_powerd_appeared,
-                                                 on_powerd_vanished,
-                                                 gself, nullptr);
-            self->m_watched_names.insert(tag);
-
+            auto buses = std::make_shared<unity::indicator::bus::BusRegistry>(bus, nullptr);
+            static_cast<Impl*>(gself)->init_buses(buses);
             g_object_unref(bus);
         }
         else if (error != nullptr)
@@ -96,6 +81,23 @@ private:
         }
     }
 
+    void init_buses(const std::shared_ptr<unity::indicator::bus::BusRegistry>& buses)
+    {
+        m_buses = buses;
+
+        m_connections.push_back(m_buses->watch_name(G_BUS_TYPE_SYSTEM, "org.freedesktop.login1", [this](const std::string& owner){
+            on_login1_owner_changed(owner);
+        }));
+
+        m_connections.push_back(m_buses->watch_name(G_BUS_TYPE_SYSTEM, BUS_POWERD_NAME, [this](const std::string& owner){
+            on_powerd_owner_changed(owner);
+        }));
+
+        m_connections.push_back(m_buses->watch_name(G_BUS_TYPE_SYSTEM, BUS_SCREEN_NAME, [this](const std::string& owner){
+            on_screen_owner_changed(owner);
+        }));
+    }
+
     void remember_subscription(const std::string  & name,
                                GDBusConnection    * bus,
                                guint                tag)
@@ -116,30 +118,26 @@ private:
     ***  Fire Clock::minute_changed() signal on login1's PrepareForSleep signal
     **/
 
-    static void on_login1_appeared(GDBusConnection * bus,
-                                   const gchar     * name,
-                                   const gchar     * name_owner,
-                                   gpointer          gself)
+    void on_login1_owner_changed(const std::string& owner)
     {
+        const std::string name {"org.freedesktop.login1"};
+        m_subscriptions[name].clear();
+        if (owner.empty())
+            return;
+
+        auto bus = m_buses->system_bus();
         auto tag = g_dbus_connection_signal_subscribe(bus,
-                                                      name_owner,
+                                                      owner.c_str(),
                                                       "org.freedesktop.login1.Manager", // interface
                                                       "PrepareForSleep", // signal name
                                                       "/org/freedesktop/login1", // object path
                                                       nullptr, // arg0
                                                       G_DBUS_SIGNAL_FLAGS_NONE,
                                                       on_prepare_for_sleep,
-                                                      gself,
+                                                      this,
                                                       nullptr);
 
-        static_cast<Impl*>(gself)->remember_subscription(name, bus, tag);
-    }
-
-    static void on_login1_vanished(GDBusConnection * /*system_bus*/,
-                                   const gchar     * name,
-                                   gpointer          gself)
-    {
-      static_cast<Impl*>(gself)->m_subscriptions[name].clear();
+        remember_subscription(name, bus, tag);
     }
 
     static void on_prepare_for_sleep(GDBusConnection* /*connection*/,
@@ -161,31 +159,26 @@ private:
     ***  has awoken from sleep -- the old timestamp is likely out-of-date
     **/
 
-    static void on_powerd_appeared(GDBusConnection * bus,
-                                   const gchar     * name,
-                                   const gchar     * name_owner,
-                                   gpointer          gself)
+    void on_powerd_owner_changed(const std::string& owner)
     {
+        const std::string name {BUS_POWERD_NAME};
+        m_subscriptions[name].clear();
+        if (owner.empty())
+            return;
+
+        auto bus = m_buses->system_bus();
         auto tag = g_dbus_connection_signal_subscribe(bus,
-                                                      name_owner,
+                                                      owner.c_str(),
                                                       BUS_POWERD_INTERFACE,
                                                       "SysPowerStateChange",
                                                       BUS_POWERD_PATH,
                                                       nullptr, // arg0
                                                       G_DBUS_SIGNAL_FLAGS_NONE,
                                                       on_sys_power_state_change,
-                                                      gself, // user_data
+                                                      this, // user_data
                                                       nullptr); // user_data closure
 
-
-        static_cast<Impl*>(gself)->remember_subscription(name, bus, tag);
-    }
-
-    static void on_powerd_vanished(GDBusConnection * /*bus*/,
-                                   const gchar     * name,
-                                   gpointer          gself)
-    {
-        static_cast<Impl*>(gself)->m_subscriptions[name].clear();
+        remember_subscription(name, bus, tag);
     }
 
     static void on_sys_power_state_change(GDBusConnection* /*connection*/,
@@ -200,14 +193,65 @@ private:
         static_cast<Impl*>(gself)->m_owner.minute_changed();
     }
 
+    /**
+    ***  DBus Chatter: com.canonical.Unity.Screen
+    ***
+    ***  Track whether the display is on so that the clock can stop
+    ***  ticking while no one can see it
+    **/
+
+    void on_screen_owner_changed(const std::string& owner)
+    {
+        const std::string name {BUS_SCREEN_NAME};
+        m_subscriptions[name].clear();
+        if (owner.empty())
+        {
+            // without a screen service, assume someone's looking
+            m_owner.display_on.set(true);
+            return;
+        }
+
+        auto bus = m_buses->system_bus();
+        auto tag = g_dbus_connection_signal_subscribe(bus,
+                                                      owner.c_str(),
+                                                      BUS_SCREEN_INTERFACE,
+                                                      "DisplayPowerStateChange",
+                                                      BUS_SCREEN_PATH,
+                                                      nullptr, // arg0
+                                                      G_DBUS_SIGNAL_FLAGS_NONE,
+                                                      on_display_power_state_change,
+                                                      this, // user_data
+                                                      nullptr); // user_data closure
+
+        remember_subscription(name, bus, tag);
+    }
+
+    static void on_display_power_state_change(GDBusConnection* /*connection*/,
+                                              const gchar*     /*sender_name*/,
+                                              const gchar*     /*object_path*/,
+                                              const gchar*     /*interface_name*/,
+                                              const gchar*     /*signal_name*/,
+                                              GVariant*          parameters,
+                                              gpointer           gself)
+    {
+        gint32 state = 1;
+        gint32 reason = 0;
+        if (g_variant_is_of_type(parameters, G_VARIANT_TYPE("(ii)")))
+            g_variant_get(parameters, "(ii)", &state, &reason);
+
+        g_debug("display power state changed to %d (reason %d)", (int)state, (int)reason);
+        static_cast<Impl*>(gself)->m_owner.display_on.set(state != 0);
+    }
+
     /***
     ****
     ***/
 
     Clock& m_owner;
     GCancellable * m_cancellable = nullptr;
-    std::set<guint> m_watched_names;
+    std::shared_ptr<unity::indicator::bus::BusRegistry> m_buses;
     std::map<std::string,std::vector<std::shared_ptr<GDBusConnection>>> m_subscriptions;
+    std::vector<core::ScopedConnection> m_connections;
 };
 
 /***
@@ -215,7 +259,12 @@ private:
 ***/
 
 Clock::Clock():
-   m_impl(new Impl{*this})
+   Clock(nullptr)
+{
+}
+
+Clock::Clock(const std::shared_ptr<unity::indicator::bus::BusRegistry>& buses):
+   m_impl(new Impl{*this, buses})
 {
 }
 
@@ -18,6 +18,7 @@
  */
 
 #include <datetime/date-time.h>
+#include <datetime/timezone-registry.h>
 
 namespace unity {
 namespace indicator {
@@ -76,38 +77,30 @@ DateTime::DateTime(GTimeZone* gtz, time_t t)
 
 DateTime DateTime::NowLocal()
 {
-    auto gtz = g_time_zone_new_local();
-    auto gdt = g_date_time_new_now(gtz);
-    DateTime dt(gtz, gdt);
-    g_time_zone_unref(gtz);
+    auto gtz = TimezoneRegistry::instance().get_local();
+    auto gdt = g_date_time_new_now(gtz.get());
+    DateTime dt(gtz.get(), gdt);
     g_date_time_unref(gdt);
     return dt;
 }
 
 DateTime DateTime::Local(time_t t)
 {
-    auto gtz = g_time_zone_new_local();
-    auto gdt = g_date_time_new_from_unix_local(t);
-    DateTime dt(gtz, gdt);
-    g_time_zone_unref(gtz);
-    g_date_time_unref(gdt);
-    return dt;
+    auto gtz = TimezoneRegistry::instance().get_local();
+    return DateTime(gtz.get(), t);
 }
 
 DateTime DateTime::Local(int year, int month, int day, int hour, int minute, double seconds)
 {
-    auto gtz = g_time_zone_new_local();
-    DateTime dt(gtz, year, month, day, hour, minute, seconds);
-    g_time_zone_unref(gtz);
-    return dt;
+    auto gtz = TimezoneRegistry::instance().get_local();
+    return DateTime(gtz.get(), year, month, day, hour, minute, seconds);
 }
 
 DateTime DateTime::to_timezone(const std::string& zone) const
 {
-    auto gtz = g_time_zone_new(zone.c_str());
-    auto gdt = g_date_time_to_timezone(get(), gtz);
-    DateTime dt(gtz, gdt);
-    g_time_zone_unref(gtz);
+    auto gtz = TimezoneRegistry::instance().get(zone);
+    auto gdt = g_date_time_to_timezone(get(), gtz.get());
+    DateTime dt(gtz.get(), gdt);
     g_date_time_unref(gdt);
     return dt;
 }
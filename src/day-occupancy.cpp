@@ -0,0 +1,106 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+
+#include <datetime/day-occupancy.h>
+#include <datetime/appointment-index.h> // to_key(), to_day_key()
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****
+***/
+
+void DayOccupancy::set(const std::vector<Appointment>& appointments)
+{
+    // tally the new set by identity, computing days only for newcomers
+    std::map<Key,Entry> entries;
+    for (const auto& appointment : appointments)
+    {
+        const Key key(appointment.source_uid,
+                      appointment.uid,
+                      AppointmentIndex::to_key(appointment.begin),
+                      appointment.end.is_set() ? AppointmentIndex::to_key(appointment.end) : 0);
+
+        auto it = entries.find(key);
+        if (it != entries.end())
+        {
+            ++it->second.refs;
+            continue;
+        }
+
+        auto old = m_entries.find(key);
+        auto days = old != m_entries.end() ? old->second.days
+                                           : AppointmentIndex::to_day_keys(appointment);
+        entries.insert(std::make_pair(key, Entry{1, std::move(days)}));
+    }
+
+    // apply the difference between the old and new sets
+    for (const auto& kv : m_entries)
+    {
+        auto it = entries.find(kv.first);
+        const int refs = it != entries.end() ? it->second.refs : 0;
+        if (refs != kv.second.refs)
+            adjust(kv.second.days, refs - kv.second.refs);
+    }
+    for (const auto& kv : entries)
+        if (!m_entries.count(kv.first))
+            adjust(kv.second.days, kv.second.refs);
+
+    m_entries.swap(entries);
+}
+
+void DayOccupancy::adjust(const std::vector<int>& days, int delta)
+{
+    for (const auto& day : days)
+    {
+        auto& count = m_counts[day];
+        count += delta;
+        if (count <= 0)
+            m_counts.erase(day);
+    }
+}
+
+int DayOccupancy::count(const DateTime& day) const
+{
+    const auto it = m_counts.find(AppointmentIndex::to_day_key(day));
+    return it != m_counts.end() ? it->second : 0;
+}
+
+uint32_t DayOccupancy::month_bitmap(const DateTime& month) const
+{
+    int year=0, mon=0, day=0;
+    month.ymd(year, mon, day);
+    const int first = year*10000 + mon*100;
+
+    uint32_t bitmap = 0;
+    for (auto it=m_counts.lower_bound(first), end=m_counts.lower_bound(first+100); it!=end; ++it)
+        bitmap |= uint32_t(1) << (it->first - first);
+    return bitmap;
+}
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
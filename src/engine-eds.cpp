@@ -18,19 +18,25 @@
  */
 
 #include <datetime/engine-eds.h>
+#include <datetime/arena.h>
 #include <datetime/myself.h>
+#include <datetime/recurrence-cache.h>
+#include <datetime/timezone-registry.h>
 
 #include <libical/ical.h>
 #include <libical/icaltime.h>
 #include <libecal/libecal.h>
 #include <libedataserver/libedataserver.h>
 
-#include <algorithm> // std::sort()
+#include <algorithm> // std::sort(), std::stable_sort()
 #include <array>
 #include <ctime> // time()
 #include <cstring> // strstr(), strlen()
 #include <map>
 #include <set>
+#include <string>
+#include <tuple>
+#include <vector>
 
 namespace unity {
 namespace indicator {
@@ -49,23 +55,28 @@ class EdsEngine::Impl
 {
 public:
 
-    Impl(const std::shared_ptr<Myself> &myself)
+    Impl(const std::shared_ptr<Myself> &myself, bool threaded)
         : m_myself(myself)
     {
-        auto cancellable_deleter = [](GCancellable * c) {
-            g_cancellable_cancel(c);
-            g_clear_object(&c);
-        };
-
-        m_cancellable = std::shared_ptr<GCancellable>(g_cancellable_new(), cancellable_deleter);
+        m_cancellable = create_cancellable();
+        if (threaded)
+            m_convert_pool = g_thread_pool_new(convert_in_worker, nullptr, int(g_get_num_processors()), FALSE, nullptr);
         e_source_registry_new(m_cancellable.get(), on_source_registry_ready, this);
-        m_myself->emails().changed().connect([this](const std::set<std::string> &) {
-            set_dirty_soon();
+        m_my_emails = m_myself->emails().get();
+        m_myself->emails().changed().connect([this](const std::set<std::string>& emails) {
+            on_my_emails_changed(emails);
         });
     }
 
     ~Impl()
     {
+        // subtasks share the cancellables, so cancel them explicitly
+        // to tell their pending callbacks that we're gone
+        g_cancellable_cancel(m_cancellable.get());
+        for (auto& kv : m_client_cancellables)
+            g_cancellable_cancel(kv.second.get());
+        if (m_convert_pool != nullptr)
+            g_thread_pool_free(m_convert_pool, FALSE, TRUE);
         m_cancellable.reset();
 
         while(!m_sources.empty())
@@ -74,6 +85,11 @@ public:
         if (m_rebuild_tag)
             g_source_remove(m_rebuild_tag);
 
+        if (m_disable_tag)
+            g_source_remove(m_disable_tag);
+
+        g_clear_pointer(&m_trigger_scans, g_key_file_free);
+
         if (m_source_registry)
             g_signal_handlers_disconnect_by_data(m_source_registry, this);
         g_clear_object(&m_source_registry);
@@ -87,7 +103,8 @@ public:
     void get_appointments(const DateTime& begin,
                           const DateTime& end,
                           const Timezone& timezone,
-                          std::function<void(const std::vector<Appointment>&)> func)
+                          std::function<void(const std::vector<Appointment>&)> func,
+                          bool alarms_only = false)
     {
         const auto b_str = begin.format("%F %T");
         const auto e_str = end.format("%F %T");
@@ -100,7 +117,7 @@ public:
         const auto tz = timezone.timezone.get().c_str();
         auto gtz = timezone_from_name(tz, nullptr, nullptr, &default_timezone);
         if (gtz == nullptr) {
-            gtz = g_time_zone_new_local();
+            gtz = g_time_zone_ref(TimezoneRegistry::instance().get_local().get());
         }
 
         g_debug("default_timezone is %s", default_timezone ? icaltimezone_get_display_name(default_timezone) : "null");
@@ -109,14 +126,24 @@ public:
         ***  walk through the sources to build the appointment list
         **/
 
-        auto main_task = std::make_shared<Task>(this, func, default_timezone, gtz, begin, end);
+        auto main_task = std::make_shared<Task>(this, func, default_timezone, gtz, begin, end, m_my_emails, m_generation);
+
+        // we expand the recurring series ourselves, so get all of them
+        // along with their detached instances, and the one-time
+        // components that fall inside the window. If we only want
+        // alarms, let EDS skip the one-time components without any.
+        auto b_iso = isodate_from_time_t(begin.to_unix());
+        auto e_iso = isodate_from_time_t(end.to_unix());
+        auto sexp = g_strdup_printf("(or (has-recurrences?) (%s (make-time \"%s\") (make-time \"%s\")))",
+                                    alarms_only ? "has-alarms-in-range?" : "occur-in-time-range?",
+                                    b_iso, e_iso);
 
         for (auto& kv : m_clients)
         {
             auto& client = kv.second;
             if (default_timezone != nullptr)
                 e_cal_client_set_default_timezone(client, default_timezone);
-            g_debug("calling e_cal_client_generate_instances for %p", (void*)client);
+            g_debug("fetching the components for %p", (void*)client);
 
             auto& source = kv.first;
             auto extension = e_source_get_extension(source, E_SOURCE_EXTENSION_CALENDAR);
@@ -127,37 +154,175 @@ public:
             }
             const auto color = e_source_selectable_get_color(E_SOURCE_SELECTABLE(extension));
 
-            e_cal_client_generate_instances(
+            // if the source goes away, its subtasks are cancelled
+            auto cit = m_client_cancellables.find(source);
+            const auto& cancellable = cit != m_client_cancellables.end() ? cit->second : m_cancellable;
+
+            e_cal_client_get_object_list_as_comps(
                 client,
-                begin.to_unix(),
-                end.to_unix(),
-                m_cancellable.get(),
-                on_event_generated,
-                new ClientSubtask(main_task, client, m_cancellable, color),
-                on_event_generated_list_ready);
+                sexp,
+                cancellable.get(),
+                on_object_list_ready,
+                new ClientSubtask(main_task, client, cancellable, color, alarms_only));
         }
+
+        g_free(sexp);
+        g_free(e_iso);
+        g_free(b_iso);
+    }
+
+    void disable_ubuntu_alarms(const std::vector<Appointment>& appointments)
+    {
+        // batch them up: several alarms often fire in the same minute,
+        // and an appointment with multiple valarms fires once per valarm
+        for (const auto& appointment : appointments)
+            if (appointment.is_ubuntu_alarm())
+                m_pending_disables[appointment.source_uid].insert(appointment.uid);
+
+        if (!m_pending_disables.empty() && !m_disable_tag)
+            m_disable_tag = g_idle_add(on_disable_idle, this);
+    }
+
+private:
+
+    // a cancellable that is cancelled when its last holder lets go, if not sooner
+    static std::shared_ptr<GCancellable> create_cancellable()
+    {
+        auto deleter = [](GCancellable * c) {
+            g_cancellable_cancel(c);
+            g_clear_object(&c);
+        };
+
+        return std::shared_ptr<GCancellable>(g_cancellable_new(), deleter);
+    }
+
+    static gboolean on_disable_idle(gpointer gself)
+    {
+        auto self = static_cast<Impl*>(gself);
+        self->m_disable_tag = 0;
+        self->flush_pending_disables();
+        return G_SOURCE_REMOVE;
     }
 
-    void disable_ubuntu_alarm(const Appointment& appointment)
+    void flush_pending_disables()
     {
-        if (appointment.is_ubuntu_alarm())
+        std::map<std::string,std::set<std::string>> pending;
+        pending.swap(m_pending_disables);
+
+        // only ask the client that owns each alarm
+        std::map<ECalClient*,std::set<std::string>> client_uids;
+        for (const auto& kv : pending)
+            for (auto& client : get_clients_for_source_uid(kv.first))
+                client_uids[client].insert(kv.second.begin(), kv.second.end());
+
+        // fetch the components, then write them back in one batch per client
+        for (const auto& kv : client_uids)
         {
-            for (auto& kv : m_clients) // find the matching icalcomponent
+            auto batch = new DisableBatch(kv.first, m_cancellable, kv.second.size());
+            for (const auto& uid : kv.second)
             {
-                e_cal_client_get_object(kv.second,
-                                        appointment.uid.c_str(),
+                e_cal_client_get_object(kv.first,
+                                        uid.c_str(),
                                         nullptr,
                                         m_cancellable.get(),
                                         on_object_ready_for_disable,
-                                        this);
+                                        batch);
             }
         }
     }
 
-private:
+    std::vector<ECalClient*> get_clients_for_source_uid(const std::string& source_uid)
+    {
+        std::vector<ECalClient*> clients;
+
+        if (source_uid.empty()) // unknown owner, so ask everyone
+        {
+            for (auto& kv : m_clients)
+                clients.push_back(kv.second);
+        }
+        else if (m_source_registry != nullptr)
+        {
+            auto source = e_source_registry_ref_source(m_source_registry, source_uid.c_str());
+            if (source != nullptr)
+            {
+                auto it = m_clients.find(source);
+                if (it != m_clients.end())
+                    clients.push_back(it->second);
+                g_object_unref(source);
+            }
+        }
+
+        return clients;
+    }
+
+    /***
+    ****  Attendees
+    ***/
+
+    struct Attendee
+    {
+        std::string email;
+        bool declined;
+    };
+
+    // source uid, component uid, recurrence-id (0 if none)
+    typedef std::tuple<std::string,std::string,time_t> ComponentKey;
+    typedef std::map<ComponentKey,std::vector<Attendee>> AttendeeMap;
+
+    // the first of the attendees that's one of us decides whether we declined
+    static bool is_declined(const std::vector<Attendee>& attendees,
+                            const std::set<std::string>& my_emails)
+    {
+        for (const auto& attendee : attendees)
+            if (my_emails.count(attendee.email))
+                return attendee.declined;
+
+        return false;
+    }
+
+    void on_my_emails_changed(const std::set<std::string>& emails)
+    {
+        // only components with attendees depend on who we are, and of
+        // those only the ones whose declined status flips need a rebuild
+        bool dirty = false;
+        for (const auto& kv : m_attendees)
+        {
+            if (is_declined(kv.second, m_my_emails) != is_declined(kv.second, emails))
+            {
+                dirty = true;
+                break;
+            }
+        }
+
+        m_my_emails = emails;
+
+        if (dirty)
+            set_dirty_soon();
+        else
+            g_debug("%s emails changed, but no attendee's status changed", G_STRLOC);
+    }
+
+    // every planner re-queries when we emit changed(), so the queries
+    // of a newer rebuild replace what we knew and the queries of the
+    // same rebuild add to it. Results from an older rebuild are stale.
+    void merge_attendees(unsigned int generation, AttendeeMap& attendees)
+    {
+        if (generation < m_attendees_generation)
+            return;
+
+        if (m_attendees_generation < generation)
+        {
+            m_attendees.clear();
+            m_attendees_generation = generation;
+        }
+
+        for (auto& kv : attendees)
+            m_attendees[kv.first].swap(kv.second);
+    }
 
     void set_dirty_now()
     {
+        ++m_generation;
         m_changed();
     }
 
@@ -290,6 +455,7 @@ private:
             auto source = e_client_get_source(client);
             auto ecc = E_CAL_CLIENT(client);
             self->m_clients[source] = ecc;
+            self->m_client_cancellables[source] = create_cancellable();
 
             self->ensure_client_alarms_have_triggers(ecc);
 
@@ -334,15 +500,19 @@ private:
         }
     }
 
-    static void on_view_objects_added(ECalClientView* /*view*/, gpointer /*objects*/, gpointer gself)
+    static void on_view_objects_added(ECalClientView* view, gpointer objects, gpointer gself)
     {
         g_debug("%s", G_STRFUNC);
-        static_cast<Impl*>(gself)->set_dirty_soon();
+        auto self = static_cast<Impl*>(gself);
+        self->ensure_view_alarms_have_triggers(view, static_cast<const GSList*>(objects));
+        self->set_dirty_soon();
     }
-    static void on_view_objects_modified(ECalClientView* /*view*/, gpointer /*objects*/, gpointer gself)
+    static void on_view_objects_modified(ECalClientView* view, gpointer objects, gpointer gself)
     {
         g_debug("%s", G_STRFUNC);
-        static_cast<Impl*>(gself)->set_dirty_soon();
+        auto self = static_cast<Impl*>(gself);
+        self->ensure_view_alarms_have_triggers(view, static_cast<const GSList*>(objects));
+        self->set_dirty_soon();
     }
     static void on_view_objects_removed(ECalClientView* /*view*/, gpointer /*objects*/, gpointer gself)
     {
@@ -369,6 +539,16 @@ private:
             set_dirty_soon();
         }
 
+        m_recurrences.clear(e_source_get_uid(source));
+
+        // cancel the subtasks that are still working on this source's components
+        auto ccit = m_client_cancellables.find(source);
+        if (ccit != m_client_cancellables.end())
+        {
+            g_cancellable_cancel(ccit->second.get());
+            m_client_cancellables.erase(ccit);
+        }
+
         // if an ECalClient is associated with this source, remove it
         auto cit = m_clients.find(source);
         if (cit != m_clients.end())
@@ -409,28 +589,75 @@ private:
 
     // old ubuntu-clock-app alarms created VTODO VALARMS without the
     // required 'TRIGGER' property... http://pad.lv/1465806
+    //
+    // Scanning for them means pulling every alarm over D-Bus, so we
+    // remember each source's revision once it's clean and only rescan
+    // when the revision changes. Alarms that get added or modified
+    // while we're running are repaired from the view's payload instead.
+
+    struct TriggerScan
+    {
+        Impl* p;
+        std::string source_uid;
+        std::string revision;
+    };
 
     void ensure_client_alarms_have_triggers(ECalClient* client)
     {
-        // ask the EDS server for all the ubuntu-clock-app alarms...
+        e_client_get_backend_property(E_CLIENT(client),
+                                      CLIENT_BACKEND_PROPERTY_REVISION,
+                                      m_cancellable.get(),
+                                      on_client_revision_ready,
+                                      this);
+    }
 
-        auto sexp = g_strdup_printf("has-categories? '%s'", TAG_ALARM);
+    static void on_client_revision_ready(GObject      * oclient,
+                                         GAsyncResult * res,
+                                         gpointer       gself)
+    {
+        auto client = E_CLIENT(oclient);
+        GError * error = nullptr;
+        gchar * revision = nullptr;
+
+        e_client_get_backend_property_finish(client, res, &revision, &error);
+        if (error != nullptr)
+        {
+            const bool cancelled = g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+            if (!cancelled)
+                g_warning("can't get calendar revision: %s", error->message);
+            g_error_free(error);
+            if (cancelled)
+                return;
+        }
+
+        auto self = static_cast<Impl*>(gself);
+        auto scan = new TriggerScan{self, e_source_get_uid(e_client_get_source(client)), revision ? revision : ""};
+        g_free(revision);
+
+        if (!scan->revision.empty() && (scan->revision == self->get_trigger_scan_revision(scan->source_uid)))
+        {
+            g_debug("%s alarms in %s already have triggers; skipping scan", G_STRLOC, scan->source_uid.c_str());
+            delete scan;
+            return;
+        }
 
+        // ask the EDS server for all the ubuntu-clock-app alarms...
+        auto sexp = g_strdup_printf("has-categories? '%s'", TAG_ALARM);
         e_cal_client_get_object_list_as_comps(
-            client,
+            E_CAL_CLIENT(client),
             sexp,
-            m_cancellable.get(),
+            self->m_cancellable.get(),
             ensure_client_alarms_have_triggers_async_cb,
-            this);
-
+            scan);
         g_clear_pointer(&sexp, g_free);
     }
 
     static void ensure_client_alarms_have_triggers_async_cb(
         GObject      * oclient,
         GAsyncResult * res,
-        gpointer       gself)
+        gpointer       gscan)
     {
+        auto scan = static_cast<TriggerScan*>(gscan);
         ECalClient * client = E_CAL_CLIENT(oclient);
         GError * error = nullptr;
         GSList * components = nullptr;
@@ -440,8 +667,13 @@ private:
                                                          &components,
                                                          &error))
         {
-            auto self = static_cast<Impl*>(gself);
-            self->ensure_canonical_alarms_have_triggers(client, components);
+            auto self = scan->p;
+
+            // if nothing needed fixing, the source is clean as of this revision.
+            // if something did, fixing it bumps the revision so we'll look once more.
+            if (!self->ensure_canonical_alarms_have_triggers(client, components) && !scan->revision.empty())
+                self->set_trigger_scan_revision(scan->source_uid, scan->revision);
+
             e_cal_client_free_ecalcomp_slist(components);
         }
         else if (error != nullptr)
@@ -451,9 +683,108 @@ private:
 
             g_error_free(error);
         }
+
+        delete scan;
+    }
+
+    // repair any clock-app alarms in a view's objects-added or objects-modified payload
+    void ensure_view_alarms_have_triggers(ECalClientView* view, const GSList* icalcomponents)
+    {
+        ECalClient* client = nullptr;
+        for (const auto& kv : m_views)
+            if (kv.second == view)
+                client = m_clients.count(kv.first) ? m_clients[kv.first] : nullptr;
+        if (client == nullptr)
+            return;
+
+        GSList* components = nullptr;
+        for (auto l=icalcomponents; l!=nullptr; l=l->next)
+        {
+            auto icc = static_cast<icalcomponent*>(l->data);
+            if (!has_category(icc, TAG_ALARM))
+                continue;
+
+            auto component = e_cal_component_new_from_icalcomponent(icalcomponent_new_clone(icc));
+            if (component != nullptr)
+                components = g_slist_prepend(components, component);
+        }
+
+        ensure_canonical_alarms_have_triggers(client, components);
+        e_cal_client_free_ecalcomp_slist(components);
+    }
+
+    static bool has_category(icalcomponent* icc, const char* category)
+    {
+        for (auto prop = icalcomponent_get_first_property(icc, ICAL_CATEGORIES_PROPERTY);
+             prop != nullptr;
+             prop = icalcomponent_get_next_property(icc, ICAL_CATEGORIES_PROPERTY))
+        {
+            if (!g_strcmp0(icalproperty_get_categories(prop), category))
+                return true;
+        }
+
+        return false;
+    }
+
+    /**
+     * The scan markers live in a keyfile in the user's cache dir,
+     * mapping each source's uid to the revision that was last found clean.
+     */
+
+    static std::string get_trigger_scan_filename()
+    {
+        auto filename = g_build_filename(g_get_user_cache_dir(), "indicator-datetime", "alarm-triggers.ini", nullptr);
+        std::string ret = filename;
+        g_free(filename);
+        return ret;
+    }
+
+    GKeyFile* get_trigger_scan_keyfile()
+    {
+        if (m_trigger_scans == nullptr)
+        {
+            m_trigger_scans = g_key_file_new();
+            g_key_file_load_from_file(m_trigger_scans, get_trigger_scan_filename().c_str(), G_KEY_FILE_NONE, nullptr);
+        }
+
+        return m_trigger_scans;
+    }
+
+    std::string get_trigger_scan_revision(const std::string& source_uid)
+    {
+        std::string ret;
+
+        auto str = g_key_file_get_string(get_trigger_scan_keyfile(), "revisions", source_uid.c_str(), nullptr);
+        if (str != nullptr)
+            ret = str;
+        g_free(str);
+
+        return ret;
+    }
+
+    void set_trigger_scan_revision(const std::string& source_uid, const std::string& revision)
+    {
+        auto keyfile = get_trigger_scan_keyfile();
+        g_key_file_set_string(keyfile, "revisions", source_uid.c_str(), revision.c_str());
+
+        const auto filename = get_trigger_scan_filename();
+        auto dirname = g_path_get_dirname(filename.c_str());
+        g_mkdir_with_parents(dirname, 0700);
+        g_free(dirname);
+
+        gsize length = 0;
+        auto data = g_key_file_to_data(keyfile, &length, nullptr);
+        GError* error = nullptr;
+        if (!g_file_set_contents(filename.c_str(), data, length, &error))
+        {
+            g_warning("couldn't save '%s': %s", filename.c_str(), error->message);
+            g_error_free(error);
+        }
+        g_free(data);
     }
 
-    void ensure_canonical_alarms_have_triggers(ECalClient * client,
+    // returns true if any of the components needed fixing
+    bool ensure_canonical_alarms_have_triggers(ECalClient * client,
                                                GSList     * components)
     {
         GSList * modify_slist = nullptr;
@@ -505,7 +836,10 @@ private:
                                         this);
 
             g_clear_pointer(&modify_slist, g_slist_free);
+            return true;
         }
+
+        return false;
     }
 
     // log a warning if e_cal_client_modify_objects() failed
@@ -534,6 +868,11 @@ private:
 
     typedef std::function<void(const std::vector<Appointment>&)> appointment_func;
 
+    struct CStrLess
+    {
+        bool operator()(const char* a, const char* b) const { return strcmp(a, b) < 0; }
+    };
+
     struct Task
     {
         Impl* p;
@@ -543,22 +882,31 @@ private:
         std::vector<Appointment> appointments;
         const DateTime begin;
         const DateTime end;
+        const std::set<std::string> my_emails; // a snapshot for the workers
+        const unsigned int generation; // the rebuild that this query belongs to
+        GMainContext* main_context; // where the results are handed back
 
         Task(Impl* p_in,
              appointment_func func_in,
              icaltimezone* tz_in,
              GTimeZone* gtz_in,
              const DateTime& begin_in,
-             const DateTime& end_in):
+             const DateTime& end_in,
+             const std::set<std::string>& my_emails_in,
+             unsigned int generation_in):
                  p{p_in},
                  func{func_in},
                  default_timezone{tz_in},
                  gtz{gtz_in},
                  begin{begin_in},
-                 end{end_in} {}
+                 end{end_in},
+                 my_emails{my_emails_in},
+                 generation{generation_in},
+                 main_context{g_main_context_ref_thread_default()} {}
 
         ~Task() {
             g_clear_pointer(&gtz, g_time_zone_unref);
+            g_main_context_unref(main_context);
             // give the caller the sorted finished product
             auto& a = appointments;
             std::sort(a.begin(), a.end(), [](const Appointment& a, const Appointment& b){return a.begin < b.begin;});
@@ -566,30 +914,71 @@ private:
         };
     };
 
+    // a component and its start time, computed once when it's collected
+    struct Instance
+    {
+        time_t begin;
+        ECalComponent* component; // we hold a ref
+    };
+
     struct ClientSubtask
     {
         std::shared_ptr<Task> task;
         ECalClient* client;
+        std::string source_uid;
         std::shared_ptr<GCancellable> cancellable;
         std::string color;
-        GList *components;
-        GList *instance_components;
-        std::set<std::string> parent_components;
+        bool alarms_only;
+        Arena arena; // scratch space that's freed when the subtask is done
+        ArenaVector<Instance> components; // one-time components
+        ArenaVector<Instance> instance_components; // instances of recurring series
+
+        // where the conversion left off, so that it can be resumed
+        enum class Stage { InstanceAlarms, ComponentAlarms, Events, Done };
+        Stage stage {Stage::InstanceAlarms};
+        size_t next {};
+
+        // the conversion's results, merged into the task on the main thread
+        std::vector<Appointment> appointments;
+        AttendeeMap attendees; // only the components that have any
+
+        // every TZID that the components use, looked up on the main thread
+        // so that the conversion never has to ask EDS or load a zone
+        struct Zone
+        {
+            icaltimezone* zone; // owned by libical or the client; null if unknown
+            GTimeZone* gtz; // we hold a ref; null if unknown
+        };
+        std::map<std::string,Zone> zones;
 
         ClientSubtask(const std::shared_ptr<Task>& task_in,
                       ECalClient* client_in,
                       const std::shared_ptr<GCancellable>& cancellable_in,
-                      const char* color_in):
+                      const char* color_in,
+                      bool alarms_only_in):
             task(task_in),
-            client(client_in),
+            client(E_CAL_CLIENT(g_object_ref(client_in))),
+            source_uid(e_source_get_uid(e_client_get_source(E_CLIENT(client_in)))),
             cancellable(cancellable_in),
-            components(nullptr),
-            instance_components(nullptr)
+            alarms_only(alarms_only_in),
+            components(ArenaAllocator<Instance>(arena)),
+            instance_components(ArenaAllocator<Instance>(arena))
         {
             if (color_in)
                 color = color_in;
 
         }
+
+        ~ClientSubtask()
+        {
+            for (auto& instance : components)
+                g_object_unref(instance.component);
+            for (auto& instance : instance_components)
+                g_object_unref(instance.component);
+            for (auto& kv : zones)
+                g_clear_pointer(&kv.second.gtz, g_time_zone_unref);
+            g_clear_object(&client);
+        }
     };
 
     static std::string get_alarm_text(ECalComponentAlarm * alarm)
@@ -637,111 +1026,389 @@ private:
         return ret;
     }
 
+    static void
+    on_object_list_ready(GObject      * oclient,
+                         GAsyncResult * res,
+                         gpointer       gsubtask)
+    {
+        auto subtask = static_cast<ClientSubtask*>(gsubtask);
+
+        GError * error = nullptr;
+        GSList * comps = nullptr;
+        if (e_cal_client_get_object_list_as_comps_finish(E_CAL_CLIENT(oclient), res, &comps, &error))
+        {
+            auto p = subtask->task->p;
+            resolve_zones(subtask, comps);
+            p->expand_components(subtask, comps);
+            e_cal_client_free_ecalcomp_slist(comps);
+
+            if (p->m_convert_pool != nullptr)
+            {
+                // build the appointments off the main loop
+                g_thread_pool_push(p->m_convert_pool, subtask, nullptr);
+            }
+            else
+            {
+                // build them a slice at a time between the main loop's other events
+                auto source = g_idle_source_new();
+                g_source_set_callback(source, convert_in_slices, subtask, nullptr);
+                g_source_attach(source, subtask->task->main_context);
+                g_source_unref(source);
+            }
+            return;
+        }
+
+        if (error != nullptr)
+        {
+            if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+                g_warning("indicator-datetime cannot get components: %s", error->message);
+
+            g_error_free(error);
+        }
+
+        delete subtask;
+    }
+
+    static void
+    convert_in_worker(gpointer gsubtask, gpointer /*unused*/)
+    {
+        auto subtask = static_cast<ClientSubtask*>(gsubtask);
+
+        // no point in converting a source that's gone
+        if (g_cancellable_is_cancelled(subtask->cancellable.get()))
+            subtask->stage = ClientSubtask::Stage::Done;
+
+        // keep anything that EDS dispatches while we work out of the main loop
+        auto context = g_main_context_new();
+        g_main_context_push_thread_default(context);
+        convert_components(subtask, G_MAXINT64);
+        g_main_context_pop_thread_default(context);
+        g_main_context_unref(context);
+
+        g_main_context_invoke(subtask->task->main_context, on_subtask_converted, subtask);
+    }
+
+    static gboolean
+    convert_in_slices(gpointer gsubtask)
+    {
+        auto subtask = static_cast<ClientSubtask*>(gsubtask);
+
+        // no point in finishing if nobody's waiting for the results
+        if (g_cancellable_is_cancelled(subtask->cancellable.get()))
+            subtask->stage = ClientSubtask::Stage::Done;
+
+        if (!convert_components(subtask, g_get_monotonic_time() + SLICE_USEC))
+            return G_SOURCE_CONTINUE;
+
+        // the task's appointments aren't handed to the planner until its
+        // last subtask is done, so partial results are never visible
+        return on_subtask_converted(subtask);
+    }
+
+    // back on the main thread, fold a subtask's results into its task
     static gboolean
-    on_event_generated(ECalComponent *comp,
-                       time_t,
-                       time_t,
-                       gpointer gsubtask)
+    on_subtask_converted(gpointer gsubtask)
     {
         auto subtask = static_cast<ClientSubtask*>(gsubtask);
-        const gchar *uid = nullptr;
-        e_cal_component_get_uid (comp, &uid);
-        g_object_ref(comp);
-
-        if (e_cal_component_is_instance(comp) && (uid != nullptr)) {
-            subtask->parent_components.insert(std::string(uid));
-            subtask->instance_components = g_list_append(subtask->instance_components, comp);
-        } else {
-            subtask->components = g_list_append(subtask->components, comp);
+
+        // if its source is gone or we are, drop the results
+        if (!g_cancellable_is_cancelled(subtask->cancellable.get()))
+        {
+            subtask->task->p->merge_attendees(subtask->task->generation, subtask->attendees);
+
+            auto& a = subtask->task->appointments;
+            a.insert(a.end(), subtask->appointments.begin(), subtask->appointments.end());
         }
-        return TRUE;
+
+        delete subtask; // the task finishes when its last subtask is deleted
+        return G_SOURCE_REMOVE;
     }
 
+    /**
+     * Look up every TZID that the components use, and have libical fill in
+     * the zones' transitions now. It does both lazily and without locking,
+     * and looking up a zone that isn't builtin is a D-Bus call to EDS,
+     * so none of this can happen in the workers.
+     */
     static void
-    merge_detached_instances(ClientSubtask *subtask, GSList *instances)
-    {
-        for (GSList *i=instances; i!=nullptr; i=i->next) {
-            auto instance = static_cast<ECalComponent*>(i->data);
-            auto instance_id = e_cal_component_get_id(instance);
-            for (GList *c=subtask->instance_components ; c!= nullptr; c=c->next) {
-                auto component = static_cast<ECalComponent*>(c->data);
-                auto component_id = e_cal_component_get_id(component);
-                bool found = false;
-
-                if (e_cal_component_id_equal(instance_id, component_id)) {
-                    // replaces virtual instance with the real one
-                    g_object_unref(component);
-                    c->data = g_object_ref(instance);
-                    found = true;
-                }
-                e_cal_component_free_id(component_id);
-                if (found)
-                    break;
+    resolve_zones(ClientSubtask * subtask, GSList * comps)
+    {
+        // cover the window and then some, eg for alarms ahead of their occurrences
+        auto until = icaltime_from_timet_with_zone(subtask->task->end.to_unix(), false, icaltimezone_get_utc_timezone());
+        until.year += 1;
+        auto warm = [&until](icaltimezone* zone){
+            if (zone != nullptr) {
+                auto t = until;
+                icaltimezone_get_utc_offset(zone, &t, nullptr);
+            }
+        };
+
+        auto add = [subtask, &warm](const char* tzid){
+            if (subtask->zones.count(tzid))
+                return;
+            ClientSubtask::Zone zone {};
+            zone.gtz = timezone_from_name(tzid, subtask->client, subtask->cancellable.get(), &zone.zone);
+            warm(zone.zone);
+            subtask->zones[tzid] = zone;
+        };
+
+        // libecal gives UTC times a TZID of "UTC" even though they have no TZID parameter
+        add("UTC");
+        warm(subtask->task->default_timezone);
+
+        std::function<void(icalcomponent*)> collect = [&collect, &add](icalcomponent* icc){
+            for (auto prop = icalcomponent_get_first_property(icc, ICAL_ANY_PROPERTY);
+                 prop != nullptr;
+                 prop = icalcomponent_get_next_property(icc, ICAL_ANY_PROPERTY))
+            {
+                auto param = icalproperty_get_first_parameter(prop, ICAL_TZID_PARAMETER);
+                const char* tzid = param ? icalparameter_get_tzid(param) : nullptr;
+                if (tzid != nullptr)
+                    add(tzid);
+            }
+
+            for (auto child = icalcomponent_get_first_component(icc, ICAL_ANY_COMPONENT);
+                 child != nullptr;
+                 child = icalcomponent_get_next_component(icc, ICAL_ANY_COMPONENT))
+                collect(child);
+        };
+
+        for (auto l=comps; l!=nullptr; l=l->next)
+            collect(e_cal_component_get_icalcomponent(static_cast<ECalComponent*>(l->data)));
+    }
+
+    // a zone that resolve_zones() found, or null
+    static const ClientSubtask::Zone*
+    find_zone(const ClientSubtask * subtask, const char * tzid)
+    {
+        if (tzid == nullptr)
+            return nullptr;
+
+        auto it = subtask->zones.find(tzid);
+        return it != subtask->zones.end() ? &it->second : nullptr;
+    }
+
+    // the resolver that the workers give to libecal instead of e_cal_client_resolve_tzid_cb()
+    static icaltimezone*
+    resolve_tzid(const char * tzid, gpointer gsubtask)
+    {
+        auto zone = find_zone(static_cast<ClientSubtask*>(gsubtask), tzid);
+        return zone ? zone->zone : nullptr;
+    }
+
+    // the zone that a date property's wall-clock time is in
+    static icaltimezone*
+    get_property_zone(ClientSubtask  * subtask,
+                      icalproperty   * prop,
+                      const struct icaltimetype& t)
+    {
+        if (icaltime_is_utc(t))
+            return icaltimezone_get_utc_timezone();
+
+        icaltimezone* zone = nullptr;
+        auto param = prop ? icalproperty_get_first_parameter(prop, ICAL_TZID_PARAMETER) : nullptr;
+        auto found = param ? find_zone(subtask, icalparameter_get_tzid(param)) : nullptr;
+        if (found != nullptr)
+            zone = found->zone;
+
+        if (zone == nullptr) // floating, or a tzid that we couldn't find
+            zone = subtask->task->default_timezone;
+
+        return zone ? zone : icaltimezone_get_utc_timezone();
+    }
+
+    // build the instance of a series that starts at the given occurrence
+    static ECalComponent*
+    create_instance(icalcomponent* master, const RecurrenceCache::Occurrence& occurrence)
+    {
+        auto icc = icalcomponent_new_clone(master);
+
+        // instances don't recur
+        const icalproperty_kind kinds[] = { ICAL_RRULE_PROPERTY, ICAL_RDATE_PROPERTY,
+                                            ICAL_EXDATE_PROPERTY, ICAL_EXRULE_PROPERTY };
+        for (const auto& kind : kinds)
+        {
+            icalproperty* prop;
+            while ((prop = icalcomponent_get_first_property(icc, kind)))
+            {
+                icalcomponent_remove_property(icc, prop);
+                icalproperty_free(prop);
             }
-            e_cal_component_free_id (instance_id);
         }
+
+        auto dtstart = icalcomponent_get_first_property(icc, ICAL_DTSTART_PROPERTY);
+        icalproperty_set_dtstart(dtstart, occurrence.begin);
+
+        auto dtend = icalcomponent_get_first_property(icc, ICAL_DTEND_PROPERTY);
+        if (dtend != nullptr)
+            icalproperty_set_dtend(dtend, occurrence.end);
+
+        auto rid = icalproperty_new_recurrenceid(occurrence.begin);
+        auto tzid = icalproperty_get_first_parameter(dtstart, ICAL_TZID_PARAMETER);
+        if (tzid != nullptr)
+            icalproperty_add_parameter(rid, icalparameter_new_clone(tzid));
+        icalcomponent_add_property(icc, rid);
+
+        return e_cal_component_new_from_icalcomponent(icc); // takes ownership of icc
     }
 
-    static void
-    fetch_detached_instances(GObject *,
-                              GAsyncResult *res,
-                              gpointer gsubtask)
+    /**
+     * Sort the client's components into the subtask's lists:
+     * one-time components go into subtask->components as-is,
+     * recurring series are expanded by m_recurrences into instances,
+     * and detached instances replace the occurrences that they override.
+     */
+    void
+    expand_components(ClientSubtask * subtask, GSList * comps)
     {
-        auto subtask = static_cast<ClientSubtask*>(gsubtask);
-        if (res) {
-            GError *error = nullptr;
-            GSList *comps = nullptr;
-            e_cal_client_get_objects_for_uid_finish(subtask->client,
-                                                    res,
-                                                    &comps,
-                                                    &error);
-            if (error) {
-                g_warning("Fail to retrieve detached instances: %s", error->message);
-                g_error_free(error);
-            } else {
-                merge_detached_instances(subtask, comps);
-                e_cal_client_free_ecalcomp_slist(comps);
+        const auto& source_uid = subtask->source_uid;
+        const auto begin = subtask->task->begin.to_unix();
+        const auto end = subtask->task->end.to_unix();
+
+        // index the detached instances by series uid and recurrence-id.
+        // the uids are owned by the components in comps.
+        typedef ArenaMap<time_t,ECalComponent*> Instances;
+        auto& arena = subtask->arena;
+        ArenaMap<const char*,Instances,CStrLess> overrides{CStrLess(), ArenaAllocator<char>(arena)};
+        ArenaVector<ECalComponent*> masters{ArenaAllocator<ECalComponent*>(arena)};
+        for (auto l=comps; l!=nullptr; l=l->next)
+        {
+            auto component = static_cast<ECalComponent*>(l->data);
+            auto icc = e_cal_component_get_icalcomponent(component);
+            const char* uid = icalcomponent_get_uid(icc);
+            if (!e_cal_component_is_instance(component) || (uid == nullptr))
+            {
+                masters.push_back(component);
+                continue;
+            }
+
+            const auto rid = icalcomponent_get_recurrenceid(icc);
+            auto prop = icalcomponent_get_first_property(icc, ICAL_RECURRENCEID_PROPERTY);
+            const auto key = icaltime_as_timet_with_zone(rid, get_property_zone(subtask, prop, rid));
+            auto oit = overrides.find(uid);
+            if (oit == overrides.end())
+                oit = overrides.insert(std::make_pair(uid, Instances{std::less<time_t>(), ArenaAllocator<char>(arena)})).first;
+            oit->second[key] = component;
+
+            // keep the detached instance if it's in the window,
+            // or if we only want alarms and one of its alarms is
+            auto window_begin = begin;
+            auto window_end = end;
+            if (subtask->alarms_only)
+            {
+                time_t before, after;
+                get_alarm_reach(icc, before, after);
+                window_begin -= after;
+                window_end += before;
             }
+            const auto dtstart = icalcomponent_get_dtstart(icc);
+            const auto zone = get_property_zone(subtask, icalcomponent_get_first_property(icc, ICAL_DTSTART_PROPERTY), dtstart);
+            const auto instance_begin = icaltime_as_timet_with_zone(dtstart, zone);
+            const auto dtend = icalcomponent_get_dtend(icc);
+            const auto instance_end = icaltime_is_null_time(dtend) ? instance_begin
+                                                                   : icaltime_as_timet_with_zone(dtend, zone);
+            if ((instance_begin < window_end) && (window_begin < std::max(instance_begin + 1, instance_end)))
+                subtask->instance_components.push_back(Instance{instance_begin, E_CAL_COMPONENT(g_object_ref(component))});
         }
 
-        if (subtask->parent_components.empty()) {
-            on_event_fetch_list_done(gsubtask);
-            return;
+        ArenaSet<const char*,CStrLess> series_uids{CStrLess(), ArenaAllocator<char>(arena)};
+        for (auto& component : masters)
+        {
+            auto icc = e_cal_component_get_icalcomponent(component);
+            if (!RecurrenceCache::is_recurring(icc))
+            {
+                const auto dtstart = icalcomponent_get_dtstart(icc);
+                const auto zone = get_property_zone(subtask, icalcomponent_get_first_property(icc, ICAL_DTSTART_PROPERTY), dtstart);
+                subtask->components.push_back(Instance{icaltime_as_timet_with_zone(dtstart, zone),
+                                                       E_CAL_COMPONENT(g_object_ref(component))});
+                continue;
+            }
+
+            const char* uid = icalcomponent_get_uid(icc);
+            if (uid == nullptr)
+                continue;
+            series_uids.insert(uid);
+
+            // no need to expand a series that can't have alarms
+            if (subtask->alarms_only && !e_cal_component_has_alarms(component))
+                continue;
+
+            // when we only want alarms, an occurrence outside the window
+            // can still have one inside of it, eg TRIGGER:-P2D on a weekly event
+            auto series_begin = begin;
+            auto series_end = end;
+            if (subtask->alarms_only)
+            {
+                time_t before, after;
+                get_alarm_reach(icc, before, after);
+                series_begin -= after;
+                series_end += before;
+            }
+
+            // no need to expand a series that's already over
+            if (RecurrenceCache::ends_before(icc, series_begin))
+                continue;
+
+            const auto dtstart = icalcomponent_get_dtstart(icc);
+            const auto zone = get_property_zone(subtask, icalcomponent_get_first_property(icc, ICAL_DTSTART_PROPERTY), dtstart);
+            const auto oit = overrides.find(uid);
+            const auto occurrences = m_recurrences.occurrences(source_uid, icc, zone, series_begin, series_end);
+            subtask->instance_components.reserve(subtask->instance_components.size() + occurrences.size());
+            for (const auto& occurrence : occurrences)
+            {
+                // skip the occurrences that have been detached
+                const auto occurrence_begin = icaltime_as_timet_with_zone(occurrence.begin, zone);
+                if ((oit != overrides.end()) && oit->second.count(occurrence_begin))
+                    continue;
+
+                auto instance = create_instance(icc, occurrence);
+                if (instance != nullptr)
+                    subtask->instance_components.push_back(Instance{occurrence_begin, instance});
+            }
         }
 
-        // continue fetch detached instances
-        auto i_begin = subtask->parent_components.begin();
-        std::string id = *i_begin;
-        subtask->parent_components.erase(i_begin);
-        e_cal_client_get_objects_for_uid(subtask->client,
-                                         id.c_str(),
-                                         subtask->cancellable.get(),
-                                         (GAsyncReadyCallback) fetch_detached_instances,
-                                         gsubtask);
+        // forget the series that have been deleted
+        m_recurrences.retain(source_uid, [&series_uids](const std::string& uid){
+            return series_uids.count(uid.c_str()) != 0;
+        });
     }
 
+    /**
+     * How far before and after an occurrence's start its alarms can
+     * trigger, including their repeats. Absolute triggers don't move
+     * with the occurrence, so they don't count.
+     */
     static void
-    on_event_generated_list_ready(gpointer gsubtask)
+    get_alarm_reach(icalcomponent* icc, time_t& before, time_t& after)
     {
-        fetch_detached_instances(nullptr, nullptr, gsubtask);
-    }
+        before = after = 0;
 
-    static gint
-    sort_events_by_start_date(ECalComponent *eventA, ECalComponent *eventB)
-    {
-        ECalComponentDateTime start_date_a;
-        ECalComponentDateTime start_date_b;
+        const time_t duration = icaldurationtype_as_int(icalcomponent_get_duration(icc));
+        for (auto valarm = icalcomponent_get_first_component(icc, ICAL_VALARM_COMPONENT);
+             valarm != nullptr;
+             valarm = icalcomponent_get_next_component(icc, ICAL_VALARM_COMPONENT))
+        {
+            auto prop = icalcomponent_get_first_property(valarm, ICAL_TRIGGER_PROPERTY);
+            if (prop == nullptr)
+                continue;
+            const auto trigger = icalproperty_get_trigger(prop);
+            if (!icaltime_is_null_time(trigger.time))
+                continue;
 
-        e_cal_component_get_dtstart(eventA, &start_date_a);
-        e_cal_component_get_dtstart(eventB, &start_date_b);
+            time_t offset = icaldurationtype_as_int(trigger.duration);
+            auto related = icalproperty_get_first_parameter(prop, ICAL_RELATED_PARAMETER);
+            if ((related != nullptr) && (icalparameter_get_related(related) == ICAL_RELATED_END))
+                offset += duration;
 
-        auto time_a = icaltime_as_timet(*start_date_a.value);
-        auto time_b = icaltime_as_timet(*start_date_b.value);
-        if (time_a == time_b)
-            return 0;
-        if (time_a < time_b)
-            return -1;
-        return 1;
+            time_t repeats = 0;
+            auto repeat = icalcomponent_get_first_property(valarm, ICAL_REPEAT_PROPERTY);
+            auto interval = icalcomponent_get_first_property(valarm, ICAL_DURATION_PROPERTY);
+            if ((repeat != nullptr) && (interval != nullptr))
+                repeats = time_t(icalproperty_get_repeat(repeat)) * icaldurationtype_as_int(icalproperty_get_duration(interval));
+
+            before = std::max(before, -offset);
+            after = std::max(after, offset + repeats);
+        }
     }
 
     static bool
@@ -784,55 +1451,115 @@ private:
 
 
 
-    static void
-    on_event_fetch_list_done(gpointer gsubtask)
+    /**
+     * Build the subtask's alarms and appointments from its components.
+     *
+     * This is resumable: once the monotonic time passes @deadline,
+     * it returns false and picks up where it left off on the next call.
+     * Returns true when the subtask is fully converted.
+     */
+    static bool
+    convert_components(ClientSubtask* subtask, gint64 deadline)
     {
-        auto subtask = static_cast<ClientSubtask*>(gsubtask);
+        using Stage = ClientSubtask::Stage;
+
+        const auto begin = subtask->task->begin.to_unix();
+        const auto end = subtask->task->end.to_unix();
+        auto gtz = subtask->task->gtz;
 
         // generate alarms
         constexpr std::array<ECalComponentAlarmAction,1> omit = {
             (ECalComponentAlarmAction)-1
         }; // list of action types to omit, terminated with -1
-        GSList * comp_alarms = nullptr;
-
-        // we do not need translate tz for instance events,
-        // they are aredy in the correct time
-        e_cal_util_generate_alarms_for_list(
-            subtask->instance_components,
-            subtask->task->begin.to_unix(),
-            subtask->task->end.to_unix(),
-            const_cast<ECalComponentAlarmAction*>(omit.data()),
-            &comp_alarms,
-            e_cal_client_resolve_tzid_cb,
-            subtask->client,
-            nullptr);
-
-        // convert timezone for non-instance events
-        e_cal_util_generate_alarms_for_list(
-            subtask->components,
-            subtask->task->begin.to_unix(),
-            subtask->task->end.to_unix(),
-            const_cast<ECalComponentAlarmAction*>(omit.data()),
-            &comp_alarms,
-            e_cal_client_resolve_tzid_cb,
-            subtask->client,
-            subtask->task->default_timezone);
-
-        // walk the alarms & add them
-        for (auto l=comp_alarms; l!=nullptr; l=l->next)
-            add_alarms_to_subtask(static_cast<ECalComponentAlarms*>(l->data), subtask, subtask->task->gtz);
-
-        subtask->components = g_list_concat(subtask->components, subtask->instance_components);
-        subtask->components = g_list_sort(subtask->components, (GCompareFunc) sort_events_by_start_date);
-        // add events without alarm
-        for (auto l=subtask->components; l!=nullptr; l=l->next) {
-            auto component = static_cast<ECalComponent*>(l->data);
-            if (!event_has_valid_alarms(component))
-                add_event_to_subtask(component, subtask, subtask->task->gtz);
+
+        while (subtask->stage != Stage::Done)
+        {
+            switch (subtask->stage)
+            {
+                // instances keep their series' TZID, so floating ones
+                // need the default timezone just like one-time events do
+                case Stage::InstanceAlarms:
+                case Stage::ComponentAlarms: {
+                    const bool instances = subtask->stage == Stage::InstanceAlarms;
+                    const auto& list = instances ? subtask->instance_components : subtask->components;
+                    if (subtask->next < list.size())
+                    {
+                        auto comp_alarms = e_cal_util_generate_alarms_for_comp(
+                            list[subtask->next++].component,
+                            begin,
+                            end,
+                            const_cast<ECalComponentAlarmAction*>(omit.data()),
+                            resolve_tzid,
+                            subtask,
+                            subtask->task->default_timezone);
+
+                        // walk the alarms & add them
+                        if (comp_alarms != nullptr)
+                        {
+                            add_alarms_to_subtask(comp_alarms, subtask, gtz);
+                            e_cal_component_alarms_free(comp_alarms);
+                        }
+                    }
+                    else if (instances)
+                    {
+                        subtask->stage = Stage::ComponentAlarms;
+                        subtask->next = 0;
+                    }
+                    else if (subtask->alarms_only)
+                    {
+                        subtask->stage = Stage::Done;
+                    }
+                    else
+                    {
+                        // add events without alarm, sorted by the start times we computed when collecting them
+                        auto& all = subtask->components;
+                        all.insert(all.end(), subtask->instance_components.begin(), subtask->instance_components.end());
+                        subtask->instance_components.clear();
+                        std::stable_sort(all.begin(), all.end(), [](const Instance& a, const Instance& b){return a.begin < b.begin;});
+                        subtask->stage = Stage::Events;
+                        subtask->next = 0;
+                    }
+                    break;
+                }
+
+                case Stage::Events:
+                    if (subtask->next < subtask->components.size())
+                    {
+                        auto component = subtask->components[subtask->next++].component;
+                        if (!event_has_valid_alarms(component))
+                            add_event_to_subtask(component, subtask, gtz);
+                    }
+                    else
+                    {
+                        subtask->stage = Stage::Done;
+                    }
+                    break;
+
+                case Stage::Done:
+                    break;
+            }
+
+            if ((subtask->stage != Stage::Done) && (deadline != G_MAXINT64) && (g_get_monotonic_time() >= deadline))
+                return false;
         }
-        g_list_free_full(subtask->components, g_object_unref);
-        e_cal_free_alarms(comp_alarms);
-        delete subtask;
+
+        return true;
+    }
+
+    static icaltimezone *
+    lookup_icaltimezone (const char * tzid,
+                         ECalClient * client,
+                         GCancellable * cancellable)
+    {
+        auto itz = icaltimezone_get_builtin_timezone_from_tzid(tzid); // usually works
+
+        if (itz == nullptr) // fallback
+            itz = icaltimezone_get_builtin_timezone(tzid);
+
+        if (client && (itz == nullptr)) // ok we have a strange tzid... ask EDS to look it up in VTIMEZONES
+            e_cal_client_get_timezone_sync(client, tzid, &itz, cancellable, nullptr);
+
+        return itz;
     }
 
     static GTimeZone *
@@ -844,13 +1571,7 @@ private:
         if (tzid == nullptr)
             return nullptr;
 
-        auto itz = icaltimezone_get_builtin_timezone_from_tzid(tzid); // usually works
-
-        if (itz == nullptr) // fallback
-            itz = icaltimezone_get_builtin_timezone(tzid);
-
-        if (client && (itz == nullptr)) // ok we have a strange tzid... ask EDS to look it up in VTIMEZONES
-            e_cal_client_get_timezone_sync(client, tzid, &itz, cancellable, nullptr);
+        auto itz = lookup_icaltimezone(tzid, client, cancellable);
 
         const char* identifier {};
         if (itimezone)
@@ -881,23 +1602,21 @@ private:
         if (identifier == nullptr)
             g_warning("Unrecognized TZID: '%s'", tzid);
         else
-            return g_time_zone_new(identifier);
+            return g_time_zone_ref(TimezoneRegistry::instance().get(identifier).get());
 
         return nullptr;
     }
 
     static DateTime
-    datetime_from_component_date_time(ECalClient                     * client,
-                                      std::shared_ptr<GCancellable>  & cancellable,
+    datetime_from_component_date_time(const ClientSubtask            * subtask,
                                       const ECalComponentDateTime    & in,
                                       GTimeZone                      * default_timezone)
     {
         DateTime out;
         g_return_val_if_fail(in.value != nullptr, out);
 
-        GTimeZone * gtz = timezone_from_name(in.tzid, client, cancellable.get(), nullptr);
-        if (gtz == nullptr)
-            gtz = g_time_zone_ref(default_timezone);
+        auto zone = find_zone(subtask, in.tzid);
+        auto gtz = (zone && zone->gtz) ? zone->gtz : default_timezone;
 
         out = DateTime(gtz,
                        in.value->year,
@@ -906,12 +1625,12 @@ private:
                        in.value->hour,
                        in.value->minute,
                        in.value->second);
-        g_time_zone_unref(gtz);
         return out;
     }
 
-    bool
-    is_component_interesting(ECalComponent * component)
+    // this runs in a worker, so it only touches the subtask
+    static bool
+    is_component_interesting(ECalComponent * component, ClientSubtask * subtask)
     {
         // we only want calendar events and vtodos
         const auto vtype = e_cal_component_get_vtype(component);
@@ -940,6 +1659,7 @@ private:
         if (!disabled) {
             // we don't want not attending alarms
             // check if the user is part of attendee list if we found it check the status
+            std::vector<Attendee> attendees;
             GSList *attendeeList = nullptr;
             e_cal_component_get_attendee_list(component, &attendeeList);
 
@@ -947,15 +1667,26 @@ private:
                 ECalComponentAttendee *attendee = static_cast<ECalComponentAttendee *>(attendeeIter->data);
                 if (attendee->value) {
                     if (strncmp(attendee->value, "mailto:", 7) == 0) {
-                        if (m_myself->isMyEmail(attendee->value+7)) {
-                            disabled = (attendee->status == ICAL_PARTSTAT_DECLINED);
-                            break;
-                        }
+                        attendees.push_back(Attendee{attendee->value+7, attendee->status == ICAL_PARTSTAT_DECLINED});
                     }
                 }
             }
             if (attendeeList)
                 e_cal_component_free_attendee_list(attendeeList);
+
+            disabled = is_declined(attendees, subtask->task->my_emails);
+
+            // remember who's attending so that when our emails change
+            // we can tell whether this component needs to be re-evaluated.
+            // a series and its detached instances can differ, so key by rid too
+            const gchar* uid = nullptr;
+            e_cal_component_get_uid(component, &uid);
+            if ((uid != nullptr) && !attendees.empty())
+            {
+                const auto rid = icalcomponent_get_recurrenceid(e_cal_component_get_icalcomponent(component));
+                const time_t rid_key = icaltime_is_null_time(rid) ? 0 : icaltime_as_timet(rid);
+                subtask->attendees[ComponentKey{subtask->source_uid, uid, rid_key}].swap(attendees);
+            }
         }
 
         if (disabled)
@@ -965,8 +1696,7 @@ private:
     }
 
     static Appointment
-    get_appointment(ECalClient                    * client,
-                    std::shared_ptr<GCancellable> & cancellable,
+    get_appointment(const ClientSubtask           * subtask,
                     ECalComponent                 * component,
                     GTimeZone                     * gtz)
     {
@@ -979,12 +1709,7 @@ private:
             baseline.uid = uid;
 
         // get source uid
-        ESource *source = nullptr;
-        g_object_get(G_OBJECT(client), "source", &source, nullptr);
-        if (source != nullptr) {
-            baseline.source_uid = e_source_get_uid(source);
-            g_object_unref(source);
-        }
+        baseline.source_uid = subtask->source_uid;
 
         // get appointment.summary
         ECalComponentText text {};
@@ -995,13 +1720,16 @@ private:
         // get appointment.begin
         ECalComponentDateTime eccdt_tmp {};
         e_cal_component_get_dtstart(component, &eccdt_tmp);
-        baseline.begin = datetime_from_component_date_time(client, cancellable, eccdt_tmp, gtz);
+        baseline.begin = datetime_from_component_date_time(subtask, eccdt_tmp, gtz);
+        baseline.floating = (eccdt_tmp.value != nullptr)
+                         && (eccdt_tmp.tzid == nullptr)
+                         && !icaltime_is_utc(*eccdt_tmp.value);
         e_cal_component_free_datetime(&eccdt_tmp);
 
         // get appointment.end
         e_cal_component_get_dtend(component, &eccdt_tmp);
         baseline.end = eccdt_tmp.value != nullptr
-                                  ? datetime_from_component_date_time(client, cancellable, eccdt_tmp, gtz)
+                                  ? datetime_from_component_date_time(subtask, eccdt_tmp, gtz)
                                   : baseline.begin;
         e_cal_component_free_datetime(&eccdt_tmp);
 
@@ -1044,10 +1772,10 @@ private:
     {
         auto& component = comp_alarms->comp;
 
-        if (!subtask->task->p->is_component_interesting(component))
+        if (!is_component_interesting(component, subtask))
             return;
 
-        Appointment baseline = get_appointment(subtask->client, subtask->cancellable, component, gtz);
+        Appointment baseline = get_appointment(subtask, component, gtz);
         baseline.color = subtask->color;
 
         /**
@@ -1067,7 +1795,10 @@ private:
         ***  e.g. one valarm will have a display action and another
         ***  will specify a sound to be played.
          */
-        std::map<std::pair<DateTime,DateTime>,std::map<DateTime,Alarm>> alarms;
+        typedef ArenaMap<DateTime,Alarm> TriggerAlarms;
+        auto& arena = subtask->arena;
+        ArenaMap<std::pair<DateTime,DateTime>,TriggerAlarms> alarms{std::less<std::pair<DateTime,DateTime>>(),
+                                                                    ArenaAllocator<char>(arena)};
         for (auto l=comp_alarms->alarms; l!=nullptr; l=l->next)
         {
             auto ai = static_cast<ECalComponentAlarmInstance*>(l->data);
@@ -1080,7 +1811,10 @@ private:
             auto instance_time = std::make_pair(DateTime{gtz, ai->occur_start},
                                                 DateTime{gtz, ai->occur_end});
             auto trigger_time = DateTime{gtz, ai->trigger};
-            auto& alarm = alarms[instance_time][trigger_time];
+            auto it = alarms.find(instance_time);
+            if (it == alarms.end())
+                it = alarms.insert(std::make_pair(instance_time, TriggerAlarms{std::less<DateTime>(), ArenaAllocator<char>(arena)})).first;
+            auto& alarm = it->second[trigger_time];
             if (alarm.text.empty())
                 alarm.text = get_alarm_text(a);
 
@@ -1106,7 +1840,7 @@ private:
                 if (j.second.has_text() || j.second.has_sound())
                     appointment.alarms.push_back(j.second);
             }
-            subtask->task->appointments.push_back(appointment);
+            subtask->appointments.push_back(appointment);
         }
     }
 
@@ -1117,11 +1851,11 @@ private:
                          GTimeZone     * gtz)
     {
         // add it. simple, eh?
-        if (subtask->task->p->is_component_interesting(component))
+        if (is_component_interesting(component, subtask))
         {
-            Appointment appointment = get_appointment(subtask->client, subtask->cancellable, component, gtz);
+            Appointment appointment = get_appointment(subtask, component, gtz);
             appointment.color = subtask->color;
-            subtask->task->appointments.push_back(appointment);
+            subtask->appointments.push_back(appointment);
         }
     }
 
@@ -1129,10 +1863,35 @@ private:
     ****
     ***/
 
+    struct DisableBatch
+    {
+        ECalClient* client;
+        std::shared_ptr<GCancellable> cancellable;
+        size_t n_pending;
+        GSList* icalcomponents {};
+
+        DisableBatch(ECalClient* client_in,
+                     const std::shared_ptr<GCancellable>& cancellable_in,
+                     size_t n_pending_in):
+            client(E_CAL_CLIENT(g_object_ref(client_in))),
+            cancellable(cancellable_in),
+            n_pending(n_pending_in)
+        {
+        }
+
+        ~DisableBatch()
+        {
+            g_slist_free_full(icalcomponents, (GDestroyNotify)icalcomponent_free);
+            g_clear_object(&client);
+        }
+    };
+
     static void on_object_ready_for_disable(GObject      * client,
                                             GAsyncResult * result,
-                                            gpointer       gself)
+                                            gpointer       gbatch)
     {
+        auto batch = static_cast<DisableBatch*>(gbatch);
+
         icalcomponent * icc = nullptr;
         if (e_cal_client_get_object_finish (E_CAL_CLIENT(client), result, &icc, nullptr))
         {
@@ -1158,12 +1917,9 @@ private:
                     e_cal_component_set_categories_list(ecc, new_categories);
                     g_slist_free(new_categories);
                     e_cal_component_free_categories_list(old_categories);
-                    e_cal_client_modify_object(E_CAL_CLIENT(client),
-                                               e_cal_component_get_icalcomponent(ecc),
-                                               E_CAL_OBJ_MOD_THIS,
-                                               static_cast<Impl*>(gself)->m_cancellable.get(),
-                                               on_disable_done,
-                                               nullptr);
+
+                    auto modified = icalcomponent_new_clone(e_cal_component_get_icalcomponent(ecc));
+                    batch->icalcomponents = g_slist_prepend(batch->icalcomponents, modified);
 
                     g_clear_object(&ecc);
                 }
@@ -1171,12 +1927,28 @@ private:
 
             g_clear_pointer(&icc, icalcomponent_free);
         }
+
+        // when the last lookup in the batch is done, write them all back at once
+        if (--batch->n_pending == 0)
+        {
+            if (batch->icalcomponents != nullptr)
+            {
+                e_cal_client_modify_objects(batch->client,
+                                            batch->icalcomponents,
+                                            E_CAL_OBJ_MOD_THIS,
+                                            batch->cancellable.get(),
+                                            on_disable_done,
+                                            nullptr);
+            }
+
+            delete batch;
+        }
     }
 
     static void on_disable_done (GObject* gclient, GAsyncResult *res, gpointer)
     {
         GError * error = nullptr;
-        if (!e_cal_client_modify_object_finish (E_CAL_CLIENT(gclient), res, &error))
+        if (!e_cal_client_modify_objects_finish (E_CAL_CLIENT(gclient), res, &error))
         {
             if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
                 g_warning("indicator-datetime cannot mark one-time alarm as disabled: %s", error->message);
@@ -1193,19 +1965,32 @@ private:
     std::set<ESource*> m_sources;
     std::map<ESource*,ECalClient*> m_clients;
     std::map<ESource*,ECalClientView*> m_views;
+    std::map<std::string,std::set<std::string>> m_pending_disables; // source uid -> appointment uids
+    guint m_disable_tag {};
+    GKeyFile* m_trigger_scans {};
     std::shared_ptr<GCancellable> m_cancellable;
+    std::map<ESource*,std::shared_ptr<GCancellable>> m_client_cancellables;
     ESourceRegistry* m_source_registry {};
     guint m_rebuild_tag {};
     time_t m_rebuild_deadline {};
     std::shared_ptr<Myself> m_myself;
+    std::set<std::string> m_my_emails;
+    AttendeeMap m_attendees; // the mailto: attendees of the components in the latest rebuild's queries
+    unsigned int m_attendees_generation {};
+    unsigned int m_generation {}; // bumped each time we emit changed()
+    GThreadPool* m_convert_pool {}; // null if we convert on the main loop
+
+    // how long the main loop may spend converting in one idle callback
+    static constexpr gint64 SLICE_USEC {5 * G_TIME_SPAN_MILLISECOND};
+    RecurrenceCache m_recurrences;
 };
 
 /***
 ****
 ***/
 
-EdsEngine::EdsEngine(const std::shared_ptr<Myself> &myself):
-    p(new Impl(myself))
+EdsEngine::EdsEngine(const std::shared_ptr<Myself> &myself, bool threaded):
+    p(new Impl(myself, threaded))
 {
 }
 
@@ -1224,9 +2009,22 @@ void EdsEngine::get_appointments(const DateTime& begin,
     p->get_appointments(begin, end, tz, func);
 }
 
+void EdsEngine::get_alarms(const DateTime& begin,
+                           const DateTime& end,
+                           const Timezone& tz,
+                           std::function<void(const std::vector<Appointment>&)> func)
+{
+    p->get_appointments(begin, end, tz, func, true);
+}
+
 void EdsEngine::disable_ubuntu_alarm(const Appointment& appointment)
 {
-    p->disable_ubuntu_alarm(appointment);
+    p->disable_ubuntu_alarms(std::vector<Appointment>({appointment}));
+}
+
+void EdsEngine::disable_ubuntu_alarms(const std::vector<Appointment>& appointments)
+{
+    p->disable_ubuntu_alarms(appointments);
 }
 
 /***
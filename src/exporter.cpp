@@ -25,6 +25,9 @@
 #include <glib/gi18n.h>
 #include <gio/gio.h>
 
+#include <map>
+#include <string>
+
 namespace unity {
 namespace indicator {
 namespace datetime {
@@ -39,7 +42,8 @@ public:
 
     Impl(const std::shared_ptr<Settings>& settings):
         m_settings(settings),
-        m_alarm_props(datetime_alarm_properties_skeleton_new())
+        m_alarm_props(datetime_alarm_properties_skeleton_new()),
+        m_token(new Impl*(this))
     {
         alarm_properties_init();
     }
@@ -48,6 +52,9 @@ public:
     {
         if (m_bus != nullptr)
         {
+            if (m_filter_id)
+                g_dbus_connection_remove_filter(m_bus, m_filter_id);
+
             for(auto& id : m_exported_menu_ids)
                 g_dbus_connection_unexport_menu_model(m_bus, id);
 
@@ -55,6 +62,16 @@ public:
                 g_dbus_connection_unexport_action_group(m_bus, m_exported_actions_id);
         }
 
+        for(auto& it : m_sender_watches)
+            g_bus_unwatch_name(it.second);
+
+        for(auto& lazy : m_lazy_menus)
+        {
+            if (lazy->suspend_tag)
+                g_source_remove(lazy->suspend_tag);
+            g_clear_object(&lazy->shell);
+        }
+
         g_dbus_interface_skeleton_unexport(G_DBUS_INTERFACE_SKELETON(m_alarm_props));
         g_clear_object(&m_alarm_props);
 
@@ -65,12 +82,55 @@ public:
     }
 
     core::Signal<> name_lost;
+    core::Property<bool> has_subscribers {true};
 
     void publish(const std::shared_ptr<Actions>& actions,
                  const std::vector<std::shared_ptr<Menu>>& menus)
     {
         m_actions = actions;
         m_menus = menus;
+        own_name();
+    }
+
+    void publish(const std::shared_ptr<Actions>& actions,
+                 const std::shared_ptr<MenuFactory>& factory,
+                 unsigned int suspend_delay_msec)
+    {
+        m_actions = actions;
+        m_factory = factory;
+        m_suspend_delay_msec = suspend_delay_msec;
+        has_subscribers.set(false);
+
+        for(int i=0; i<Menu::NUM_PROFILES; i++)
+        {
+            std::unique_ptr<LazyMenu> lazy(new LazyMenu);
+            lazy->owner = this;
+            lazy->profile = Menu::Profile(i);
+            lazy->path = std::string(BUS_DATETIME_PATH) + "/" + Menu::profile_name(lazy->profile);
+            lazy->shell = g_menu_new();
+            m_lazy_menus.push_back(std::move(lazy));
+        }
+
+        own_name();
+    }
+
+    std::shared_ptr<Menu> active_menu(Menu::Profile profile) const
+    {
+        for(const auto& menu : m_menus)
+            if (menu->profile() == profile)
+                return menu;
+
+        for(const auto& lazy : m_lazy_menus)
+            if (lazy->profile == profile)
+                return lazy->menu;
+
+        return std::shared_ptr<Menu>();
+    }
+
+private:
+
+    void own_name()
+    {
         m_own_id = g_bus_own_name(G_BUS_TYPE_SESSION,
                                   BUS_DATETIME_NAME,
                                   G_BUS_NAME_OWNER_FLAGS_ALLOW_REPLACEMENT,
@@ -81,8 +141,6 @@ public:
                                   nullptr);
     }
 
-private:
-
     /***
     ****
     ***/
@@ -190,18 +248,220 @@ private:
         for(auto& menu : m_menus)
         {
             const auto path = std::string(BUS_DATETIME_PATH) + "/" + menu->name();
-            const auto id = g_dbus_connection_export_menu_model(m_bus, path.c_str(), menu->menu_model(), &error);
-            if (id)
+            export_menu_model(path, menu->menu_model());
+        }
+
+        // export the lazy menus' shells and watch for clients subscribing to them
+        for(auto& lazy : m_lazy_menus)
+            export_menu_model(lazy->path, G_MENU_MODEL(lazy->shell));
+        if (!m_lazy_menus.empty())
+        {
+            auto data = new FilterData{std::weak_ptr<Impl*>(m_token), g_main_context_ref_thread_default()};
+            m_filter_id = g_dbus_connection_add_filter(m_bus, on_message_filter, data, on_filter_data_free);
+        }
+    }
+
+    void export_menu_model(const std::string& path, GMenuModel* model)
+    {
+        GError* error = nullptr;
+        const auto id = g_dbus_connection_export_menu_model(m_bus, path.c_str(), model, &error);
+        if (id)
+        {
+            m_exported_menu_ids.insert(id);
+        }
+        else
+        {
+            if (error != nullptr)
+                g_warning("cannot export %s: %s", path.c_str(), error->message);
+            g_clear_error(&error);
+        }
+    }
+
+    /***
+    ****  Lazy menus
+    ***/
+
+    struct LazyMenu
+    {
+        Impl* owner = nullptr;
+        Menu::Profile profile = Menu::Desktop;
+        std::string path;
+        GMenu* shell = nullptr; // what we export; holds the Menu's header while it's active
+        std::shared_ptr<Menu> menu;
+        std::map<std::string,int> subscribers; // sender -> Start calls minus End calls
+        guint suspend_tag = 0;
+    };
+
+    struct FilterData
+    {
+        std::weak_ptr<Impl*> token;
+        GMainContext* context;
+    };
+
+    struct MenusCall
+    {
+        std::weak_ptr<Impl*> token;
+        std::string path;
+        std::string sender;
+        bool start;
+    };
+
+    static void on_filter_data_free(gpointer gdata)
+    {
+        auto data = static_cast<FilterData*>(gdata);
+        g_main_context_unref(data->context);
+        delete data;
+    }
+
+    // GDBus calls this in its worker thread, so just pass Start/End calls
+    // on the org.gtk.Menus interface along to the main context
+    static GDBusMessage* on_message_filter(GDBusConnection*,
+                                           GDBusMessage* message,
+                                           gboolean incoming,
+                                           gpointer gdata)
+    {
+        if (!incoming || (g_dbus_message_get_message_type(message) != G_DBUS_MESSAGE_TYPE_METHOD_CALL))
+            return message;
+
+        if (g_strcmp0(g_dbus_message_get_interface(message), "org.gtk.Menus"))
+            return message;
+
+        const auto member = g_dbus_message_get_member(message);
+        const bool start = !g_strcmp0(member, "Start");
+        if (!start && g_strcmp0(member, "End"))
+            return message;
+
+        const auto path = g_dbus_message_get_path(message);
+        const auto sender = g_dbus_message_get_sender(message);
+        if ((path == nullptr) || (sender == nullptr))
+            return message;
+
+        auto data = static_cast<FilterData*>(gdata);
+        auto call = new MenusCall{data->token, path, sender, start};
+        g_main_context_invoke_full(data->context,
+                                   G_PRIORITY_DEFAULT,
+                                   on_menus_call,
+                                   call,
+                                   [](gpointer gcall){delete static_cast<MenusCall*>(gcall);});
+        return message;
+    }
+
+    static gboolean on_menus_call(gpointer gcall)
+    {
+        auto call = static_cast<MenusCall*>(gcall);
+        auto token = call->token.lock();
+        if (token)
+            (*token)->on_menus_call(call->path, call->sender, call->start);
+        return G_SOURCE_REMOVE;
+    }
+
+    void on_menus_call(const std::string& path, const std::string& sender, bool start)
+    {
+        for(auto& lazy : m_lazy_menus)
+        {
+            if (lazy->path != path)
+                continue;
+
+            if (start)
             {
-                m_exported_menu_ids.insert(id);
+                watch_sender(sender);
+                ++lazy->subscribers[sender];
+                activate(*lazy);
             }
             else
             {
-                if (error != nullptr)
-                    g_warning("cannot export %s menu: %s", menu->name().c_str(), error->message);
-                g_clear_error(&error);
+                auto it = lazy->subscribers.find(sender);
+                if ((it != lazy->subscribers.end()) && (--it->second <= 0))
+                    lazy->subscribers.erase(it);
+                if (lazy->subscribers.empty())
+                    schedule_suspend(*lazy);
             }
         }
+
+        update_has_subscribers();
+    }
+
+    void update_has_subscribers()
+    {
+        bool has = false;
+        for(const auto& lazy : m_lazy_menus)
+            has |= !lazy->subscribers.empty();
+        has_subscribers.set(has);
+    }
+
+    // clients that exit without calling End are still subscribed,
+    // so watch for them to leave the bus
+    void watch_sender(const std::string& sender)
+    {
+        if (m_sender_watches.count(sender))
+            return;
+
+        m_sender_watches[sender] = g_bus_watch_name_on_connection(m_bus,
+                                                                  sender.c_str(),
+                                                                  G_BUS_NAME_WATCHER_FLAGS_NONE,
+                                                                  nullptr,
+                                                                  on_sender_vanished,
+                                                                  this,
+                                                                  nullptr);
+    }
+
+    static void on_sender_vanished(GDBusConnection*, const gchar* name, gpointer gself)
+    {
+        static_cast<Impl*>(gself)->on_sender_vanished(name);
+    }
+
+    void on_sender_vanished(const std::string& sender)
+    {
+        auto it = m_sender_watches.find(sender);
+        if (it != m_sender_watches.end())
+        {
+            g_bus_unwatch_name(it->second);
+            m_sender_watches.erase(it);
+        }
+
+        for(auto& lazy : m_lazy_menus)
+            if (lazy->subscribers.erase(sender) && lazy->subscribers.empty())
+                schedule_suspend(*lazy);
+
+        update_has_subscribers();
+    }
+
+    void activate(LazyMenu& lazy)
+    {
+        if (lazy.suspend_tag)
+        {
+            g_source_remove(lazy.suspend_tag);
+            lazy.suspend_tag = 0;
+        }
+
+        if (lazy.menu)
+            return;
+
+        g_debug("%s building the %s menu", G_STRLOC, lazy.path.c_str());
+        lazy.menu = m_factory->buildMenu(lazy.profile);
+
+        // the header item links to the menu's live submenu
+        auto header = g_menu_item_new_from_model(lazy.menu->menu_model(), 0);
+        g_menu_append_item(lazy.shell, header);
+        g_object_unref(header);
+    }
+
+    void schedule_suspend(LazyMenu& lazy)
+    {
+        if (lazy.menu && !lazy.suspend_tag)
+            lazy.suspend_tag = g_timeout_add(m_suspend_delay_msec, on_suspend_timeout, &lazy);
+    }
+
+    static gboolean on_suspend_timeout(gpointer glazy)
+    {
+        auto lazy = static_cast<LazyMenu*>(glazy);
+        lazy->suspend_tag = 0;
+
+        g_debug("%s no one is watching %s; suspending it", G_STRLOC, lazy->path.c_str());
+        while (g_menu_model_get_n_items(G_MENU_MODEL(lazy->shell)) > 0)
+            g_menu_remove(lazy->shell, 0);
+        lazy->menu.reset();
+        return G_SOURCE_REMOVE;
     }
 
     /***
@@ -226,6 +486,13 @@ private:
     std::shared_ptr<Actions> m_actions;
     std::vector<std::shared_ptr<Menu>> m_menus;
     DatetimeAlarmProperties* m_alarm_props = nullptr;
+
+    std::shared_ptr<MenuFactory> m_factory;
+    std::vector<std::unique_ptr<LazyMenu>> m_lazy_menus;
+    std::map<std::string,guint> m_sender_watches;
+    unsigned int m_suspend_delay_msec = DEFAULT_SUSPEND_DELAY_MSEC;
+    guint m_filter_id = 0;
+    std::shared_ptr<Impl*> m_token;
 };
 
 
@@ -254,6 +521,25 @@ void Exporter::publish(const std::shared_ptr<Actions>& actions,
     p->publish(actions, menus);
 }
 
+void Exporter::publish(const std::shared_ptr<Actions>& actions,
+                       const std::shared_ptr<MenuFactory>& factory,
+                       unsigned int suspend_delay_msec)
+{
+    p->publish(actions, factory, suspend_delay_msec);
+}
+
+std::shared_ptr<Menu> Exporter::active_menu(Menu::Profile profile) const
+{
+    return p->active_menu(profile);
+}
+
+const core::Property<bool>& Exporter::has_subscribers() const
+{
+    return p->has_subscribers;
+}
+
+constexpr unsigned int Exporter::DEFAULT_SUSPEND_DELAY_MSEC;
+
 /***
 ****
 ***/
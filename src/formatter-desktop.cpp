@@ -64,12 +64,21 @@ DesktopFormatter::DesktopFormatter(const std::shared_ptr<const Clock>&    clock_
     Formatter(clock_in),
     m_settings(settings_in)
 {
-    m_settings->show_day.changed().connect([this](bool){rebuildHeaderFormat();});
-    m_settings->show_date.changed().connect([this](bool){rebuildHeaderFormat();});
-    m_settings->show_year.changed().connect([this](bool){rebuildHeaderFormat();});
-    m_settings->show_seconds.changed().connect([this](bool){rebuildHeaderFormat();});
-    m_settings->time_format_mode.changed().connect([this](TimeFormatMode){rebuildHeaderFormat();});
-    m_settings->custom_time_format.changed().connect([this](const std::string&){rebuildHeaderFormat();});
+    // rebuild once per batch of settings changes
+    m_connections.push_back(m_settings->changed_keys.connect([this](const std::set<std::string>& keys){
+        static const char* header_keys[] = { SETTINGS_SHOW_DAY_S,
+                                             SETTINGS_SHOW_DATE_S,
+                                             SETTINGS_SHOW_YEAR_S,
+                                             SETTINGS_SHOW_SECONDS_S,
+                                             SETTINGS_TIME_FORMAT_S,
+                                             SETTINGS_CUSTOM_TIME_FORMAT_S };
+        for (const auto& key : header_keys) {
+            if (keys.count(key)) {
+                rebuildHeaderFormat();
+                break;
+            }
+        }
+    }));
 
     rebuildHeaderFormat();
 }
@@ -29,6 +29,8 @@
 #include <langinfo.h> // nl_langinfo()
 #include <string.h> // strstr()
 
+#include <vector>
+
 namespace unity {
 namespace indicator {
 namespace datetime {
@@ -123,7 +125,7 @@ public:
         m_clock(clock)
     {
         m_owner->header_format.changed().connect([this](const std::string& /*fmt*/){update_header();});
-        m_clock->minute_changed.connect([this](){update_header();});
+        m_connections.push_back(m_clock->minute_changed.connect([this](){update_header();}));
         update_header();
 
         restartRelativeTimer();
@@ -206,6 +208,7 @@ private:
     Formatter* const m_owner;
     guint m_header_seconds_timer = 0;
     guint m_relative_timer = 0;
+    std::vector<core::ScopedConnection> m_connections;
 
 public:
     std::shared_ptr<const Clock> m_clock;
@@ -37,12 +37,14 @@ class Haptic::Impl
 {
 public:
 
-    Impl(const Mode& mode, bool repeat):
+    Impl(GDBusConnection* session_bus, const Mode& mode, bool repeat):
         m_mode(mode),
         m_cancellable(g_cancellable_new()),
+        m_bus(session_bus ? G_DBUS_CONNECTION(g_object_ref(session_bus)) : nullptr),
         m_repeat(repeat)
     {
-        g_bus_get (G_BUS_TYPE_SESSION, m_cancellable, on_bus_ready, this);
+        if (m_bus != nullptr)
+            start_vibrating();
     }
 
     ~Impl()
@@ -58,31 +60,6 @@ public:
 
 private:
 
-    static void on_bus_ready (GObject*, GAsyncResult* res, gpointer gself)
-    {
-        GError * error;
-        GDBusConnection * bus;
-
-        error = nullptr;
-        bus = g_bus_get_finish (res, &error);
-        if (error != nullptr)
-        {
-            if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-                g_warning ("Unable to get bus: %s", error->message);
-
-            g_error_free (error);
-        }
-        else if (bus != nullptr)
-        {
-            auto self = static_cast<Impl*>(gself);
-
-            self->m_bus = G_DBUS_CONNECTION (g_object_ref (bus));
-            self->start_vibrating();
-
-            g_object_unref (bus);
-        }
-    }
-
     void start_vibrating()
     {
         g_return_if_fail (m_tag == 0);
@@ -158,8 +135,8 @@ private:
 ****
 ***/
 
-Haptic::Haptic(const Mode& mode, bool repeat):
-    impl(new Impl (mode, repeat))
+Haptic::Haptic(GDBusConnection* session_bus, const Mode& mode, bool repeat):
+    impl(new Impl (session_bus, mode, repeat))
 {
 }
 
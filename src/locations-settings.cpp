@@ -20,10 +20,21 @@
 #include <datetime/locations-settings.h>
 
 #include <datetime/settings-shared.h>
+#include <datetime/timezone-registry.h>
 #include <datetime/timezones.h>
 #include <datetime/utils.h>
 
+#include <glib-unix.h> // g_unix_fd_add()
+
+#include <sys/timerfd.h>
+#include <unistd.h> // close()
+
 #include <algorithm> // std::find()
+#include <cerrno>
+
+#ifndef TFD_TIMER_CANCEL_ON_SET
+ #define TFD_TIMER_CANCEL_ON_SET (1 << 1)
+#endif
 
 namespace unity {
 namespace indicator {
@@ -34,14 +45,22 @@ SettingsLocations::SettingsLocations(const std::shared_ptr<const Settings>& sett
     m_settings(settings),
     m_timezones(timezones)
 {
-    m_settings->locations.changed().connect([this](const std::vector<std::string>&){reload();});
-    m_settings->show_locations.changed().connect([this](bool){reload();});
+    m_settings->changed_keys.connect([this](const std::set<std::string>& keys){
+        if (keys.count(SETTINGS_LOCATIONS_S) || keys.count(SETTINGS_SHOW_LOCATIONS_S))
+            reload();
+    });
     m_timezones->timezone.changed().connect([this](const std::string&){reload();});
     m_timezones->timezones.changed().connect([this](const std::set<std::string>&){reload();});
+    m_connections.push_back(TimezoneRegistry::instance().changed().connect([this](){reload();}));
 
     reload();
 }
 
+SettingsLocations::~SettingsLocations()
+{
+    unset_transition_timer();
+}
+
 void
 SettingsLocations::reload()
 {
@@ -85,6 +104,82 @@ SettingsLocations::reload()
     }
 
     locations.set(v);
+
+    restart_transition_timer();
+}
+
+void
+SettingsLocations::unset_transition_timer()
+{
+    if (m_transition_tag)
+    {
+        g_source_remove(m_transition_tag);
+        m_transition_tag = 0;
+    }
+
+    if (m_transition_fd != -1)
+    {
+        close(m_transition_fd);
+        m_transition_fd = -1;
+    }
+}
+
+void
+SettingsLocations::restart_transition_timer()
+{
+    unset_transition_timer();
+
+    // find the soonest offset change among our locations
+    int64_t next = 0;
+    for (const auto& location : locations.get())
+    {
+        const auto t = location.next_transition();
+        if (t && (!next || (t < next)))
+            next = t;
+    }
+
+    if (!next)
+        return;
+
+    // the change may be months away, so use a wall-clock timer that
+    // keeps counting across suspend and wakes us if the clock is set
+    m_transition_fd = timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC);
+    if (m_transition_fd == -1)
+    {
+        g_warning("unable to create realtime timer: %s", g_strerror(errno));
+        return;
+    }
+
+    struct itimerspec timerval {};
+    timerval.it_value.tv_sec = next;
+    if (timerfd_settime(m_transition_fd, TFD_TIMER_ABSTIME|TFD_TIMER_CANCEL_ON_SET, &timerval, nullptr) == -1)
+    {
+        g_warning("timerfd_settime failed: %s", g_strerror(errno));
+        unset_transition_timer();
+        return;
+    }
+
+    g_debug("%s next location offset change at %" G_GINT64_FORMAT, G_STRLOC, next);
+    m_transition_tag = g_unix_fd_add(m_transition_fd,
+                                     (GIOCondition)(G_IO_IN|G_IO_HUP|G_IO_ERR),
+                                     on_transition_timer,
+                                     this);
+}
+
+gboolean
+SettingsLocations::on_transition_timer(gint fd, GIOCondition, gpointer gself)
+{
+    // drain the timer; this fails with ECANCELED if the clock was set
+    uint64_t n_expirations = 0;
+    if (read(fd, &n_expirations, sizeof(n_expirations)) == -1)
+        g_debug("%s the wall clock changed: %s", G_STRLOC, g_strerror(errno));
+
+    // either way, rebuild the Locations with their current offsets.
+    // that also arms a new timer, so remove this source
+    auto self = static_cast<SettingsLocations*>(gself);
+    self->m_transition_tag = 0;
+    self->reload();
+    return G_SOURCE_REMOVE;
 }
 
 } // namespace datetime
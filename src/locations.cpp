@@ -18,6 +18,7 @@
  */
 
 #include <datetime/locations.h>
+#include <datetime/timezone-registry.h>
 
 #include <glib.h>
 
@@ -35,6 +36,16 @@ const std::string& Location::name() const
     return m_name;
 }
 
+int64_t Location::offset() const
+{
+    return m_offset;
+}
+
+int64_t Location::next_transition() const
+{
+    return m_next_transition;
+}
+
 bool Location::operator== (const Location& that) const
 {
     return (m_name == that.m_name)
@@ -47,11 +58,12 @@ Location::Location(const std::string& zone_, const std::string& name_):
     m_zone(zone_),
     m_name(name_)
 {
-    auto gzone = g_time_zone_new (zone().c_str());
-    auto gtime = g_date_time_new_now (gzone);
+    auto& registry = TimezoneRegistry::instance();
+    auto gzone = registry.get(zone());
+    auto gtime = g_date_time_new_now (gzone.get());
     m_offset = g_date_time_get_utc_offset (gtime);
+    m_next_transition = registry.next_transition(zone(), g_date_time_to_unix(gtime));
     g_date_time_unref (gtime);
-    g_time_zone_unref (gzone);
 }
 
 } // namespace datetime
@@ -18,6 +18,7 @@
  */
 
 #include <datetime/actions-live.h>
+#include <datetime/alarm-latency.h>
 #include <datetime/alarm-queue-simple.h>
 #include <datetime/clock.h>
 #include <datetime/engine-mock.h>
@@ -27,6 +28,7 @@
 #include <datetime/menu.h>
 #include <datetime/myself.h>
 #include <datetime/planner-aggregate.h>
+#include <datetime/planner-alarms.h>
 #include <datetime/planner-snooze.h>
 #include <datetime/planner-range.h>
 #include <datetime/settings-live.h>
@@ -34,7 +36,10 @@
 #include <datetime/state.h>
 #include <datetime/timezones-live.h>
 #include <datetime/timezone-timedated.h>
-#include <datetime/wakeup-timer-powerd.h>
+#include <datetime/wakeup-timer-auto.h>
+#include <datetime/wakeup-timer-mainloop.h>
+#include <datetime/wakeup-timer-timerfd.h>
+#include <bus/bus-registry.h>
 #include <notifications/notifications.h>
 
 #include <glib/gi18n.h> // bindtextdomain()
@@ -65,12 +70,13 @@ namespace
     }
 
     std::shared_ptr<State> create_state(const std::shared_ptr<Engine>& engine,
-                                        const std::shared_ptr<Timezone>& timezone_)
+                                        const std::shared_ptr<Timezone>& timezone_,
+                                        const std::shared_ptr<unity::indicator::bus::BusRegistry>& buses)
     {
         // create the live objects
         auto live_settings = std::make_shared<LiveSettings>();
         auto live_timezones = std::make_shared<LiveTimezones>(live_settings, timezone_);
-        auto live_clock = std::make_shared<LiveClock>(timezone_);
+        auto live_clock = std::make_shared<LiveClock>(timezone_, buses);
 
         // create a full-month planner currently pointing to the current month
         const auto now = live_clock->localtime();
@@ -91,28 +97,65 @@ namespace
         return state;
     }
 
+    std::shared_ptr<WakeupTimer> create_wakeup_timer(const std::shared_ptr<Clock>& clock,
+                                                     const std::shared_ptr<unity::indicator::bus::BusRegistry>& buses,
+                                                     const std::shared_ptr<AlarmLatency>& latency)
+    {
+        // use this until we know whether powerd is around
+        std::shared_ptr<WakeupTimer> fallback;
+        if (TimerfdWakeupTimer::is_supported())
+        {
+            g_debug("using a timerfd for wakeups until powerd shows up");
+            fallback = std::make_shared<TimerfdWakeupTimer>();
+        }
+        else
+        {
+            g_debug("using a mainloop timer for wakeups until powerd shows up");
+            fallback = std::make_shared<MainloopWakeupTimer>(clock);
+        }
+
+        auto timer = std::make_shared<AutoWakeupTimer>(clock, buses, fallback);
+
+        // report how often we wake the hardware next to the alarm latencies
+        std::weak_ptr<AutoWakeupTimer> weak_timer = timer;
+        latency->set_hardware_wakeups_func([weak_timer](){
+            auto timer = weak_timer.lock();
+            return timer ? timer->hardware_wakeups_per_day() : 0u;
+        });
+
+        return timer;
+    }
+
     std::shared_ptr<AlarmQueue> create_simple_alarm_queue(const std::shared_ptr<Clock>& clock,
                                                           const std::shared_ptr<Planner>& snooze_planner,
                                                           const std::shared_ptr<Engine>& engine,
-                                                          const std::shared_ptr<Timezone>& tz)
+                                                          const std::shared_ptr<Timezone>& tz,
+                                                          const std::shared_ptr<unity::indicator::bus::BusRegistry>& buses,
+                                                          const std::shared_ptr<AlarmLatency>& latency)
     {
-        // create an upcoming-events planner that =always= tracks the clock's date
-        auto range_planner = std::make_shared<SimpleRangePlanner>(engine, tz);
-        auto upcoming_planner = std::make_shared<UpcomingPlanner>(range_planner, clock->localtime());
-        clock->date_changed.connect([clock,upcoming_planner](){
+        // create an upcoming-alarms planner that =always= tracks the clock's date
+        auto alarm_planner = std::make_shared<AlarmPlanner>(engine, tz, clock);
+        clock->date_changed.connect([clock,alarm_planner](){
             const auto now = clock->localtime();
-            g_debug("refretching appointments due to date change: %s", now.format("%F %T").c_str());
-            upcoming_planner->date().set(now);
+            g_debug("refretching alarms due to date change: %s", now.format("%F %T").c_str());
+            alarm_planner->date().set(now);
         });
 
         // create an aggregate planner that folds together the above
-        // upcoming-events planner and locally-generated snooze events
+        // upcoming-alarms planner and locally-generated snooze events
         std::shared_ptr<AggregatePlanner> planner = std::make_shared<AggregatePlanner>();
-        planner->add(upcoming_planner);
+        planner->add(alarm_planner);
         planner->add(snooze_planner);
 
-        auto wakeup_timer = std::make_shared<PowerdWakeupTimer>(clock);
-        return std::make_shared<SimpleAlarmQueue>(clock, planner, wakeup_timer);
+        auto wakeup_timer = create_wakeup_timer(clock, buses, latency);
+        auto queue = std::make_shared<SimpleAlarmQueue>(clock, planner, wakeup_timer, latency);
+
+        // every alarm that goes off leaves one fewer in the planner
+        queue->alarm_reached().connect([alarm_planner](const Appointment&, const Alarm&){
+            alarm_planner->refill();
+        });
+
+        return queue;
     }
 }
 
@@ -137,18 +180,27 @@ main(int /*argc*/, char** /*argv*/)
         return 0;
     }
 
+    // share the buses and their name watches among everyone who needs them
+    auto session_bus = g_bus_get_sync(G_BUS_TYPE_SESSION, nullptr, &error);
+    if (error != nullptr) {
+        g_warning("Unable to get session bus: %s", error->message);
+        g_clear_error(&error);
+    }
+    auto buses = std::make_shared<unity::indicator::bus::BusRegistry>(system_bus, session_bus);
+
     auto engine = create_engine();
     auto timezone_ = std::make_shared<TimedatedTimezone>(system_bus);
-    auto state = create_state(engine, timezone_);
+    auto state = create_state(engine, timezone_, buses);
     auto actions = std::make_shared<LiveActions>(state);
-    MenuFactory factory(actions, state);
+    auto menu_factory = std::make_shared<MenuFactory>(actions, state);
 
-    // set up the snap decisions
+    // set up the snap decisions and trace how long their alarms take to reach the user
+    auto latency = std::make_shared<AlarmLatency>(AlarmLatency::default_report_filename());
     auto snooze_planner = std::make_shared<SnoozePlanner>(state->settings, state->clock);
-    auto notification_engine = std::make_shared<uin::Engine>("indicator-datetime-service");
+    auto notification_engine = std::make_shared<uin::Engine>("indicator-datetime-service", buses);
     auto sound_builder = std::make_shared<uin::DefaultSoundBuilder>();
-    std::unique_ptr<Snap> snap (new Snap(notification_engine, sound_builder, state->settings, system_bus));
-    auto alarm_queue = create_simple_alarm_queue(state->clock, snooze_planner, engine, timezone_);
+    std::unique_ptr<Snap> snap (new Snap(notification_engine, sound_builder, state->settings, buses, latency));
+    auto alarm_queue = create_simple_alarm_queue(state->clock, snooze_planner, engine, timezone_, buses, latency);
     auto on_response = [snooze_planner, actions](const Appointment& appointment, const Alarm& alarm, const Snap::Response& response) {
         switch(response) {
             case Snap::Response::Snooze:
@@ -166,23 +218,33 @@ main(int /*argc*/, char** /*argv*/)
         engine->disable_ubuntu_alarm(appointment);
     };
     alarm_queue->alarm_reached().connect(on_alarm_reached);
+    alarm_queue->alarm_upcoming().connect([&snap](const Appointment& appointment, const Alarm& alarm) {
+        snap->prepare(appointment, alarm);
+    });
+    alarm_queue->alarm_withdrawn().connect([&snap](const Appointment& appointment, const Alarm& alarm) {
+        snap->unprepare(appointment, alarm);
+    });
 
-    // create the menus
-    std::vector<std::shared_ptr<Menu>> menus;
-    for(int i=0, n=Menu::NUM_PROFILES; i<n; i++)
-        menus.push_back(factory.buildMenu(Menu::Profile(i)));
-
-    // export them & run until we lose the busname
+    // export the menus & run until we lose the busname.
+    // a session only shows one or two profiles, so they're built on demand
     auto loop = g_main_loop_new(nullptr, false);
     Exporter exporter(state->settings);
     exporter.name_lost().connect([loop](){
         g_message("%s exiting; failed/lost bus ownership", GETTEXT_PACKAGE);
         g_main_loop_quit(loop);
     });
-    exporter.publish(actions, menus);
+    exporter.publish(actions, menu_factory);
+
+    // let the clock stop ticking while no one's looking at a menu
+    auto clock = state->clock;
+    exporter.has_subscribers().changed().connect([clock](bool has_subscribers){
+        clock->has_viewers.set(has_subscribers);
+    });
+    clock->has_viewers.set(exporter.has_subscribers().get());
     g_main_loop_run(loop);
 
     g_main_loop_unref(loop);
+    g_clear_object(&session_bus);
     g_clear_object(&system_bus);
     return 0;
 }
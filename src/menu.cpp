@@ -53,6 +53,28 @@ Menu::Profile Menu::profile() const
     return m_profile;
 }
 
+std::string Menu::profile_name(Profile profile)
+{
+    switch (profile)
+    {
+        case Desktop: return "desktop";
+        case DesktopGreeter: return "desktop_greeter";
+        case Phone: return "phone";
+        case PhoneGreeter: return "phone_greeter";
+        default: g_warn_if_reached(); return "";
+    }
+}
+
+unsigned int Menu::rebuilds_emitted() const
+{
+    return m_rebuilds_emitted;
+}
+
+unsigned int Menu::rebuilds_coalesced() const
+{
+    return m_rebuilds_coalesced;
+}
+
 GMenuModel* Menu::menu_model()
 {
     return G_MENU_MODEL(m_menu);
@@ -163,47 +185,58 @@ protected:
         for (int i=0; i<NUM_SECTIONS; i++)
             update_section(Section(i));
 
-        // listen for state changes so we can update the menu accordingly
-        m_formatter->header.changed().connect([this](const std::string&){
-            update_header();
-        });
-        m_formatter->header_format.changed().connect([this](const std::string&){
-            update_section(Locations); // need to update x-canonical-time-format
-        });
-        m_formatter->relative_format_changed.connect([this](){
-            update_section(Appointments); // uses formatter.relative_format()
-            update_section(Locations); // uses formatter.relative_format()
-        });
-        m_state->settings->show_clock.changed().connect([this](bool){
-            update_header(); // update header's label
-            update_section(Locations); // locations' relative time may have changed
-        });
-        m_state->settings->show_calendar.changed().connect([this](bool){
-            update_section(Calendar);
-        });
-        m_state->settings->show_events.changed().connect([this](bool){
-            update_section(Appointments); // showing events got toggled
-        });
-        m_state->calendar_upcoming->date().changed().connect([this](const DateTime&){
-            update_upcoming(); // our m_upcoming is planner->upcoming() filtered by time
-        });
-        m_state->calendar_upcoming->appointments().changed().connect([this](const std::vector<Appointment>&){
-            update_upcoming(); // our m_upcoming is planner->upcoming() filtered by time
-        });
-        m_state->clock->date_changed.connect([this](){
-            update_section(Calendar); // need to update the Date menuitem
-            update_section(Locations); // locations' relative time may have changed
-        });
-        m_state->clock->minute_changed.connect([this](){
-            update_upcoming(); // our m_upcoming is planner->upcoming() filtered by time
-        });
-        m_state->locations->locations.changed().connect([this](const std::vector<Location>&) {
-            update_section(Locations); // "locations" is the list of Locations we show
-        });
+        // listen for state changes so we can update the menu accordingly.
+        // several of these often fire together, eg a new day changes the
+        // date, the relative format, and the minute, so rather than
+        // rebuilding on each one we mark what's dirty and flush at idle
+        m_connections.push_back(m_formatter->header.changed().connect([this](const std::string&){
+            mark_dirty(DIRTY_HEADER);
+        }));
+        m_connections.push_back(m_formatter->header_format.changed().connect([this](const std::string&){
+            mark_dirty(section_bit(Locations)); // need to update x-canonical-time-format
+        }));
+        m_connections.push_back(m_formatter->relative_format_changed.connect([this](){
+            mark_dirty(section_bit(Appointments) | // uses formatter.relative_format()
+                       section_bit(Locations)); // uses formatter.relative_format()
+        }));
+        m_connections.push_back(m_state->settings->changed_keys.connect([this](const std::set<std::string>& keys){
+            if (keys.count(SETTINGS_SHOW_CLOCK_S)) {
+                mark_dirty(DIRTY_HEADER | // update header's label
+                           section_bit(Locations)); // locations' relative time may have changed
+            }
+            if (keys.count(SETTINGS_SHOW_CALENDAR_S))
+                mark_dirty(section_bit(Calendar));
+            if (keys.count(SETTINGS_SHOW_EVENTS_S))
+                mark_dirty(section_bit(Appointments)); // showing events got toggled
+        }));
+        m_connections.push_back(m_state->calendar_upcoming->date().changed().connect([this](const DateTime&){
+            mark_dirty(DIRTY_UPCOMING); // our m_upcoming is planner->upcoming() filtered by time
+        }));
+        m_connections.push_back(m_state->calendar_upcoming->appointments().changed().connect([this](const std::vector<Appointment>&){
+            // the planner may have moved the same appointments into a new
+            // timezone, which compares equal, so take the new ones regardless
+            m_upcoming_stale = true;
+            mark_dirty(DIRTY_UPCOMING); // our m_upcoming is planner->upcoming() filtered by time
+        }));
+        m_connections.push_back(m_state->clock->date_changed.connect([this](){
+            mark_dirty(section_bit(Calendar) | // need to update the Date menuitem
+                       section_bit(Locations)); // locations' relative time may have changed
+        }));
+        m_connections.push_back(m_state->clock->minute_changed.connect([this](){
+            mark_dirty(DIRTY_UPCOMING); // our m_upcoming is planner->upcoming() filtered by time
+        }));
+        m_connections.push_back(m_state->locations->locations.changed().connect([this](const std::vector<Location>&) {
+            mark_dirty(section_bit(Locations)); // "locations" is the list of Locations we show
+        }));
+
+        // menus can be built long after the planner has loaded,
+        // so don't wait for its next change to pick up appointments
+        mark_dirty(DIRTY_UPCOMING);
     }
 
     virtual ~MenuImpl()
     {
+        cancel_flush();
         g_clear_object(&m_menu);
         g_clear_pointer(&m_serialized_alarm_icon, g_variant_unref);
         g_clear_pointer(&m_serialized_calendar_icon, g_variant_unref);
@@ -217,6 +250,86 @@ protected:
         auto action_name = name() + "-header";
         auto state = create_header_state();
         g_action_group_change_action_state(action_group, action_name.c_str(), state);
+        ++m_rebuilds_emitted;
+    }
+
+    /***
+    ****  Dirty tracking
+    ***/
+
+    // bits 0..NUM_SECTIONS-1 are the sections themselves
+    static constexpr unsigned int DIRTY_HEADER = 1u << NUM_SECTIONS;
+    static constexpr unsigned int DIRTY_UPCOMING = 1u << (NUM_SECTIONS+1);
+
+    // the longest we'll wait for the main loop to go idle before flushing
+    static constexpr guint MAX_FLUSH_LATENCY_MSEC = 100;
+
+    static unsigned int section_bit(Section section)
+    {
+        return 1u << section;
+    }
+
+    void mark_dirty(unsigned int bits)
+    {
+        // count the rebuilds folded into one that's already pending
+        for (unsigned int bit=1; bit<=DIRTY_UPCOMING; bit<<=1)
+            if ((bits & bit) && (m_dirty & bit))
+                ++m_rebuilds_coalesced;
+
+        m_dirty |= bits;
+
+        if (!m_flushing && (m_idle_tag == 0))
+        {
+            m_idle_tag = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, on_flush, this, nullptr);
+            m_latency_tag = g_timeout_add(MAX_FLUSH_LATENCY_MSEC, on_flush, this);
+        }
+    }
+
+    void cancel_flush()
+    {
+        if (m_idle_tag != 0)
+        {
+            g_source_remove(m_idle_tag);
+            m_idle_tag = 0;
+        }
+        if (m_latency_tag != 0)
+        {
+            g_source_remove(m_latency_tag);
+            m_latency_tag = 0;
+        }
+    }
+
+    static gboolean on_flush(gpointer gself)
+    {
+        static_cast<MenuImpl*>(gself)->flush();
+        return G_SOURCE_REMOVE;
+    }
+
+    void flush()
+    {
+        cancel_flush();
+        m_flushing = true;
+
+        // refilter upcoming first; it may dirty the header and appointments
+        if (m_dirty & DIRTY_UPCOMING)
+        {
+            m_dirty &= ~DIRTY_UPCOMING;
+            update_upcoming();
+        }
+
+        const auto dirty = m_dirty;
+        m_dirty = 0;
+        for (int i=0; i<NUM_SECTIONS; i++)
+            if (dirty & section_bit(Section(i)))
+                update_section(Section(i));
+        if (dirty & DIRTY_HEADER)
+            update_header();
+
+        m_flushing = false;
+
+        // if a rebuild dirtied something else, catch it next time
+        if (m_dirty != 0)
+            mark_dirty(0);
     }
 
     void update_upcoming()
@@ -230,16 +343,18 @@ protected:
             ? now.start_of_minute()
             : calendar_day.start_of_day();
 
+        // only look at the appointments that haven't ended yet
         auto upcoming = get_display_appointments(
-            m_state->calendar_upcoming->appointments().get(),
+            m_state->calendar_upcoming->index().ending_after(begin),
             begin
         );
 
-        if (m_upcoming != upcoming)
+        if (m_upcoming_stale || (m_upcoming != upcoming))
         {
+            m_upcoming_stale = false;
             m_upcoming.swap(upcoming);
-            update_header(); // show an 'alarm' icon if there are upcoming alarms
-            update_section(Appointments); // "upcoming" is the list of Appointments we show
+            mark_dirty(DIRTY_HEADER | // show an 'alarm' icon if there are upcoming alarms
+                       section_bit(Appointments)); // "upcoming" is the list of Appointments we show
         }
     }
 
@@ -261,6 +376,7 @@ protected:
     }
 
     std::vector<Appointment> m_upcoming;
+    bool m_upcoming_stale = false;
 
 private:
 
@@ -447,9 +563,20 @@ private:
         return G_MENU_MODEL(menu);
     }
 
-    GMenuModel* create_locations_section(Profile profile)
+    struct LocationRow
     {
-        GMenu* menu = g_menu_new();
+        std::string zone;
+        std::string name;
+        std::string fmt;
+
+        bool operator==(const LocationRow& that) const {
+            return (zone == that.zone) && (name == that.name) && (fmt == that.fmt);
+        }
+    };
+
+    std::vector<LocationRow> get_location_rows(Profile profile) const
+    {
+        std::vector<LocationRow> rows;
 
         if (profile == Desktop || profile == Phone)
         {
@@ -458,20 +585,30 @@ private:
             for(const auto& location : m_state->locations->locations.get())
             {
                 const auto& zone = location.zone();
-                const auto& name = location.name();
                 const auto zone_now = now.to_timezone(zone);
-                const auto fmt = m_formatter->relative_format(zone_now.get());
-                auto detailed_action = g_strdup_printf("indicator.set-location::%s %s", zone.c_str(), name.c_str());
-                auto i = g_menu_item_new (name.c_str(), detailed_action);
-                g_menu_item_set_attribute(i, "x-canonical-type", "s", "com.canonical.indicator.location");
-                g_menu_item_set_attribute(i, "x-canonical-timezone", "s", zone.c_str());
-                g_menu_item_set_attribute(i, "x-canonical-time-format", "s", fmt.c_str());
-                g_menu_append_item (menu, i);
-                g_object_unref(i);
-                g_free(detailed_action);
+                rows.push_back(LocationRow{zone, location.name(), m_formatter->relative_format(zone_now.get())});
             }
         }
 
+        return rows;
+    }
+
+    GMenuModel* create_locations_section(const std::vector<LocationRow>& rows)
+    {
+        GMenu* menu = g_menu_new();
+
+        for(const auto& row : rows)
+        {
+            auto detailed_action = g_strdup_printf("indicator.set-location::%s %s", row.zone.c_str(), row.name.c_str());
+            auto i = g_menu_item_new (row.name.c_str(), detailed_action);
+            g_menu_item_set_attribute(i, "x-canonical-type", "s", "com.canonical.indicator.location");
+            g_menu_item_set_attribute(i, "x-canonical-timezone", "s", row.zone.c_str());
+            g_menu_item_set_attribute(i, "x-canonical-time-format", "s", row.fmt.c_str());
+            g_menu_append_item (menu, i);
+            g_object_unref(i);
+            g_free(detailed_action);
+        }
+
         return G_MENU_MODEL(menu);
     }
 
@@ -502,7 +639,17 @@ private:
         {
             case Calendar: model = create_calendar_section(p); break;
             case Appointments: model = create_appointments_section(p); break;
-            case Locations: model = create_locations_section(p); break;
+            case Locations: {
+                // the Locations section is rebuilt on every date change and
+                // relative-format tick, but its text rarely changes...
+                auto rows = get_location_rows(p);
+                if (m_locations_built && (rows == m_location_rows))
+                    return;
+                m_location_rows.swap(rows);
+                m_locations_built = true;
+                model = create_locations_section(m_location_rows);
+                break;
+            }
             case Settings: model = create_settings_section(p); break;
             default: model = nullptr; g_warn_if_reached();
         }
@@ -512,12 +659,20 @@ private:
             g_menu_remove(m_submenu, section);
             g_menu_insert_section(m_submenu, section, nullptr, model);
             g_object_unref(model);
+            ++m_rebuilds_emitted;
         }
     }
 
 //private:
     GVariant * m_serialized_alarm_icon = nullptr;
     GVariant * m_serialized_calendar_icon = nullptr;
+    std::vector<LocationRow> m_location_rows;
+    bool m_locations_built = false;
+    unsigned int m_dirty = 0;
+    bool m_flushing = false;
+    guint m_idle_tag = 0;
+    guint m_latency_tag = 0;
+    std::vector<core::ScopedConnection> m_connections;
 
 }; // class MenuImpl
 
@@ -560,14 +715,14 @@ class DesktopMenu: public DesktopBaseMenu
 {
 public:
     DesktopMenu(std::shared_ptr<const State>& state_, std::shared_ptr<Actions>& actions_):
-        DesktopBaseMenu(Desktop,"desktop", state_, actions_) {}
+        DesktopBaseMenu(Desktop, profile_name(Desktop), state_, actions_) {}
 };
 
 class DesktopGreeterMenu: public DesktopBaseMenu
 {
 public:
     DesktopGreeterMenu(std::shared_ptr<const State>& state_, std::shared_ptr<Actions>& actions_):
-        DesktopBaseMenu(DesktopGreeter,"desktop_greeter", state_, actions_) {}
+        DesktopBaseMenu(DesktopGreeter, profile_name(DesktopGreeter), state_, actions_) {}
 };
 
 class PhoneBaseMenu: public MenuImpl
@@ -618,7 +773,7 @@ class PhoneMenu: public PhoneBaseMenu
 public:
     PhoneMenu(std::shared_ptr<const State>& state_,
               std::shared_ptr<Actions>& actions_):
-        PhoneBaseMenu(Phone, "phone", state_, actions_) {}
+        PhoneBaseMenu(Phone, profile_name(Phone), state_, actions_) {}
 };
 
 class PhoneGreeterMenu: public PhoneBaseMenu
@@ -626,7 +781,7 @@ class PhoneGreeterMenu: public PhoneBaseMenu
 public:
     PhoneGreeterMenu(std::shared_ptr<const State>& state_,
                      std::shared_ptr<Actions>& actions_):
-        PhoneBaseMenu(PhoneGreeter, "phone_greeter", state_, actions_) {}
+        PhoneBaseMenu(PhoneGreeter, profile_name(PhoneGreeter), state_, actions_) {}
 };
 
 /****
@@ -34,40 +34,70 @@ Myself::Myself()
     reloadEmails();
     g_object_connect(m_accounts_manager.get(),
                      "signal::account-created", on_accounts_changed, this,
-                     "signal::account-deleted", on_accounts_changed, this,
+                     "signal::account-deleted", on_account_deleted, this,
                      "signal::account-updated", on_accounts_changed, this,
                      nullptr);
 }
 
 bool Myself::isMyEmail(const std::string &email)
 {
-    return m_emails.get().count(email) > 0;
+    return emails().get().count(email) > 0;
 }
 
-void Myself::on_accounts_changed(AgManager *, guint, Myself *self)
+void Myself::on_accounts_changed(AgManager *, guint account_id, Myself *self)
 {
-    self->reloadEmails();
+    // account-updated fires on every online-account token refresh,
+    // so only reload the account that changed
+    self->reloadAccount(account_id);
+    self->publishEmails();
+}
+
+void Myself::on_account_deleted(AgManager *, guint account_id, Myself *self)
+{
+    self->m_account_emails.erase(account_id);
+    self->publishEmails();
 }
 
 void Myself::reloadEmails()
 {
-    std::set<std::string> emails;
+    m_account_emails.clear();
 
-    auto manager = m_accounts_manager.get();
-    auto ids = ag_manager_list(manager);
+    auto ids = ag_manager_list(m_accounts_manager.get());
     for (auto l=ids; l!=nullptr; l=l->next)
-    {
-        auto acc = ag_manager_get_account(manager, GPOINTER_TO_UINT(l->data));
-        if (acc) {
-            auto account_name = ag_account_get_display_name(acc);
-            if (account_name != nullptr)
-                emails.insert(account_name);
-            g_object_unref(acc);
-        }
-    }
+        reloadAccount(GPOINTER_TO_UINT(l->data));
     ag_manager_list_free(ids);
 
-    m_emails.set(emails);
+    publishEmails();
+}
+
+void Myself::reloadAccount(guint account_id)
+{
+    std::string email;
+
+    auto acc = ag_manager_get_account(m_accounts_manager.get(), account_id);
+    if (acc) {
+        auto account_name = ag_account_get_display_name(acc);
+        if (account_name != nullptr)
+            email = account_name;
+        g_object_unref(acc);
+    }
+
+    if (email.empty())
+        m_account_emails.erase(account_id);
+    else
+        m_account_emails[account_id] = email;
+}
+
+void Myself::publishEmails()
+{
+    std::set<std::string> emails;
+    for (const auto& kv : m_account_emails)
+        emails.insert(kv.second);
+
+    // listeners re-evaluate calendars when this changes, so don't
+    // emit unless the set really differs
+    if (emails != m_emails.get())
+        m_emails.set(emails);
 }
 
 } // namespace datetime
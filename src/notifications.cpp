@@ -17,10 +17,10 @@
  *   Charles Kerr <charles.kerr@canonical.com>
  */
 
+#include <bus/bus-registry.h>
+#include <notifications/dbus-shared.h>
 #include <notifications/notifications.h>
 
-#include <libnotify/notify.h>
-
 #include <messaging-menu/messaging-menu-app.h>
 #include <messaging-menu/messaging-menu-message.h>
 
@@ -30,6 +30,8 @@
 
 #include <gio/gdesktopappinfo.h>
 
+#include <unistd.h> // getpid()
+
 #include <map>
 #include <set>
 #include <string>
@@ -41,10 +43,6 @@ namespace unity {
 namespace indicator {
 namespace notifications {
 
-static G_DEFINE_QUARK(NotificationKey, notification_key)
-
-static G_DEFINE_QUARK(NotificationAction, notification_action)
-
 /***
 ****
 ***/
@@ -148,8 +146,9 @@ class Engine::Impl
 {
     struct notification_data
     {
-        std::shared_ptr<NotifyNotification> nn;
         Builder::Impl data;
+        guint32 server_id = 0; // zero until the server replies to Notify
+        std::string action;    // the action the user invoked, if any
     };
 
     struct messaging_menu_data
@@ -159,20 +158,31 @@ class Engine::Impl
         Engine::Impl *self;
     };
 
+    struct NotifyCall
+    {
+        std::weak_ptr<bool> alive;
+        Impl* self;
+        int key;
+        std::function<void(int,bool)> on_shown;
+    };
+
 public:
 
-    Impl(const std::string& app_name):
-        m_app_name(app_name)
+    Impl(const std::string& app_name, const std::shared_ptr<bus::BusRegistry>& buses):
+        m_app_name(app_name),
+        m_cancellable(g_cancellable_new())
     {
-        if (!notify_init(app_name.c_str()))
-            g_critical("Unable to initialize libnotify!");
-
         // messaging menu
         auto app_id = calendar_app_id();
         if (!app_id.empty()) {
             m_messaging_app.reset(messaging_menu_app_new(app_id.c_str()), g_object_unref);
             messaging_menu_app_register(m_messaging_app.get());
         }
+
+        if (buses)
+            init_buses(buses);
+        else
+            g_bus_get(G_BUS_TYPE_SESSION, m_cancellable, on_bus_ready, this);
     }
 
     ~Impl()
@@ -180,7 +190,12 @@ public:
         close_all ();
         remove_all ();
 
-        notify_uninit ();
+        g_cancellable_cancel(m_cancellable);
+        g_clear_object(&m_cancellable);
+
+        if (m_signal_tag)
+            g_dbus_connection_signal_unsubscribe(m_bus, m_signal_tag);
+
         if (m_messaging_app)
             messaging_menu_app_unregister (m_messaging_app.get());
     }
@@ -190,9 +205,18 @@ public:
         return m_app_name;
     }
 
-    bool supports_actions() const
+    bool supports_actions()
     {
-        return server_caps().count("actions") != 0;
+        // if the last fetch failed, try again for next time
+        if (m_caps_stale)
+            fetch_caps();
+
+        // until the server has answered, assume it can take actions;
+        // guessing wrong here would make a startup alarm non-interactive
+        if (!m_caps_known)
+            return true;
+
+        return m_caps.count("actions") != 0;
     }
 
     void close_all ()
@@ -204,99 +228,47 @@ public:
             keys.insert (it.first);
 
         for (const int key : keys)
-            close (key);
+            close (key, nullptr);
     }
 
-    void close (int key)
+    void close (int key, std::function<void(bool)> on_closed)
     {
         auto it = m_notifications.find(key);
         if (it != m_notifications.end())
         {
-            // tell the server to close the notification
-            GError * error = nullptr;
-            if (!notify_notification_close (it->second.nn.get(), &error))
-            {
-                g_warning ("Unable to close notification %d: %s", key, error->message);
-                g_error_free (error);
-            }
-         
+            // tell the server to close the notification,
+            // or to close it as soon as we know its id
+            const auto server_id = it->second.server_id;
+            if (server_id != 0)
+                close_on_server(m_bus, server_id, on_closed);
+            else
+                m_close_when_shown[key] = on_closed;
+
             // call the user callback and remove it from our bookkeeping
             remove_closed_notification (key);
         }
     }
 
-    int show (const Builder& builder)
+    int show (const Builder& builder, std::function<void(int,bool)> on_shown)
     {
-        int ret = -1;
         const auto& info = *builder.impl;
 
-        std::shared_ptr<NotifyNotification> nn (
-            notify_notification_new(info.m_title.c_str(),
-                                    info.m_body.c_str(),
-                                    info.m_icon_name.c_str()),
-            [this](NotifyNotification * n) {
-                g_signal_handlers_disconnect_by_data(n, this);
-                g_object_unref (G_OBJECT(n));
-            }
-        );
-
-        if (info.m_duration.count() != 0)
-        {
-            const auto& d= info.m_duration;
-            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(d);
-
-            notify_notification_set_hint (nn.get(),
-                                          HINT_TIMEOUT,
-                                          g_variant_new_int32(ms.count()));
-        }
-
-        for (const auto& hint : info.m_string_hints)
-        {
-            notify_notification_set_hint (nn.get(),
-                                          hint.c_str(),
-                                          g_variant_new_string("true"));
-        }
-
-        for (const auto& action : info.m_actions)
-        {
-            notify_notification_add_action (nn.get(),
-                                            action.first.c_str(),
-                                            action.second.c_str(),
-                                            on_notification_clicked,
-                                            nullptr,
-                                            nullptr);
+        if (!info.m_show_notification_bubble) {
+            post(info);
+            return -1;
         }
 
         static int next_key = 1;
         const int key = next_key++;
-        g_object_set_qdata (G_OBJECT(nn.get()),
-                            notification_key_quark(),
-                            GINT_TO_POINTER(key));
-
-        m_notifications[key] = { nn, info };
-        g_signal_connect (nn.get(), "closed",
-                          G_CALLBACK(on_notification_closed), this);
+        m_notifications[key].data = info;
 
-        if (!info.m_show_notification_bubble) {
-            post(info);
-            return ret;
-        }
-
-        GError * error = nullptr;
-        if (notify_notification_show(nn.get(), &error))
-        {
-            ret = key;
-        }
+        // queue the Notify call until we're connected
+        if (m_bus != nullptr)
+            send_notify(key, on_shown);
         else
-        {
-            g_critical ("Unable to show notification for '%s': %s",
-                        info.m_title.c_str(),
-                        error->message);
-            g_error_free (error);
-            m_notifications.erase(key);
-        }
+            m_pending.push_back([this, key, on_shown](){send_notify(key, on_shown);});
 
-        return ret;
+        return key;
     }
 
     std::string post(const Builder::Impl& data)
@@ -371,43 +343,366 @@ public:
 
 private:
 
-    const std::set<std::string>& server_caps() const
+    /***
+    ****  Bus bootstrapping
+    ***/
+
+    static void on_bus_ready(GObject      * /*source_object*/,
+                             GAsyncResult * res,
+                             gpointer       gself)
     {
-        if (G_UNLIKELY(m_lazy_caps.empty()))
+        GError * error = nullptr;
+        GDBusConnection * bus;
+
+        if ((bus = g_bus_get_finish(res, &error)))
+        {
+            auto buses = std::make_shared<bus::BusRegistry>(nullptr, bus);
+            static_cast<Impl*>(gself)->init_buses(buses);
+            g_object_unref(bus);
+        }
+        else if (error != nullptr)
         {
-            auto caps_gl = notify_get_server_caps();
+            if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+                g_warning("%s Couldn't get session bus: %s", G_STRLOC, error->message);
+
+            g_error_free(error);
+        }
+    }
+
+    void init_buses(const std::shared_ptr<bus::BusRegistry>& buses)
+    {
+        m_buses = buses;
+        m_bus = m_buses->session_bus();
+        if (m_bus == nullptr)
+            return;
+
+        m_signal_tag = g_dbus_connection_signal_subscribe(m_bus,
+                                                          BUS_NOTIFY_NAME,
+                                                          BUS_NOTIFY_INTERFACE,
+                                                          nullptr, // any member
+                                                          BUS_NOTIFY_PATH,
+                                                          nullptr,
+                                                          G_DBUS_SIGNAL_FLAGS_NONE,
+                                                          on_notify_signal,
+                                                          this,
+                                                          nullptr);
+
+        // fetch the capabilities now, before anyone's waiting on them,
+        // and again whenever a new notification server shows up.
+        // While there's no server, keep the last known caps: it's
+        // most likely restarting and will come back with the same ones.
+        fetch_caps();
+        m_connections.push_back(m_buses->watch_name(G_BUS_TYPE_SESSION, BUS_NOTIFY_NAME, [this](const std::string& owner){
+            if (owner.empty() || owner == m_caps_owner)
+                return;
+            // the startup fetch is already talking to the first server we see
+            if (!m_caps_owner.empty() || !m_caps_fetching)
+                fetch_caps();
+            m_caps_owner = owner;
+        }));
+
+        auto pending = std::move(m_pending);
+        for (const auto& func : pending)
+            func();
+    }
+
+    /***
+    ****  GetCapabilities
+    ***/
+
+    void fetch_caps()
+    {
+        if (m_bus == nullptr)
+            return;
+
+        // a fetch is already in flight, but maybe to a server that's gone.
+        // ask again when it's done.
+        if (m_caps_fetching)
+        {
+            m_caps_refetch = true;
+            return;
+        }
+
+        m_caps_fetching = true;
+        m_caps_stale = false;
+        g_dbus_connection_call(m_bus,
+                               BUS_NOTIFY_NAME,
+                               BUS_NOTIFY_PATH,
+                               BUS_NOTIFY_INTERFACE,
+                               "GetCapabilities",
+                               nullptr,
+                               G_VARIANT_TYPE("(as)"),
+                               G_DBUS_CALL_FLAGS_NONE,
+                               -1,
+                               m_cancellable,
+                               on_caps_ready,
+                               this);
+    }
+
+    static void on_caps_ready(GObject      * o,
+                              GAsyncResult * res,
+                              gpointer       gself)
+    {
+        GError * error = nullptr;
+        auto ret = g_dbus_connection_call_finish(G_DBUS_CONNECTION(o), res, &error);
+        if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+            g_error_free(error);
+            return;
+        }
+
+        auto self = static_cast<Impl*>(gself);
+        self->m_caps_fetching = false;
+
+        if (ret == nullptr)
+        {
+            g_debug("%s Unable to get notification server caps: %s", G_STRLOC, error->message);
+            self->m_caps_stale = true;
+
+            // a server that doesn't implement GetCapabilities has none;
+            // for any other failure, keep whatever we knew before
+            if (g_error_matches(error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD))
+            {
+                self->m_caps.clear();
+                self->m_caps_known = true;
+            }
+
+            g_error_free(error);
+        }
+        else
+        {
+            const gchar** caps = nullptr;
+            g_variant_get(ret, "(^a&s)", &caps);
+            self->m_caps.clear();
+            self->m_caps_known = true;
             std::string caps_str;
-            for(auto l=caps_gl; l!=nullptr; l=l->next)
+            for (auto it=caps; it && *it; ++it)
             {
-                m_lazy_caps.insert((const char*)l->data);
+                self->m_caps.insert(*it);
 
-                caps_str += (const char*) l->data;;
-                if (l->next != nullptr)
+                caps_str += *it;
+                if (it[1] != nullptr)
                     caps_str += ", ";
             }
+            g_debug("%s GetCapabilities() returned [%s]", G_STRFUNC, caps_str.c_str());
+
+            g_free(caps);
+            g_variant_unref(ret);
+        }
+
+        if (self->m_caps_refetch)
+        {
+            self->m_caps_refetch = false;
+            self->fetch_caps();
+        }
+    }
+
+    /***
+    ****  Notify
+    ***/
+
+    void send_notify(int key, std::function<void(int,bool)> on_shown)
+    {
+        auto it = m_notifications.find(key);
+        if (it == m_notifications.end())
+        {
+            // closed before we were connected, so there's nothing to close on the server
+            auto closed = m_close_when_shown.find(key);
+            if (closed != m_close_when_shown.end())
+            {
+                auto on_closed = closed->second;
+                m_close_when_shown.erase(closed);
+                if (on_closed)
+                    on_closed(true);
+            }
+            if (on_shown)
+                on_shown(key, false);
+            return;
+        }
+        const auto& info = it->second.data;
+
+        GVariantBuilder actions;
+        g_variant_builder_init(&actions, G_VARIANT_TYPE_STRING_ARRAY);
+        for (const auto& action : info.m_actions)
+        {
+            g_variant_builder_add(&actions, "s", action.first.c_str());
+            g_variant_builder_add(&actions, "s", action.second.c_str());
+        }
+
+        GVariantBuilder hints;
+        g_variant_builder_init(&hints, G_VARIANT_TYPE_VARDICT);
+        if (info.m_duration.count() != 0)
+        {
+            const auto& d= info.m_duration;
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(d);
+
+            g_variant_builder_add(&hints, "{sv}", HINT_TIMEOUT, g_variant_new_int32(ms.count()));
+        }
+        for (const auto& hint : info.m_string_hints)
+            g_variant_builder_add(&hints, "{sv}", hint.c_str(), g_variant_new_string("true"));
+        g_variant_builder_add(&hints, "{sv}", "sender-pid", g_variant_new_int64(getpid()));
+
+        auto args = g_variant_new("(susssasa{sv}i)",
+                                  m_app_name.c_str(),
+                                  guint32(0), // replaces_id
+                                  info.m_icon_name.c_str(),
+                                  info.m_title.c_str(),
+                                  info.m_body.c_str(),
+                                  &actions,
+                                  &hints,
+                                  gint32(-1)); // use the server's default expiry
+
+        // no cancellable: if we're destroyed before the reply,
+        // on_notify_done still needs to close the orphaned bubble
+        g_dbus_connection_call(m_bus,
+                               BUS_NOTIFY_NAME,
+                               BUS_NOTIFY_PATH,
+                               BUS_NOTIFY_INTERFACE,
+                               "Notify",
+                               args,
+                               G_VARIANT_TYPE("(u)"),
+                               G_DBUS_CALL_FLAGS_NONE,
+                               -1,
+                               nullptr,
+                               on_notify_done,
+                               new NotifyCall{m_alive, this, key, on_shown});
+    }
+
+    static void on_notify_done(GObject      * o,
+                               GAsyncResult * res,
+                               gpointer       gcall)
+    {
+        auto call = static_cast<NotifyCall*>(gcall);
+        auto bus = G_DBUS_CONNECTION(o);
+
+        GError * error = nullptr;
+        guint32 server_id = 0;
+        auto ret = g_dbus_connection_call_finish(bus, res, &error);
+        if (ret != nullptr)
+        {
+            g_variant_get(ret, "(u)", &server_id);
+            g_variant_unref(ret);
+        }
+
+        if (call->alive.expired())
+        {
+            if (server_id != 0)
+                close_on_server(bus, server_id, nullptr);
+        }
+        else
+        {
+            auto self = call->self;
+            auto closed = self->m_close_when_shown.find(call->key);
+
+            if (error != nullptr)
+            {
+                auto it = self->m_notifications.find(call->key);
+                g_critical ("Unable to show notification for '%s': %s",
+                            it != self->m_notifications.end() ? it->second.data.m_title.c_str() : "",
+                            error->message);
+                self->m_notifications.erase(call->key);
+                if (closed != self->m_close_when_shown.end())
+                {
+                    if (closed->second)
+                        closed->second(true);
+                    self->m_close_when_shown.erase(closed);
+                }
+            }
+            else if (closed != self->m_close_when_shown.end())
+            {
+                // closed while the Notify call was in flight
+                close_on_server(bus, server_id, closed->second);
+                self->m_close_when_shown.erase(closed);
+            }
+            else
+            {
+                auto it = self->m_notifications.find(call->key);
+                if (it != self->m_notifications.end())
+                {
+                    it->second.server_id = server_id;
+                    self->m_server_ids[server_id] = call->key;
+                }
+            }
 
-            g_debug("%s notify_get_server() returned [%s]", G_STRFUNC, caps_str.c_str());
-            g_list_free_full(caps_gl, g_free);
+            if (call->on_shown)
+                call->on_shown(call->key, error == nullptr);
         }
 
-        return m_lazy_caps;
+        g_clear_error(&error);
+        delete call;
     }
 
-    static void on_notification_clicked (NotifyNotification * nn,
-                                         char               * action,
-                                         gpointer)
+    /***
+    ****  CloseNotification
+    ***/
+
+    static void close_on_server(GDBusConnection* bus, guint32 server_id, std::function<void(bool)> on_closed)
     {
-        g_object_set_qdata_full (G_OBJECT(nn),
-                                 notification_action_quark(),
-                                 g_strdup(action),
-                                 g_free);
+        g_dbus_connection_call(bus,
+                               BUS_NOTIFY_NAME,
+                               BUS_NOTIFY_PATH,
+                               BUS_NOTIFY_INTERFACE,
+                               "CloseNotification",
+                               g_variant_new("(u)", server_id),
+                               nullptr,
+                               G_DBUS_CALL_FLAGS_NONE,
+                               -1,
+                               nullptr,
+                               on_close_done,
+                               on_closed ? new std::function<void(bool)>(on_closed) : nullptr);
     }
 
-    static void on_notification_closed (NotifyNotification * nn, gpointer gself)
+    static void on_close_done(GObject      * o,
+                              GAsyncResult * res,
+                              gpointer       gfunc)
     {
-        const GQuark q = notification_key_quark();
-        const gpointer gkey = g_object_get_qdata(G_OBJECT(nn), q);
-        static_cast<Impl*>(gself)->remove_closed_notification(GPOINTER_TO_INT(gkey));
+        GError * error = nullptr;
+        auto ret = g_dbus_connection_call_finish(G_DBUS_CONNECTION(o), res, &error);
+        if (ret == nullptr)
+            g_warning ("Unable to close notification: %s", error->message);
+
+        auto func = static_cast<std::function<void(bool)>*>(gfunc);
+        if (func != nullptr)
+        {
+            (*func)(ret != nullptr);
+            delete func;
+        }
+
+        g_clear_pointer(&ret, g_variant_unref);
+        g_clear_error(&error);
+    }
+
+    /***
+    ****  Signals
+    ***/
+
+    static void on_notify_signal(GDBusConnection * /*connection*/,
+                                 const gchar     * /*sender_name*/,
+                                 const gchar     * /*object_path*/,
+                                 const gchar     * /*interface_name*/,
+                                 const gchar     * signal_name,
+                                 GVariant        * parameters,
+                                 gpointer          gself)
+    {
+        auto self = static_cast<Impl*>(gself);
+        guint32 server_id = 0;
+
+        if (!g_strcmp0(signal_name, "ActionInvoked") && g_variant_is_of_type(parameters, G_VARIANT_TYPE("(us)")))
+        {
+            const gchar* action = nullptr;
+            g_variant_get(parameters, "(u&s)", &server_id, &action);
+            auto it = self->m_server_ids.find(server_id);
+            if (it != self->m_server_ids.end())
+                self->m_notifications[it->second].action = action;
+        }
+        else if (!g_strcmp0(signal_name, "NotificationClosed") && g_variant_is_of_type(parameters, G_VARIANT_TYPE("(uu)")))
+        {
+            guint32 reason = 0;
+            g_variant_get(parameters, "(uu)", &server_id, &reason);
+            auto it = self->m_server_ids.find(server_id);
+            if (it != self->m_server_ids.end())
+                self->remove_closed_notification(it->second);
+        }
     }
 
     static void on_message_activated (MessagingMenuMessage *,
@@ -437,25 +732,19 @@ private:
         auto it = m_notifications.find(key);
         g_return_if_fail (it != m_notifications.end());
 
-        const auto& ndata = it->second;
-        auto nn = ndata.nn.get();
+        // move it out of our bookkeeping first in case the callback calls close()
+        const auto ndata = it->second;
+        m_notifications.erase(it);
+        m_server_ids.erase(ndata.server_id);
 
         if (ndata.data.m_closed_callback)
         {
-            std::string action;
-            const GQuark q = notification_action_quark();
-            const gpointer p = g_object_get_qdata(G_OBJECT(nn), q);
-            if (p != nullptr)
-                action = static_cast<const char*>(p);
-
-            ndata.data.m_closed_callback (action);
+            ndata.data.m_closed_callback (ndata.action);
             // empty action means that the notification got timeout
             // post a message on messaging menu
-            if (action.empty())
+            if (ndata.action.empty())
                 post(ndata.data);
         }
-
-        m_notifications.erase(it);
     }
 
     static std::string calendar_app_id()
@@ -498,12 +787,32 @@ private:
 
     const std::string m_app_name;
 
+    std::shared_ptr<bus::BusRegistry> m_buses;
+    GDBusConnection* m_bus = nullptr; // owned by m_buses
+    GCancellable* m_cancellable = nullptr;
+    guint m_signal_tag = 0;
+    std::vector<core::ScopedConnection> m_connections;
+
+    // calls waiting for the bus
+    std::vector<std::function<void()>> m_pending;
+
+    // lets in-flight Notify calls know whether we're still here
+    const std::shared_ptr<bool> m_alive {std::make_shared<bool>(true)};
+
     // key-to-data
     std::map<int,notification_data> m_notifications;
+    std::map<guint32,int> m_server_ids;
+
+    // notifications closed before the server told us their ids
+    std::map<int,std::function<void(bool)>> m_close_when_shown;
 
-    // server capabilities.
-    // as the name indicates, don't use this directly: use server_caps() instead
-    mutable std::set<std::string> m_lazy_caps;
+    // server capabilities
+    std::set<std::string> m_caps;
+    std::string m_caps_owner;
+    bool m_caps_known = false;
+    bool m_caps_fetching = false;
+    bool m_caps_refetch = false;
+    bool m_caps_stale = false;
 
     static constexpr char const * HINT_TIMEOUT {"x-canonical-snap-decisions-timeout"};
 };
@@ -512,8 +821,9 @@ private:
 ****
 ***/
 
-Engine::Engine(const std::string& app_name):
-    impl(new Impl(app_name))
+Engine::Engine(const std::string& app_name,
+               const std::shared_ptr<bus::BusRegistry>& buses):
+    impl(new Impl(app_name, buses))
 {
 }
 
@@ -528,9 +838,9 @@ Engine::supports_actions() const
 }
 
 int
-Engine::show(const Builder& builder)
+Engine::show(const Builder& builder, std::function<void(int key, bool shown)> on_shown)
 {
-    return impl->show(builder);
+    return impl->show(builder, on_shown);
 }
 
 void
@@ -540,9 +850,9 @@ Engine::close_all()
 }
 
 void
-Engine::close(int key)
+Engine::close(int key, std::function<void(bool closed)> on_closed)
 {
-    impl->close(key);
+    impl->close(key, on_closed);
 }
 
 const std::string&
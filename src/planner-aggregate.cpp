@@ -33,6 +33,9 @@ public:
     Impl(AggregatePlanner* owner):
         m_owner(owner)
     {
+        m_appointments.changed().connect([this](const std::vector<Appointment>& a){
+            m_index.reset(a);
+        });
     }
 
     ~Impl() =default;
@@ -42,6 +45,11 @@ public:
         return m_appointments;
     }
 
+    const AppointmentIndex& index() const
+    {
+        return m_index;
+    }
+
     void add(const std::shared_ptr<Planner>& planner)
     {
         m_planners.push_back(planner);
@@ -67,6 +75,7 @@ private:
 
     const AggregatePlanner* m_owner = nullptr;
     core::Property<std::vector<Appointment>> m_appointments;
+    AppointmentIndex m_index;
     std::vector<std::shared_ptr<Planner>> m_planners;
     std::vector<core::ScopedConnection> m_connections;
 };
@@ -90,6 +99,12 @@ AggregatePlanner::appointments()
     return impl->appointments();
 }
 
+const AppointmentIndex&
+AggregatePlanner::index()
+{
+    return impl->index();
+}
+
 void
 AggregatePlanner::add(const std::shared_ptr<Planner>& planner)
 {
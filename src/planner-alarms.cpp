@@ -0,0 +1,209 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include <datetime/planner-alarms.h>
+
+#include <algorithm> // std::min(), std::max()
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****
+***/
+
+AlarmPlanner::AlarmPlanner(const std::shared_ptr<Engine>& engine,
+                           const std::shared_ptr<Timezone>& timezone,
+                           const std::shared_ptr<Clock>& clock):
+    m_engine(engine),
+    m_timezone(timezone),
+    m_clock(clock)
+{
+    // keep the index current before anyone else hears about the change
+    m_appointments.changed().connect([this](const std::vector<Appointment>& a){
+        m_index.reset(a);
+    });
+
+    engine->changed().connect([this](){
+        g_debug("AlarmPlanner %p rebuilding soon because Engine %p emitted 'changed' signal", this, m_engine.get());
+        rebuild_soon();
+    });
+
+    m_timezone->timezone.changed().connect([this](const std::string&){
+        rebuild_soon();
+    });
+
+    m_date.changed().connect([this](const DateTime&){
+        rebuild_soon();
+    });
+
+    m_date.set(clock->localtime());
+}
+
+AlarmPlanner::~AlarmPlanner()
+{
+    if (m_rebuild_tag)
+        g_source_remove(m_rebuild_tag);
+}
+
+/***
+****
+***/
+
+int AlarmPlanner::count_pending(const std::vector<Appointment>& appointments) const
+{
+    const auto now = m_clock->localtime().start_of_minute();
+
+    int n = 0;
+    for (const auto& appointment : appointments)
+        for (const auto& alarm : appointment.alarms)
+            if (alarm.time.is_set() && (now <= alarm.time))
+                ++n;
+    return n;
+}
+
+void AlarmPlanner::update_min_horizon(const std::vector<Appointment>& appointments)
+{
+    // an alarm that triggers days ahead of its appointment is only found
+    // if the horizon reaches the appointment, so don't shrink past that
+    constexpr int64_t DAY_USEC {G_USEC_PER_SEC * 60 * 60 * 24};
+    for (const auto& appointment : appointments)
+    {
+        for (const auto& alarm : appointment.alarms)
+        {
+            if (!alarm.time.is_set() || !(alarm.time < appointment.begin))
+                continue;
+            const auto lead_days = int((appointment.begin - alarm.time + DAY_USEC - 1) / DAY_USEC) + 1;
+            m_min_horizon_days = std::max(m_min_horizon_days, std::min(lead_days, int(MAX_HORIZON_DAYS)));
+        }
+    }
+}
+
+bool AlarmPlanner::grow()
+{
+    if (m_horizon_days >= MAX_HORIZON_DAYS)
+        return false;
+
+    m_horizon_days = std::min(m_horizon_days*2, int(MAX_HORIZON_DAYS));
+    return true;
+}
+
+void AlarmPlanner::refill()
+{
+    if (m_fetching || (count_pending(m_appointments.get()) >= MIN_ALARMS))
+        return;
+
+    if (grow())
+    {
+        g_debug("AlarmPlanner %p running low on alarms; looking %d days ahead", this, m_horizon_days);
+        rebuild_soon();
+    }
+}
+
+void AlarmPlanner::rebuild_now()
+{
+    if (m_fetching)
+    {
+        m_refetch = true;
+        return;
+    }
+
+    const auto begin = m_date.get().start_of_day();
+    const auto end = begin.add_days(m_horizon_days);
+    const auto horizon_days = m_horizon_days;
+    g_debug("AlarmPlanner %p fetching alarms in [%s..%s]", this,
+            begin.format("%F %T").c_str(), end.format("%F %T").c_str());
+
+    m_fetching = true;
+    m_engine->get_alarms(begin, end, *m_timezone.get(), [this, horizon_days](const std::vector<Appointment>& a){
+        m_fetching = false;
+        on_alarms_fetched(horizon_days, a);
+    });
+}
+
+void AlarmPlanner::on_alarms_fetched(int horizon_days, const std::vector<Appointment>& a)
+{
+    const auto n_pending = count_pending(a);
+    g_debug("AlarmPlanner %p got %zu appointments, %d pending alarms, in %d days",
+            this, a.size(), n_pending, horizon_days);
+
+    // publish what we've got even if we're about to look further,
+    // so that the alarms we already know about aren't held up
+    m_appointments.set(a);
+    update_min_horizon(a);
+
+    if (m_refetch)
+    {
+        m_refetch = false;
+        rebuild_soon();
+    }
+    else if ((n_pending < MIN_ALARMS) && (horizon_days == m_horizon_days) && grow())
+    {
+        rebuild_now();
+    }
+    else if ((n_pending > 8*MIN_ALARMS) && (m_horizon_days > m_min_horizon_days))
+    {
+        // next time, don't look so far ahead
+        m_horizon_days = std::max(m_horizon_days/2, m_min_horizon_days);
+    }
+}
+
+void AlarmPlanner::rebuild_soon()
+{
+    static const int ARBITRARY_BATCH_MSEC = 200;
+
+    if (m_rebuild_tag == 0)
+        m_rebuild_tag = g_timeout_add(ARBITRARY_BATCH_MSEC, rebuild_now_static, this);
+}
+
+gboolean AlarmPlanner::rebuild_now_static(gpointer gself)
+{
+    auto self = static_cast<AlarmPlanner*>(gself);
+    self->m_rebuild_tag = 0;
+    self->rebuild_now();
+    return G_SOURCE_REMOVE;
+}
+
+/***
+****
+***/
+
+core::Property<std::vector<Appointment>>& AlarmPlanner::appointments()
+{
+    return m_appointments;
+}
+
+const AppointmentIndex& AlarmPlanner::index()
+{
+    return m_index;
+}
+
+core::Property<DateTime>& AlarmPlanner::date()
+{
+    return m_date;
+}
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
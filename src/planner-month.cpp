@@ -51,6 +51,11 @@ core::Property<std::vector<Appointment>>& MonthPlanner::appointments()
     return m_range_planner->appointments();
 }
 
+const AppointmentIndex& MonthPlanner::index()
+{
+    return m_range_planner->index();
+}
+
 
 /***
 ****
@@ -19,6 +19,9 @@
 
 #include <datetime/planner-range.h>
 
+#include <set>
+#include <tuple>
+
 namespace unity {
 namespace indicator {
 namespace datetime {
@@ -33,14 +36,20 @@ SimpleRangePlanner::SimpleRangePlanner(const std::shared_ptr<Engine>& engine,
     m_timezone(timezone),
     m_range(std::pair<DateTime,DateTime>(DateTime::NowLocal(), DateTime::NowLocal()))
 {
+    // keep the index current before anyone else hears about the change
+    m_appointments.changed().connect([this](const std::vector<Appointment>& a){
+        m_index.reset(a);
+    });
+
     engine->changed().connect([this](){
         g_debug("RangePlanner %p rebuilding soon because Engine %p emitted 'changed' signal", this, m_engine.get());
+        invalidate();
         rebuild_soon();
     });
 
     m_timezone->timezone.changed().connect([this](const std::string& s){
-        g_debug("RangePlanner %p rebuilding soon because the timezone changed to '%s'", this, s.c_str());
-        rebuild_soon();
+        g_debug("RangePlanner %p reprojecting because the timezone changed to '%s'", this, s.c_str());
+        reproject(s);
     });
 
     range().changed().connect([this](const std::pair<DateTime,DateTime>&){
@@ -59,16 +68,150 @@ SimpleRangePlanner::~SimpleRangePlanner()
 ****
 ***/
 
+bool SimpleRangePlanner::project(std::vector<Appointment>& appointments, const std::string& zone)
+{
+    bool has_floating = false;
+
+    for (auto& appointment : appointments)
+    {
+        // floating and all-day times would land on different
+        // instants in the new zone, so only the engine can redo them
+        if (appointment.floating)
+        {
+            has_floating = true;
+            continue;
+        }
+
+        appointment.begin = appointment.begin.to_timezone(zone);
+        appointment.end = appointment.end.to_timezone(zone);
+        for (auto& alarm : appointment.alarms)
+            if (alarm.time.is_set())
+                alarm.time = alarm.time.to_timezone(zone);
+    }
+
+    return has_floating;
+}
+
+void SimpleRangePlanner::reproject(const std::string& zone)
+{
+    if (zone.empty())
+    {
+        invalidate();
+        rebuild_soon();
+        return;
+    }
+
+    // the instants don't change, so the vector compares equal to the old
+    // one and set() wouldn't emit; use update() to force the change out
+    bool has_floating = false;
+    m_appointments.update([&zone, &has_floating](std::vector<Appointment>& appointments){
+        has_floating = project(appointments, zone);
+        return !appointments.empty();
+    });
+
+    if (has_floating)
+    {
+        invalidate();
+        rebuild_soon();
+    }
+}
+
+void SimpleRangePlanner::invalidate()
+{
+    m_fetched_valid = false;
+    ++m_generation;
+}
+
 void SimpleRangePlanner::rebuild_now()
 {
-    const auto& r = range().get();
+    // one fetch at a time, so that a slide always builds on finished results
+    if (m_fetching)
+    {
+        m_refetch = true;
+        return;
+    }
+
+    const auto r = range().get();
+    const auto zone = m_timezone->timezone.get();
+    const auto generation = m_generation;
+
+    // if the range only moved forward, eg at midnight,
+    // we already have everything up to m_fetched.second
+    const bool sliding = m_fetched_valid
+                      && (m_fetched.first <= r.first)
+                      && (r.first <= m_fetched.second)
+                      && (m_fetched.second <= r.second);
+    if (sliding && (m_fetched.second == r.second))
+    {
+        on_appointments_fetched(r, true, generation, zone, std::vector<Appointment>());
+        return;
+    }
+
+    const auto begin = sliding ? m_fetched.second : r.first;
+    g_debug("RangePlanner %p fetching [%s..%s]%s", this,
+            begin.format("%F %T").c_str(), r.second.format("%F %T").c_str(),
+            sliding ? " to slide forward" : "");
+
+    m_fetching = true;
+    m_engine->get_appointments(begin, r.second, *m_timezone.get(),
+                               [this, r, sliding, generation, zone](const std::vector<Appointment>& a){
+        m_fetching = false;
+        on_appointments_fetched(r, sliding, generation, zone, a);
+        if (m_refetch)
+        {
+            m_refetch = false;
+            rebuild_soon();
+        }
+    });
+}
+
+void SimpleRangePlanner::on_appointments_fetched(const std::pair<DateTime,DateTime>& r,
+                                                 bool sliding,
+                                                 unsigned generation,
+                                                 const std::string& zone,
+                                                 const std::vector<Appointment>& fetched)
+{
+    g_debug("RangePlanner %p got %zu appointments", this, fetched.size());
+
+    auto a = fetched;
+    if (sliding)
+    {
+        // appointments on the old window's edge come back in the new
+        // fetch too, so prefer the fresh copy of those
+        typedef std::tuple<std::string,std::string,int64_t> Key;
+        std::set<Key> keys;
+        for (const auto& appointment : fetched)
+            keys.insert(Key(appointment.source_uid, appointment.uid, appointment.begin.to_unix()));
+
+        // keep the old appointments that haven't ended yet
+        for (const auto& appointment : appointments().get())
+        {
+            const auto& end = appointment.end.is_set() ? appointment.end : appointment.begin;
+            if ((appointment.begin < r.first) && (end <= r.first))
+                continue;
+            if (keys.count(Key(appointment.source_uid, appointment.uid, appointment.begin.to_unix())))
+                continue;
+            a.push_back(appointment);
+        }
 
-    auto on_appointments_fetched = [this](const std::vector<Appointment>& a){
-        g_debug("RangePlanner %p got %zu appointments", this, a.size());
-        appointments().set(a);
-    };
+        sort(a);
+    }
 
-    m_engine->get_appointments(r.first, r.second, *m_timezone.get(), on_appointments_fetched);
+    if (generation == m_generation)
+    {
+        m_fetched = r;
+        m_fetched_valid = true;
+    }
+
+    // if the timezone changed while the engine was busy, catch up
+    const auto current_zone = m_timezone->timezone.get();
+    if ((current_zone != zone) && !current_zone.empty() && project(a, current_zone))
+    {
+        invalidate();
+        rebuild_soon();
+    }
+
+    appointments().set(a);
 }
 
 void SimpleRangePlanner::rebuild_soon()
@@ -96,6 +239,11 @@ core::Property<std::vector<Appointment>>& SimpleRangePlanner::appointments()
     return m_appointments;
 }
 
+const AppointmentIndex& SimpleRangePlanner::index()
+{
+    return m_index;
+}
+
 core::Property<std::pair<DateTime,DateTime>>& SimpleRangePlanner::range()
 {
     return m_range;
@@ -40,6 +40,9 @@ public:
                 m_settings(settings),
                 m_clock(clock)
     {
+        m_appointments.changed().connect([this](const std::vector<Appointment>& a){
+            m_index.reset(a);
+        });
     }
 
     ~Impl()
@@ -51,6 +54,11 @@ public:
         return m_appointments;
     }
 
+    const AppointmentIndex& index() const
+    {
+        return m_index;
+    }
+
     void add(const Appointment& appt_in, const Alarm& alarm)
     {
         // make a copy of the appointment with only this alarm
@@ -84,6 +92,7 @@ private:
     const std::shared_ptr<Settings> m_settings;
     const std::shared_ptr<Clock> m_clock;
     core::Property<std::vector<Appointment>> m_appointments;
+    AppointmentIndex m_index;
 };
 
 /***
@@ -112,6 +121,12 @@ SnoozePlanner::appointments()
     return impl->appointments();
 }
 
+const AppointmentIndex&
+SnoozePlanner::index()
+{
+    return impl->index();
+}
+
 /***
 ****
 ***/
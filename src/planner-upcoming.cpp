@@ -52,6 +52,11 @@ core::Property<std::vector<Appointment>>& UpcomingPlanner::appointments()
     return m_range_planner->appointments();
 }
 
+const AppointmentIndex& UpcomingPlanner::index()
+{
+    return m_range_planner->index();
+}
+
 /***
 ****
 ***/
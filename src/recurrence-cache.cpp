@@ -0,0 +1,449 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include <datetime/recurrence-cache.h>
+
+#include <glib.h>
+
+#include <algorithm> // std::all_of(), std::lower_bound(), std::max(), std::min_element(), std::sort()
+#include <initializer_list>
+#include <limits>
+#include <set>
+#include <utility> // std::move()
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****
+***/
+
+namespace
+{
+    constexpr int64_t DAY {24*60*60};
+
+    // give up on pathological windows, eg FREQ=SECONDLY with no end.
+    // these are per call: a later window starts counting from zero
+    constexpr size_t MAX_OCCURRENCES {100000};
+    constexpr size_t MAX_SKIPPED {1000000}; // walked before reaching the window
+
+    // how many of the latest windows' occurrences to keep
+    constexpr size_t RECENT_WINDOWS {8};
+
+    constexpr int64_t NONE {std::numeric_limits<int64_t>::max()};
+
+    /**
+     * A wall-clock time's fields read as if they were UTC.
+     * These sort the same as the times themselves within a series
+     * and don't depend on the zone that the series is shown in.
+     */
+    int64_t to_wall_key(const struct icaltimetype& t)
+    {
+        return icaltime_as_timet(t);
+    }
+
+    struct icaltimetype from_wall_key(int64_t key, bool is_date, icaltimezone* zone)
+    {
+        auto t = icaltime_from_timet_with_zone(time_t(key), is_date, nullptr);
+        if (!is_date && (zone != nullptr))
+            icaltime_set_timezone(&t, zone);
+        return t;
+    }
+
+    /**
+     * Something that changes whenever the series does, without
+     * serializing the whole component on every query.
+     * Editors bump SEQUENCE and LAST-MODIFIED; for components that
+     * have no LAST-MODIFIED, use the properties the series is built from.
+     */
+    std::string get_fingerprint(icalcomponent* master)
+    {
+        std::string ret = std::to_string(icalcomponent_get_sequence(master));
+
+        auto p = icalcomponent_get_first_property(master, ICAL_LASTMODIFIED_PROPERTY);
+        if (p != nullptr)
+        {
+            ret += icaltime_as_ical_string(icalproperty_get_lastmodified(p));
+            return ret;
+        }
+
+        for (const auto kind : {ICAL_DTSTART_PROPERTY, ICAL_DTEND_PROPERTY, ICAL_DURATION_PROPERTY,
+                                ICAL_RRULE_PROPERTY, ICAL_RDATE_PROPERTY, ICAL_EXDATE_PROPERTY})
+            for (p=icalcomponent_get_first_property(master, kind); p!=nullptr;
+                 p=icalcomponent_get_next_property(master, kind))
+                ret += icalproperty_as_ical_string(p);
+
+        return ret;
+    }
+
+    /**
+     * The wall-clock key of the latest time that the series can begin,
+     * or NONE if a rule has no UNTIL. An UNTIL's fields may be in UTC,
+     * so callers need to allow a day of slack.
+     */
+    int64_t get_last_key(icalcomponent* master)
+    {
+        auto last = to_wall_key(icalcomponent_get_dtstart(master));
+
+        for (auto p=icalcomponent_get_first_property(master, ICAL_RRULE_PROPERTY); p!=nullptr;
+                  p=icalcomponent_get_next_property(master, ICAL_RRULE_PROPERTY))
+        {
+            const auto until = icalproperty_get_rrule(p).until;
+            if (icaltime_is_null_time(until))
+                return NONE;
+            last = std::max(last, to_wall_key(until));
+        }
+
+        for (auto p=icalcomponent_get_first_property(master, ICAL_RDATE_PROPERTY); p!=nullptr;
+                  p=icalcomponent_get_next_property(master, ICAL_RDATE_PROPERTY))
+        {
+            const auto rdate = icalproperty_get_rdate(p);
+            const auto& t = icaltime_is_null_time(rdate.time) ? rdate.period.start : rdate.time;
+            if (!icaltime_is_null_time(t))
+                last = std::max(last, to_wall_key(t));
+        }
+
+        return last;
+    }
+}
+
+struct RecurrenceCache::Series
+{
+    std::string fingerprint;
+    icaltimezone* zone = nullptr;
+
+    struct icaltimetype dtstart;
+    icaltimezone* dtstart_zone = nullptr; // UTC or whatever libical resolved
+    int64_t duration = 0; // wall-clock seconds
+
+    // the rules being walked, and the next key that each will produce
+    std::vector<icalrecur_iterator*> iterators;
+    std::vector<int64_t> pending;
+
+    // DTSTART and the RDATEs, sorted
+    std::vector<int64_t> rdates;
+    size_t next_rdate = 0;
+
+    std::set<int64_t> exdates;
+    std::set<int64_t> exdate_days; // DATE exdates on a DATE-TIME series
+
+    // every occurrence in [expanded_from..expanded_until), sorted
+    std::vector<int64_t> expanded;
+    int64_t expanded_from = std::numeric_limits<int64_t>::min();
+    int64_t expanded_until = std::numeric_limits<int64_t>::min();
+    int64_t last_key = std::numeric_limits<int64_t>::min();
+
+    // the starts of the latest windows, oldest first
+    std::vector<int64_t> recent_lows;
+
+    ~Series()
+    {
+        for (auto& it : iterators)
+            icalrecur_iterator_free(it);
+    }
+
+    static int64_t next_key(icalrecur_iterator* it)
+    {
+        const auto t = icalrecur_iterator_next(it);
+        return icaltime_is_null_time(t) ? NONE : to_wall_key(t);
+    }
+
+    // true if every rule and rdate has been walked to its end, eg by COUNT
+    bool is_finished() const
+    {
+        return (next_rdate >= rdates.size())
+            && std::all_of(pending.begin(), pending.end(), [](int64_t key){return key == NONE;});
+    }
+
+    bool is_excluded(int64_t key) const
+    {
+        if (exdates.count(key))
+            return true;
+
+        auto day = key / DAY;
+        if (key < 0 && key % DAY)
+            --day;
+        return exdate_days.count(day) != 0;
+    }
+
+    // drop the occurrences that come before every recent window
+    void add_window(int64_t lo)
+    {
+        recent_lows.push_back(lo);
+        if (recent_lows.size() > RECENT_WINDOWS)
+            recent_lows.erase(recent_lows.begin());
+
+        const auto floor = *std::min_element(recent_lows.begin(), recent_lows.end());
+        if (expanded_from < floor)
+        {
+            expanded.erase(expanded.begin(), std::lower_bound(expanded.begin(), expanded.end(), floor));
+            expanded_from = floor;
+        }
+    }
+
+    // walk the rules and rdates until we've seen everything in [lo..hi)
+    void extend(int64_t lo, int64_t hi)
+    {
+        if (hi <= expanded_until)
+            return;
+
+        size_t skipped = 0;
+        size_t in_window = size_t(expanded.end() - std::lower_bound(expanded.begin(), expanded.end(), lo));
+        for (;;)
+        {
+            int64_t key = NONE;
+            size_t src = iterators.size(); // iterators.size() means rdates
+            for (size_t i=0, n=pending.size(); i<n; ++i)
+            {
+                if (pending[i] < key)
+                {
+                    key = pending[i];
+                    src = i;
+                }
+            }
+            if ((next_rdate < rdates.size()) && (rdates[next_rdate] < key))
+            {
+                key = rdates[next_rdate];
+                src = iterators.size();
+            }
+
+            if ((key == NONE) || (key >= hi))
+                break;
+
+            if (src == iterators.size())
+                ++next_rdate;
+            else
+                pending[src] = next_key(iterators[src]);
+
+            // the same time can come from more than one rule
+            if (is_excluded(key) || (last_key >= key))
+                continue;
+            last_key = key;
+
+            // nobody's looking that far back
+            if (key >= expanded_from)
+                expanded.push_back(key);
+
+            // stop here for now; we'll pick up where we left off next time
+            const bool full = key < lo ? (++skipped >= MAX_SKIPPED) : (++in_window >= MAX_OCCURRENCES);
+            if (full)
+            {
+                g_warning("%s series has more than %zu occurrences %s the window; ignoring the rest",
+                          G_STRLOC, key < lo ? MAX_SKIPPED : MAX_OCCURRENCES, key < lo ? "before" : "in");
+                expanded_until = key + 1;
+                return;
+            }
+        }
+
+        expanded_until = hi;
+    }
+};
+
+/***
+****
+***/
+
+RecurrenceCache::RecurrenceCache() =default;
+
+RecurrenceCache::~RecurrenceCache() =default;
+
+bool RecurrenceCache::is_recurring(icalcomponent* icc)
+{
+    return (icalcomponent_get_first_property(icc, ICAL_RRULE_PROPERTY) != nullptr)
+        || (icalcomponent_get_first_property(icc, ICAL_RDATE_PROPERTY) != nullptr);
+}
+
+bool RecurrenceCache::ends_before(icalcomponent* master, time_t t)
+{
+    const auto last_key = get_last_key(master);
+    if (last_key == NONE)
+        return false;
+
+    // allow for the UNTIL being in UTC and for the last occurrence still running
+    const auto duration = std::max(int64_t(icaldurationtype_as_int(icalcomponent_get_duration(master))), DAY);
+    return last_key + duration + 2*DAY < int64_t(t);
+}
+
+std::unique_ptr<RecurrenceCache::Series>
+RecurrenceCache::create_series(icalcomponent* master, icaltimezone* zone)
+{
+    std::unique_ptr<Series> series(new Series());
+    series->zone = zone;
+
+    auto& dtstart = series->dtstart;
+    dtstart = icalcomponent_get_dtstart(master);
+    series->dtstart_zone = icaltime_is_utc(dtstart) ? icaltimezone_get_utc_timezone()
+                                                    : const_cast<icaltimezone*>(dtstart.zone);
+
+    series->duration = icaldurationtype_as_int(icalcomponent_get_duration(master));
+    if ((series->duration <= 0) && dtstart.is_date)
+        series->duration = DAY;
+
+    // give the iterators a zone so that they can compare against a UTC UNTIL
+    auto start = dtstart;
+    if (!start.is_date && (zone != nullptr) && !icaltime_is_utc(start))
+        icaltime_set_timezone(&start, zone);
+
+    for (auto p=icalcomponent_get_first_property(master, ICAL_RRULE_PROPERTY); p!=nullptr;
+              p=icalcomponent_get_next_property(master, ICAL_RRULE_PROPERTY))
+    {
+        auto it = icalrecur_iterator_new(icalproperty_get_rrule(p), start);
+        if (it == nullptr)
+            continue;
+        series->iterators.push_back(it);
+        series->pending.push_back(Series::next_key(it));
+    }
+
+    // DTSTART is always the first occurrence, whether or not the rules match it
+    series->rdates.push_back(to_wall_key(dtstart));
+    for (auto p=icalcomponent_get_first_property(master, ICAL_RDATE_PROPERTY); p!=nullptr;
+              p=icalcomponent_get_next_property(master, ICAL_RDATE_PROPERTY))
+    {
+        const auto rdate = icalproperty_get_rdate(p);
+        const auto& t = icaltime_is_null_time(rdate.time) ? rdate.period.start : rdate.time;
+        if (!icaltime_is_null_time(t))
+            series->rdates.push_back(to_wall_key(t));
+    }
+    std::sort(series->rdates.begin(), series->rdates.end());
+
+    for (auto p=icalcomponent_get_first_property(master, ICAL_EXDATE_PROPERTY); p!=nullptr;
+              p=icalcomponent_get_next_property(master, ICAL_EXDATE_PROPERTY))
+    {
+        auto t = icalproperty_get_exdate(p);
+        if (t.is_date && !dtstart.is_date)
+        {
+            series->exdate_days.insert(to_wall_key(t) / DAY);
+        }
+        else
+        {
+            // a UTC exdate on a zoned series needs to be in the series' wall-clock time
+            if (icaltime_is_utc(t) && !icaltime_is_utc(dtstart) && !dtstart.is_date && (zone != nullptr))
+                t = icaltime_convert_to_zone(t, zone);
+            series->exdates.insert(to_wall_key(t));
+        }
+    }
+
+    return series;
+}
+
+std::vector<RecurrenceCache::Occurrence>
+RecurrenceCache::occurrences(const std::string& source_uid,
+                             icalcomponent* master,
+                             icaltimezone* zone,
+                             time_t begin,
+                             time_t end)
+{
+    std::vector<Occurrence> ret;
+
+    const char* uid = icalcomponent_get_uid(master);
+    if (uid == nullptr)
+        return ret;
+
+    if (zone == nullptr)
+        zone = icaltimezone_get_utc_timezone();
+
+    // don't bother walking a series whose UNTIL is before the window
+    if (ends_before(master, begin))
+    {
+        auto sit = m_sources.find(source_uid);
+        if (sit != m_sources.end())
+            sit->second.erase(uid);
+        return ret;
+    }
+
+    // rebuild the series if it's new or has changed
+    const auto fingerprint = get_fingerprint(master);
+    auto& series = m_sources[source_uid][uid];
+    if (!series || (series->fingerprint != fingerprint) || (series->zone != zone))
+    {
+        series = create_series(master, zone);
+        series->fingerprint = fingerprint;
+    }
+
+    // wall-clock keys are within a day of unix time, and an occurrence
+    // that began before the window can still be running inside of it
+    const int64_t lo = int64_t(begin) - DAY - series->duration;
+    const int64_t hi = int64_t(end) + DAY;
+
+    // a series that's run out (eg by COUNT) before the window has nothing in it
+    if (series->is_finished() && (series->last_key < lo))
+        return ret;
+
+    // if we've already dropped the part that this window needs, walk it again
+    if (lo < series->expanded_from)
+    {
+        auto recent_lows = std::move(series->recent_lows);
+        series = create_series(master, zone);
+        series->fingerprint = fingerprint;
+        series->recent_lows = std::move(recent_lows);
+    }
+
+    series->add_window(lo);
+    series->extend(lo, hi);
+
+    const auto& keys = series->expanded;
+    const bool is_date = series->dtstart.is_date;
+    for (auto it=std::lower_bound(keys.begin(), keys.end(), lo); it!=keys.end() && *it<hi; ++it)
+    {
+        Occurrence occurrence;
+        occurrence.begin = from_wall_key(*it, is_date, series->dtstart_zone);
+        occurrence.end = from_wall_key(*it + series->duration, is_date, series->dtstart_zone);
+
+        // zero-length occurrences overlap the window if they begin inside it
+        const auto occurrence_begin = icaltime_as_timet_with_zone(occurrence.begin, zone);
+        const auto occurrence_end = std::max(occurrence_begin + 1, icaltime_as_timet_with_zone(occurrence.end, zone));
+        if ((occurrence_begin < end) && (begin < occurrence_end))
+            ret.push_back(occurrence);
+    }
+
+    return ret;
+}
+
+void RecurrenceCache::retain(const std::string& source_uid, const std::function<bool(const std::string&)>& keep)
+{
+    auto sit = m_sources.find(source_uid);
+    if (sit == m_sources.end())
+        return;
+
+    auto& series = sit->second;
+    for (auto it=series.begin(); it!=series.end(); )
+    {
+        if (keep(it->first))
+            ++it;
+        else
+            it = series.erase(it);
+    }
+
+    if (series.empty())
+        m_sources.erase(sit);
+}
+
+void RecurrenceCache::clear(const std::string& source_uid)
+{
+    m_sources.erase(source_uid);
+}
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
@@ -39,38 +39,13 @@ LiveSettings::LiveSettings():
     m_settings_cal_notification(g_settings_new_with_path(SETTINGS_NOTIFY_SCHEMA_ID, SETTINGS_NOTIFY_CALENDAR_PATH)),
     m_settings_general_notification(g_settings_new(SETTINGS_NOTIFY_APPS_SCHEMA_ID))
 {
-
-    g_signal_connect (m_settings,                      "changed", G_CALLBACK(on_changed_ccid), this);
-    g_signal_connect (m_settings_cal_notification,     "changed", G_CALLBACK(on_changed_cal_notification), this);
-    g_signal_connect (m_settings_general_notification, "changed", G_CALLBACK(on_changed_general_notification), this);
+    // listen for batches of changes rather than one key at a time
+    g_signal_connect (m_settings,                      "change-event", G_CALLBACK(on_change_event), this);
+    g_signal_connect (m_settings_cal_notification,     "change-event", G_CALLBACK(on_change_event), this);
+    g_signal_connect (m_settings_general_notification, "change-event", G_CALLBACK(on_change_event), this);
 
     // init the Properties from the GSettings backend
-    update_custom_time_format();
-    update_locations();
-    update_show_calendar();
-    update_show_clock();
-    update_show_date();
-    update_show_day();
-    update_show_detected_locations();
-    update_show_events();
-    update_show_locations();
-    update_show_seconds();
-    update_show_week_numbers();
-    update_show_year();
-    update_time_format_mode();
-    update_timezone_name();
-    update_calendar_sound();
-    update_alarm_sound();
-    update_alarm_volume();
-    update_alarm_duration();
-    update_alarm_haptic();
-    update_snooze_duration();
-    update_cal_notification_enabled();
-    update_cal_notification_sounds();
-    update_cal_notification_vibrations();
-    update_cal_notification_bubbles();
-    update_cal_notification_list();
-    update_vibrate_silent_mode();
+    update_all();
 
     // now listen for clients to change the properties s.t. we can sync update GSettings
 
@@ -188,6 +163,38 @@ LiveSettings::LiveSettings():
 ****
 ***/
 
+void LiveSettings::update_all()
+{
+    Transaction transaction(*this);
+
+    update_custom_time_format();
+    update_locations();
+    update_show_calendar();
+    update_show_clock();
+    update_show_date();
+    update_show_day();
+    update_show_detected_locations();
+    update_show_events();
+    update_show_locations();
+    update_show_seconds();
+    update_show_week_numbers();
+    update_show_year();
+    update_time_format_mode();
+    update_timezone_name();
+    update_calendar_sound();
+    update_alarm_sound();
+    update_alarm_volume();
+    update_alarm_duration();
+    update_alarm_haptic();
+    update_snooze_duration();
+    update_cal_notification_enabled();
+    update_cal_notification_sounds();
+    update_cal_notification_vibrations();
+    update_cal_notification_bubbles();
+    update_cal_notification_list();
+    update_vibrate_silent_mode();
+}
+
 void LiveSettings::update_custom_time_format()
 {
     auto val = g_settings_get_string(m_settings, SETTINGS_CUSTOM_TIME_FORMAT_S);
@@ -342,14 +349,6 @@ void LiveSettings::update_vibrate_silent_mode()
 ****
 ***/
 
-void LiveSettings::on_changed_cal_notification(GSettings* /*settings*/,
-                                               gchar*     key,
-                                               gpointer   gself)
-{
-    static_cast<LiveSettings*>(gself)->update_key_cal_notification(key);
-}
-
-
 void LiveSettings::update_key_cal_notification(const std::string& key)
 {
     if (key == SETTINGS_NOTIFY_ENABLED_KEY)
@@ -368,13 +367,6 @@ void LiveSettings::update_key_cal_notification(const std::string& key)
 ****
 ***/
 
-void LiveSettings::on_changed_general_notification(GSettings* /*settings*/,
-                                                   gchar*     key,
-                                                   gpointer   gself)
-{
-    static_cast<LiveSettings*>(gself)->update_key_general_notification(key);
-}
-
 void LiveSettings::update_key_general_notification(const std::string& key)
 {
     if (key == SETTINGS_VIBRATE_SILENT_KEY)
@@ -385,11 +377,38 @@ void LiveSettings::update_key_general_notification(const std::string& key)
 ****
 ***/
 
-void LiveSettings::on_changed_ccid(GSettings* /*settings*/,
-                                   gchar*       key,
-                                   gpointer     gself)
+gboolean LiveSettings::on_change_event(GSettings* settings,
+                                       gpointer   gkeys,
+                                       gint       n_keys,
+                                       gpointer   gself)
+{
+    static_cast<LiveSettings*>(gself)->update_keys(settings, static_cast<GQuark*>(gkeys), n_keys);
+
+    // we've handled them all, so there's no need for per-key "changed" signals
+    return true;
+}
+
+void LiveSettings::update_keys(GSettings* settings, const GQuark* keys, int n_keys)
 {
-    static_cast<LiveSettings*>(gself)->update_key_ccid(key);
+    Transaction transaction(*this);
+
+    // no keys means that anything might have changed
+    if (keys == nullptr)
+    {
+        update_all();
+        return;
+    }
+
+    for (int i=0; i<n_keys; ++i)
+    {
+        const std::string key = g_quark_to_string(keys[i]);
+        if (settings == m_settings)
+            update_key_ccid(key);
+        else if (settings == m_settings_cal_notification)
+            update_key_cal_notification(key);
+        else if (settings == m_settings_general_notification)
+            update_key_general_notification(key);
+    }
 }
 
 void LiveSettings::update_key_ccid(const std::string& key)
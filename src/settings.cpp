@@ -0,0 +1,118 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+
+#include <datetime/settings.h>
+
+#include <functional>
+#include <utility> // std::swap()
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****
+***/
+
+namespace
+{
+    template<typename T>
+    void on_changed(core::Property<T>& property, const std::function<void()>& func)
+    {
+        property.changed().connect([func](const T&){func();});
+    }
+}
+
+Settings::Settings()
+{
+    auto note = [this](const char* key){
+        return [this, key](){on_key_changed(key);};
+    };
+
+    on_changed(custom_time_format, note(SETTINGS_CUSTOM_TIME_FORMAT_S));
+    on_changed(locations, note(SETTINGS_LOCATIONS_S));
+    on_changed(show_calendar, note(SETTINGS_SHOW_CALENDAR_S));
+    on_changed(show_clock, note(SETTINGS_SHOW_CLOCK_S));
+    on_changed(show_date, note(SETTINGS_SHOW_DATE_S));
+    on_changed(show_day, note(SETTINGS_SHOW_DAY_S));
+    on_changed(show_detected_location, note(SETTINGS_SHOW_DETECTED_S));
+    on_changed(show_events, note(SETTINGS_SHOW_EVENTS_S));
+    on_changed(show_locations, note(SETTINGS_SHOW_LOCATIONS_S));
+    on_changed(show_seconds, note(SETTINGS_SHOW_SECONDS_S));
+    on_changed(show_week_numbers, note(SETTINGS_SHOW_WEEK_NUMBERS_S));
+    on_changed(show_year, note(SETTINGS_SHOW_YEAR_S));
+    on_changed(time_format_mode, note(SETTINGS_TIME_FORMAT_S));
+    on_changed(timezone_name, note(SETTINGS_TIMEZONE_NAME_S));
+    on_changed(calendar_sound, note(SETTINGS_CALENDAR_SOUND_S));
+    on_changed(alarm_sound, note(SETTINGS_ALARM_SOUND_S));
+    on_changed(alarm_haptic, note(SETTINGS_ALARM_HAPTIC_S));
+    on_changed(alarm_volume, note(SETTINGS_ALARM_VOLUME_S));
+    on_changed(alarm_duration, note(SETTINGS_ALARM_DURATION_S));
+    on_changed(snooze_duration, note(SETTINGS_SNOOZE_DURATION_S));
+    on_changed(cal_notification_enabled, note(SETTINGS_NOTIFY_ENABLED_KEY));
+    on_changed(cal_notification_sounds, note(SETTINGS_NOTIFY_SOUNDS_KEY));
+    on_changed(cal_notification_vibrations, note(SETTINGS_NOTIFY_VIBRATIONS_KEY));
+    on_changed(cal_notification_bubbles, note(SETTINGS_NOTIFY_BUBBLES_KEY));
+    on_changed(cal_notification_list, note(SETTINGS_NOTIFY_LIST_KEY));
+    on_changed(vibrate_silent_mode, note(SETTINGS_VIBRATE_SILENT_KEY));
+}
+
+void Settings::on_key_changed(const char* key)
+{
+    m_changed_keys.insert(key);
+
+    if (m_transaction_depth == 0)
+        flush_changed_keys();
+}
+
+void Settings::flush_changed_keys()
+{
+    if (m_changed_keys.empty())
+        return;
+
+    // swap them out first in case a listener changes more settings
+    std::set<std::string> keys;
+    std::swap(keys, m_changed_keys);
+    changed_keys(keys);
+}
+
+/***
+****
+***/
+
+Settings::Transaction::Transaction(Settings& settings):
+    m_settings(settings)
+{
+    ++m_settings.m_transaction_depth;
+}
+
+Settings::Transaction::~Transaction()
+{
+    if (--m_settings.m_transaction_depth == 0)
+        m_settings.flush_changed_keys();
+}
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
@@ -19,6 +19,7 @@
 
 #include "dbus-accounts-sound.h"
 
+#include <datetime/alarm-latency.h>
 #include <datetime/snap.h>
 #include <datetime/utils.h> // is_locale_12h()
 
@@ -54,17 +55,19 @@ public:
     Impl(const std::shared_ptr<unity::indicator::notifications::Engine>& engine,
          const std::shared_ptr<unity::indicator::notifications::SoundBuilder>& sound_builder,
          const std::shared_ptr<const Settings>& settings,
-         GDBusConnection* system_bus):
+         const std::shared_ptr<unity::indicator::bus::BusRegistry>& buses,
+         const std::shared_ptr<AlarmLatency>& latency):
       m_engine(engine),
       m_sound_builder(sound_builder),
       m_settings(settings),
       m_cancellable(g_cancellable_new()),
-      m_system_bus{G_DBUS_CONNECTION(g_object_ref(system_bus))}
+      m_buses(buses),
+      m_latency(latency ? latency : std::make_shared<AlarmLatency>(""))
     {
         auto object_path = g_strdup_printf("/org/freedesktop/Accounts/User%lu", (gulong)getuid());
 
 
-        accounts_service_sound_proxy_new(m_system_bus,
+        accounts_service_sound_proxy_new(m_buses->system_bus(),
                                          G_DBUS_PROXY_FLAGS_GET_INVALIDATED_PROPERTIES,
                                          "org.freedesktop.Accounts",
                                          object_path,
@@ -79,7 +82,6 @@ public:
         g_cancellable_cancel(m_cancellable);
         g_clear_object(&m_cancellable);
         g_clear_object(&m_accounts_service_sound_proxy);
-        g_clear_object(&m_system_bus);
 
         for (const auto& key : m_notifications)
             m_engine->close (key);
@@ -89,6 +91,8 @@ public:
                     const Alarm& alarm,
                     response_func on_response)
     {
+        m_latency->mark(AlarmLatency::NOTIFYING);
+
         // If calendar notifications are disabled, don't show them
         if (!appointment.is_ubuntu_alarm() && !calendar_notifications_are_enabled()) {
             g_debug("Skipping disabled calendar event '%s' notification", appointment.summary.c_str());
@@ -104,18 +108,18 @@ public:
         // force the system to stay awake
         std::shared_ptr<uin::Awake> awake;
         if (appointment.is_ubuntu_alarm() || calendar_bubbles_enabled() || calendar_list_enabled()) {
-            awake = std::make_shared<uin::Awake>(m_system_bus, m_engine->app_name());
+            awake = std::make_shared<uin::Awake>(m_buses->system_bus(), m_engine->app_name());
+            m_latency->mark(AlarmLatency::AWAKE);
         }
 
-        // calendar events are muted in silent mode; alarm clocks never are
+        // create the sound.
         std::shared_ptr<uin::Sound> sound;
-        if (appointment.is_ubuntu_alarm() || (calendar_sounds_enabled() && !silent_mode())) {
-            // create the sound.
-            const auto role = appointment.is_ubuntu_alarm() ? "alarm" : "alert";
-            const auto uri = get_alarm_uri(appointment, alarm, m_settings);
-            const auto volume = m_settings->alarm_volume.get();
-            const bool loop = interactive;
+        std::string role, uri;
+        unsigned int volume;
+        bool loop;
+        if (get_sound_params(appointment, alarm, role, uri, volume, loop)) {
             sound = m_sound_builder->create(role, uri, volume, loop);
+            m_latency->mark(AlarmLatency::SOUND);
         }
 
         // create the haptic feedback...
@@ -124,8 +128,10 @@ public:
             // when in silent mode should only vibrate if user defined so
             if (!silent_mode() || vibrate_in_silent_mode_enabled()) {
                 const auto haptic_mode = m_settings->alarm_haptic.get();
-                if (haptic_mode == "pulse")
-                    haptic = std::make_shared<uin::Haptic>(uin::Haptic::MODE_PULSE, appointment.is_ubuntu_alarm());
+                if (haptic_mode == "pulse") {
+                    haptic = std::make_shared<uin::Haptic>(m_buses->session_bus(), uin::Haptic::MODE_PULSE, appointment.is_ubuntu_alarm());
+                    m_latency->mark(AlarmLatency::HAPTIC);
+                }
             }
         }
 
@@ -192,11 +198,34 @@ public:
         b.set_show_notification_bubble(appointment.is_ubuntu_alarm() || calendar_bubbles_enabled());
         b.set_post_to_messaging_menu(appointment.is_ubuntu_alarm() || calendar_list_enabled());
 
-        const auto key = m_engine->show(b);
+        // it's shown when the server says so, not when the request is queued
+        auto latency = m_latency;
+        const auto key = m_engine->show(b, [latency, appointment, alarm](int, bool shown){
+            if (shown)
+                latency->mark(appointment, alarm, AlarmLatency::SHOWN);
+        });
         if (key)
             m_notifications.insert (key);
     }
 
+    void prepare(const Appointment& appointment, const Alarm& alarm)
+    {
+        std::string role, uri;
+        unsigned int volume;
+        bool loop;
+        if (get_sound_params(appointment, alarm, role, uri, volume, loop))
+            m_sound_builder->preload(role, uri, volume, loop);
+    }
+
+    void unprepare(const Appointment& appointment, const Alarm& alarm)
+    {
+        std::string role, uri;
+        unsigned int volume;
+        bool loop;
+        if (get_sound_params(appointment, alarm, role, uri, volume, loop))
+            m_sound_builder->unload(role, uri, volume, loop);
+    }
+
 private:
 
     bool calendar_notifications_are_enabled() const
@@ -260,6 +289,25 @@ private:
             && (accounts_service_sound_get_other_vibrate(m_accounts_service_sound_proxy));
     }
 
+    // returns false if the appointment shouldn't make a sound
+    bool get_sound_params(const Appointment& appointment,
+                          const Alarm& alarm,
+                          std::string& role,
+                          std::string& uri,
+                          unsigned int& volume,
+                          bool& loop) const
+    {
+        // calendar events are muted in silent mode; alarm clocks never are
+        if (!appointment.is_ubuntu_alarm() && (!calendar_sounds_enabled() || silent_mode()))
+            return false;
+
+        role = appointment.is_ubuntu_alarm() ? "alarm" : "alert";
+        uri = get_alarm_uri(appointment, alarm, m_settings);
+        volume = m_settings->alarm_volume.get();
+        loop = appointment.is_ubuntu_alarm() && m_engine->supports_actions();
+        return true;
+    }
+
     std::string get_alarm_uri(const Appointment& appointment,
                               const Alarm& alarm,
                               const std::shared_ptr<const Settings>& settings) const
@@ -301,7 +349,8 @@ private:
     std::set<int> m_notifications;
     GCancellable * m_cancellable {nullptr};
     AccountsServiceSound * m_accounts_service_sound_proxy {nullptr};
-    GDBusConnection * m_system_bus {nullptr};
+    std::shared_ptr<unity::indicator::bus::BusRegistry> m_buses;
+    const std::shared_ptr<AlarmLatency> m_latency;
 
     static constexpr char const * ACTION_NONE {"none"};
     static constexpr char const * ACTION_SNOOZE {"snooze"};
@@ -315,8 +364,9 @@ private:
 Snap::Snap(const std::shared_ptr<unity::indicator::notifications::Engine>& engine,
            const std::shared_ptr<unity::indicator::notifications::SoundBuilder>& sound_builder,
            const std::shared_ptr<const Settings>& settings,
-           GDBusConnection* system_bus):
-  impl(new Impl(engine, sound_builder, settings, system_bus))
+           const std::shared_ptr<unity::indicator::bus::BusRegistry>& buses,
+           const std::shared_ptr<AlarmLatency>& latency):
+  impl(new Impl(engine, sound_builder, settings, buses, latency))
 {
 }
 
@@ -332,6 +382,20 @@ Snap::operator()(const Appointment& appointment,
   (*impl)(appointment, alarm, on_response);
 }
 
+void
+Snap::prepare(const Appointment& appointment,
+              const Alarm& alarm)
+{
+  impl->prepare(appointment, alarm);
+}
+
+void
+Snap::unprepare(const Appointment& appointment,
+                const Alarm& alarm)
+{
+  impl->unprepare(appointment, alarm);
+}
+
 /***
 ****
 ***/
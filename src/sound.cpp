@@ -41,7 +41,8 @@ public:
     Impl(const std::string& role,
          const std::string& uri,
          unsigned int volume,
-         bool loop):
+         bool loop,
+         bool autoplay):
         m_role(role),
         m_uri(uri),
         m_volume(volume),
@@ -64,11 +65,21 @@ public:
         m_watch_source = gst_bus_add_watch(bus, bus_callback, this);
         gst_object_unref(bus);
 
-        g_debug("Playing '%s'", m_uri.c_str());
         g_object_set(G_OBJECT (m_play), "uri", m_uri.c_str(),
                                         "volume", get_volume(),
                                         nullptr);
-        gst_element_set_state (m_play, GST_STATE_PLAYING);
+
+        if (autoplay)
+        {
+            play();
+        }
+        else
+        {
+            // do the typefinding and decoder setup now so that
+            // play() only needs to change the state
+            g_debug("Prerolling '%s'", m_uri.c_str());
+            gst_element_set_state (m_play, GST_STATE_PAUSED);
+        }
     }
 
     ~Impl()
@@ -82,6 +93,17 @@ public:
         }
     }
 
+    void play()
+    {
+        g_debug("Playing '%s'", m_uri.c_str());
+        gst_element_set_state (m_play, GST_STATE_PLAYING);
+    }
+
+    bool is_broken() const
+    {
+        return m_broken;
+    }
+
 private:
 
     // convert settings range [1..100] to gst playbin's range is [0...1.0]
@@ -102,7 +124,15 @@ private:
         auto self = static_cast<Impl*>(gself);
         const auto message_type = GST_MESSAGE_TYPE(msg);
 
-        if ((message_type == GST_MESSAGE_EOS) && (self->m_loop))
+        if (message_type == GST_MESSAGE_ERROR)
+        {
+            GError* error = nullptr;
+            gst_message_parse_error(msg, &error, nullptr);
+            g_warning("Unable to play '%s': %s", self->m_uri.c_str(), error ? error->message : "unknown error");
+            g_clear_error(&error);
+            self->m_broken = true;
+        }
+        else if ((message_type == GST_MESSAGE_EOS) && (self->m_loop))
         {
             gst_element_seek(self->m_play,
                              1.0,
@@ -147,10 +177,11 @@ private:
     const bool m_loop;
     guint m_watch_source = 0;
     GstElement* m_play = nullptr;
+    bool m_broken = false;
 };
 
-Sound::Sound(const std::string& role, const std::string& uri, unsigned int volume, bool loop):
-  impl (new Impl(role, uri, volume, loop))
+Sound::Sound(const std::string& role, const std::string& uri, unsigned int volume, bool loop, bool autoplay):
+  impl (new Impl(role, uri, volume, loop, autoplay))
 {
 }
 
@@ -158,6 +189,99 @@ Sound::~Sound()
 {
 }
 
+void Sound::play()
+{
+    impl->play();
+}
+
+bool Sound::is_broken() const
+{
+    return impl->is_broken();
+}
+
+/***
+****
+***/
+
+DefaultSoundBuilder::~DefaultSoundBuilder()
+{
+    clear_preload();
+}
+
+std::shared_ptr<Sound>
+DefaultSoundBuilder::create(const std::string& role, const std::string& uri, unsigned int volume, bool loop)
+{
+    std::shared_ptr<Sound> sound;
+
+    if (preloaded_matches(role, uri, volume, loop) && !m_preloaded->is_broken())
+    {
+        sound.swap(m_preloaded);
+        clear_preload();
+        sound->play();
+    }
+    else
+    {
+        sound = std::make_shared<Sound>(role, uri, volume, loop);
+    }
+
+    return sound;
+}
+
+void
+DefaultSoundBuilder::preload(const std::string& role, const std::string& uri, unsigned int volume, bool loop)
+{
+    // don't hold an idle pipeline open for long if it's never used
+    static constexpr guint PRELOAD_TTL_SECONDS {120};
+
+    if (m_expire_tag)
+        g_source_remove(m_expire_tag);
+    m_expire_tag = g_timeout_add_seconds(PRELOAD_TTL_SECONDS, on_preload_expired, this);
+
+    if (preloaded_matches(role, uri, volume, loop) && !m_preloaded->is_broken())
+        return;
+
+    m_role = role;
+    m_uri = uri;
+    m_volume = volume;
+    m_loop = loop;
+    m_preloaded = std::make_shared<Sound>(role, uri, volume, loop, false);
+}
+
+void
+DefaultSoundBuilder::unload(const std::string& role, const std::string& uri, unsigned int volume, bool loop)
+{
+    // release the audio sink now rather than waiting for the preload to expire
+    if (preloaded_matches(role, uri, volume, loop))
+        clear_preload();
+}
+
+void
+DefaultSoundBuilder::clear_preload()
+{
+    if (m_expire_tag)
+    {
+        g_source_remove(m_expire_tag);
+        m_expire_tag = 0;
+    }
+
+    m_preloaded.reset();
+}
+
+int
+DefaultSoundBuilder::on_preload_expired(void* gself)
+{
+    auto self = static_cast<DefaultSoundBuilder*>(gself);
+    self->m_expire_tag = 0;
+    self->m_preloaded.reset();
+    return G_SOURCE_REMOVE;
+}
+
+bool
+DefaultSoundBuilder::preloaded_matches(const std::string& role, const std::string& uri, unsigned int volume, bool loop) const
+{
+    return m_preloaded && (m_role == role) && (m_uri == uri) && (m_volume == volume) && (m_loop == loop);
+}
+
 /***
 ****
 ***/
@@ -0,0 +1,285 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include <datetime/timezone-registry.h>
+
+#include <gio/gio.h>
+
+#include <algorithm> // std::upper_bound()
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****
+***/
+
+class TimezoneRegistry::Impl
+{
+public:
+
+    Impl()
+    {
+        // /etc/localtime is rewritten when the user picks a new zone;
+        // tzdata.zi at the top of the zoneinfo dir is rewritten on every
+        // tzdata upgrade, so a directory monitor there catches package updates
+        // bind the monitors to the default main context rather than
+        // to whichever thread happens to call instance() first
+        g_main_context_push_thread_default(g_main_context_default());
+        const char* paths[] = { "/etc/localtime", "/usr/share/zoneinfo" };
+        for (const auto& path : paths)
+        {
+            auto file = g_file_new_for_path(path);
+            auto monitor = g_file_monitor(file, G_FILE_MONITOR_NONE, nullptr, nullptr);
+            if (monitor != nullptr)
+            {
+                g_signal_connect(monitor, "changed", G_CALLBACK(on_file_changed), this);
+                m_monitors.push_back(monitor);
+            }
+            g_object_unref(file);
+        }
+        g_main_context_pop_thread_default(g_main_context_default());
+    }
+
+    ~Impl()
+    {
+        if (m_flush_tag)
+            g_source_remove(m_flush_tag);
+
+        for (auto& monitor : m_monitors)
+        {
+            g_signal_handlers_disconnect_by_data(monitor, this);
+            g_object_unref(monitor);
+        }
+    }
+
+    std::shared_ptr<GTimeZone> get(const std::string& zone)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return lookup(zone).gtz;
+    }
+
+    std::shared_ptr<GTimeZone> get_local()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // g_time_zone_new_local() honors $TZ, so watch for it to change
+        const char* tz = g_getenv("TZ");
+        const std::string tzenv = tz ? tz : "";
+        if (!m_local || (tzenv != m_local_tzenv))
+        {
+            m_local = wrap(g_time_zone_new_local());
+            m_local_tzenv = tzenv;
+        }
+
+        return m_local;
+    }
+
+    int64_t next_transition(const std::string& zone, int64_t after)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // the table must reach a full year past 'after'
+        auto& entry = lookup(zone);
+        if ((after < entry.table_begin) || (entry.table_end < after + YEAR))
+            build_transitions(entry, after);
+
+        const auto& t = entry.transitions;
+        const auto it = std::upper_bound(t.begin(), t.end(), after);
+        return it != t.end() ? *it : 0;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_zones.clear();
+        m_local.reset();
+    }
+
+    core::Signal<>& changed()
+    {
+        return m_changed;
+    }
+
+private:
+
+    struct Entry
+    {
+        std::shared_ptr<GTimeZone> gtz;
+
+        /** the span [table_begin..table_end) covered by transitions */
+        int64_t table_begin = 0;
+        int64_t table_end = 0;
+
+        /** sorted unix times at which the zone's UTC offset changes */
+        std::vector<int64_t> transitions;
+    };
+
+    static constexpr int64_t DAY {24*60*60};
+    static constexpr int64_t YEAR {366*DAY};
+
+    static std::shared_ptr<GTimeZone> wrap(GTimeZone* gtz)
+    {
+        return std::shared_ptr<GTimeZone>(gtz, [](GTimeZone* z){g_time_zone_unref(z);});
+    }
+
+    // m_mutex must be held
+    Entry& lookup(const std::string& zone)
+    {
+        auto it = m_zones.find(zone);
+        if (it == m_zones.end())
+        {
+            Entry entry;
+            entry.gtz = wrap(g_time_zone_new(zone.c_str()));
+            it = m_zones.insert(std::make_pair(zone, entry)).first;
+        }
+        return it->second;
+    }
+
+    static int32_t offset_at(GTimeZone* gtz, int64_t t)
+    {
+        const auto interval = g_time_zone_find_interval(gtz, G_TIME_TYPE_UNIVERSAL, t);
+        return g_time_zone_get_offset(gtz, interval);
+    }
+
+    /**
+     * GTimeZone doesn't expose its transitions, so probe the offset
+     * once a day over the next two years and bisect each day where the
+     * offset changed to find the transition to the second.
+     * Since lookups need a year of lookahead, this runs about once
+     * per zone per year.
+     */
+    static void build_transitions(Entry& entry, int64_t begin)
+    {
+        constexpr int64_t SPAN {2*YEAR};
+
+        auto gtz = entry.gtz.get();
+        entry.transitions.clear();
+        entry.table_begin = begin;
+        entry.table_end = begin + SPAN;
+
+        auto prev_t = begin;
+        auto prev_offset = offset_at(gtz, prev_t);
+        for (auto t=begin+DAY; t<=entry.table_end; t+=DAY)
+        {
+            const auto offset = offset_at(gtz, t);
+            if (offset != prev_offset)
+            {
+                // bisect to find the first second with the new offset
+                auto lo = prev_t;
+                auto hi = t;
+                while (hi - lo > 1)
+                {
+                    const auto mid = lo + (hi - lo) / 2;
+                    if (offset_at(gtz, mid) == prev_offset)
+                        lo = mid;
+                    else
+                        hi = mid;
+                }
+                entry.transitions.push_back(hi);
+            }
+            prev_t = t;
+            prev_offset = offset;
+        }
+    }
+
+    static void on_file_changed(GFileMonitor*, GFile*, GFile*, GFileMonitorEvent, gpointer gself)
+    {
+        // a tzdata upgrade touches many files, so batch them
+        auto self = static_cast<Impl*>(gself);
+        std::lock_guard<std::mutex> lock(self->m_mutex);
+        if (self->m_flush_tag == 0)
+            self->m_flush_tag = g_timeout_add_seconds(1, on_flush_timeout, gself);
+    }
+
+    static gboolean on_flush_timeout(gpointer gself)
+    {
+        auto self = static_cast<Impl*>(gself);
+        {
+            std::lock_guard<std::mutex> lock(self->m_mutex);
+            self->m_flush_tag = 0;
+        }
+        g_debug("%s tzdata changed; flushing the timezone registry", G_STRLOC);
+        self->clear();
+        self->m_changed();
+        return G_SOURCE_REMOVE;
+    }
+
+    std::mutex m_mutex;
+    std::map<std::string,Entry> m_zones;
+    std::shared_ptr<GTimeZone> m_local;
+    std::string m_local_tzenv;
+    std::vector<GFileMonitor*> m_monitors;
+    guint m_flush_tag = 0; // guarded by m_mutex
+    core::Signal<> m_changed;
+};
+
+/***
+****
+***/
+
+TimezoneRegistry::TimezoneRegistry():
+    impl(new Impl())
+{
+}
+
+TimezoneRegistry::~TimezoneRegistry() =default;
+
+TimezoneRegistry& TimezoneRegistry::instance()
+{
+    static TimezoneRegistry registry;
+    return registry;
+}
+
+std::shared_ptr<GTimeZone> TimezoneRegistry::get(const std::string& zone)
+{
+    return impl->get(zone);
+}
+
+std::shared_ptr<GTimeZone> TimezoneRegistry::get_local()
+{
+    return impl->get_local();
+}
+
+int64_t TimezoneRegistry::next_transition(const std::string& zone, int64_t after)
+{
+    return impl->next_transition(zone, after);
+}
+
+void TimezoneRegistry::clear()
+{
+    impl->clear();
+}
+
+core::Signal<>& TimezoneRegistry::changed()
+{
+    return impl->changed();
+}
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
@@ -0,0 +1,206 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include <datetime/wakeup-timer-auto.h>
+#include <datetime/wakeup-timer-powerd.h>
+
+#include <notifications/dbus-shared.h> // BUS_POWERD_NAME
+
+#include <gio/gio.h>
+
+#include <vector>
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****
+***/
+
+class AutoWakeupTimer::Impl
+{
+public:
+
+    Impl(const std::shared_ptr<Clock>& clock,
+         const std::shared_ptr<unity::indicator::bus::BusRegistry>& buses,
+         const std::shared_ptr<WakeupTimer>& fallback):
+        m_clock(clock),
+        m_buses(buses),
+        m_cancellable(g_cancellable_new())
+    {
+        use_timer(fallback);
+
+        // if powerd is running, the watch tells us...
+        m_connections.push_back(m_buses->watch_name(G_BUS_TYPE_SYSTEM, BUS_POWERD_NAME, [this](const std::string& owner){
+            if (!owner.empty())
+                use_powerd();
+        }));
+
+        // ...and if it can be started on demand, the bus daemon does
+        auto bus = m_buses->system_bus();
+        if (bus != nullptr)
+        {
+            g_dbus_connection_call(bus,
+                                   "org.freedesktop.DBus",
+                                   "/org/freedesktop/DBus",
+                                   "org.freedesktop.DBus",
+                                   "ListActivatableNames",
+                                   nullptr,
+                                   G_VARIANT_TYPE("(as)"),
+                                   G_DBUS_CALL_FLAGS_NONE,
+                                   -1,
+                                   m_cancellable,
+                                   on_activatable_names,
+                                   this);
+        }
+    }
+
+    ~Impl()
+    {
+        m_connections.clear();
+        m_timer_connections.clear();
+        g_cancellable_cancel(m_cancellable);
+        g_clear_object(&m_cancellable);
+    }
+
+    void set_wakeup_time(const DateTime& d)
+    {
+        m_wakeup_time = d;
+        m_timer->set_wakeup_time(d);
+    }
+
+    core::Signal<>& timeout()
+    {
+        return m_timeout;
+    }
+
+    bool uses_powerd() const
+    {
+        return m_powerd != nullptr;
+    }
+
+    unsigned int hardware_wakeups_per_day() const
+    {
+        return m_powerd ? m_powerd->hardware_wakeups_per_day() : 0;
+    }
+
+private:
+
+    void use_timer(const std::shared_ptr<WakeupTimer>& timer)
+    {
+        m_timer_connections.clear();
+        m_timer = timer;
+        m_timer_connections.push_back(m_timer->timeout().connect([this](){m_timeout();}));
+
+        if (m_wakeup_time.is_set())
+            m_timer->set_wakeup_time(m_wakeup_time);
+    }
+
+    void use_powerd()
+    {
+        if (m_powerd)
+            return;
+
+        g_debug("%s switching to powerd for wakeups", G_STRLOC);
+        m_powerd = std::make_shared<PowerdWakeupTimer>(m_clock, m_buses);
+        use_timer(m_powerd); // drops the fallback
+    }
+
+    static void on_activatable_names(GObject* source, GAsyncResult* res, gpointer gself)
+    {
+        GError* error = nullptr;
+        auto ret = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), res, &error);
+        if (error != nullptr)
+        {
+            if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+                g_warning("%s couldn't list activatable names: %s", G_STRLOC, error->message);
+            g_error_free(error);
+            return;
+        }
+
+        bool found = false;
+        const gchar** names = nullptr;
+        g_variant_get(ret, "(^a&s)", &names);
+        for (auto it=names; !found && it && *it; ++it)
+            found = !g_strcmp0(*it, BUS_POWERD_NAME);
+        g_free(names);
+        g_variant_unref(ret);
+
+        if (found)
+            static_cast<Impl*>(gself)->use_powerd();
+    }
+
+    const std::shared_ptr<Clock> m_clock;
+    const std::shared_ptr<unity::indicator::bus::BusRegistry> m_buses;
+    GCancellable* m_cancellable = nullptr;
+    core::Signal<> m_timeout;
+    std::shared_ptr<WakeupTimer> m_timer;
+    std::shared_ptr<PowerdWakeupTimer> m_powerd;
+    DateTime m_wakeup_time;
+    std::vector<core::ScopedConnection> m_connections;
+    std::vector<core::ScopedConnection> m_timer_connections;
+};
+
+/***
+****
+***/
+
+AutoWakeupTimer::AutoWakeupTimer(const std::shared_ptr<Clock>& clock,
+                                 const std::shared_ptr<unity::indicator::bus::BusRegistry>& buses,
+                                 const std::shared_ptr<WakeupTimer>& fallback):
+    p(new Impl(clock, buses, fallback))
+{
+}
+
+AutoWakeupTimer::~AutoWakeupTimer()
+{
+}
+
+void
+AutoWakeupTimer::set_wakeup_time(const DateTime& d)
+{
+    p->set_wakeup_time(d);
+}
+
+core::Signal<>&
+AutoWakeupTimer::timeout()
+{
+    return p->timeout();
+}
+
+bool
+AutoWakeupTimer::uses_powerd() const
+{
+    return p->uses_powerd();
+}
+
+unsigned int
+AutoWakeupTimer::hardware_wakeups_per_day() const
+{
+    return p->hardware_wakeups_per_day();
+}
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
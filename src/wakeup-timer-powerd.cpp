@@ -20,11 +20,15 @@
 #include <datetime/clock.h>
 #include <datetime/wakeup-timer-powerd.h>
 
+#include <notifications/awake.h>
 #include <notifications/dbus-shared.h> // BUS_POWERD_NAME
 
 #include <gio/gio.h>
 
-#include <memory> // std::shared_ptr
+#include <algorithm> // std::max()
+#include <deque>
+#include <memory> // std::shared_ptr, std::unique_ptr
+#include <vector>
 
 namespace unity {
 namespace indicator {
@@ -38,25 +42,27 @@ class PowerdWakeupTimer::Impl
 {
 public:
 
-    Impl(const std::shared_ptr<Clock>& clock):
+    Impl(const std::shared_ptr<Clock>& clock,
+         const std::shared_ptr<unity::indicator::bus::BusRegistry>& buses,
+         int slack_seconds):
         m_clock(clock),
+        m_slack_usec(int64_t(slack_seconds) * G_USEC_PER_SEC),
+        m_buses(buses),
         m_cancellable(g_cancellable_new())
     {
-        g_bus_get(G_BUS_TYPE_SYSTEM, m_cancellable, on_bus_ready, this);
+        init_bus();
     }
 
     ~Impl()
     {
-        clear_current_cookie();
+        cancel_bridge();
+        clear_cookie(m_cookie);
 
         g_cancellable_cancel(m_cancellable);
         g_clear_object(&m_cancellable);
 
         if (m_sub_id)
-            g_dbus_connection_signal_unsubscribe(m_bus.get(), m_sub_id);
-
-        if (m_watch_tag)
-            g_bus_unwatch_name(m_watch_tag);
+            g_dbus_connection_signal_unsubscribe(m_bus, m_sub_id);
     }
 
     void set_wakeup_time(const DateTime& d)
@@ -67,39 +73,27 @@ public:
 
     core::Signal<>& timeout() { return m_timeout; }
 
-private:
-
-    void emit_timeout() { return m_timeout(); }
-
-    static void on_bus_ready(GObject      * /*unused*/,
-                             GAsyncResult * res,
-                             gpointer       gself)
+    unsigned int hardware_wakeups_per_day() const
     {
-        GError * error;
-        GDBusConnection * bus;
+        const auto since = g_get_real_time() - DAY_USEC;
+        unsigned int n = 0;
+        for (const auto& t : m_hw_wakeups)
+            if (since < t)
+                ++n;
+        return n;
+    }
 
-        error = nullptr;
-        bus = g_bus_get_finish(res, &error);
-        if (bus == nullptr)
-        {
-            if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-                g_warning("%s Couldn't get system bus: %s", G_STRLOC, error->message);
-        }
-        else
-        {
-            static_cast<Impl*>(gself)->init_bus(bus);
-        }
+private:
 
-        g_clear_object(&bus);
-        g_clear_error(&error);
-    }
+    void emit_timeout() { return m_timeout(); }
 
-    void init_bus(GDBusConnection* connection)
+    void init_bus()
     {
-        m_bus.reset(G_DBUS_CONNECTION(g_object_ref(G_OBJECT(connection))),
-                    [](GDBusConnection *c){g_object_unref(G_OBJECT(c));});
+        m_bus = m_buses->system_bus();
+        if (m_bus == nullptr)
+            return;
 
-        m_sub_id = g_dbus_connection_signal_subscribe(m_bus.get(),
+        m_sub_id = g_dbus_connection_signal_subscribe(m_bus,
                                                       BUS_POWERD_NAME,
                                                       BUS_POWERD_INTERFACE,
                                                       "Wakeup",
@@ -110,13 +104,15 @@ private:
                                                       this, // userdata
                                                       nullptr); // userdata free
 
-        m_watch_tag = g_bus_watch_name_on_connection(m_bus.get(),
-                                                     BUS_POWERD_NAME,
-                                                     G_BUS_NAME_WATCHER_FLAGS_NONE,
-                                                     on_name_appeared_static,
-                                                     nullptr, // name-vanished,
-                                                     this, // userdata
-                                                     nullptr); // userdata free
+        m_connections.push_back(m_buses->watch_name(G_BUS_TYPE_SYSTEM, BUS_POWERD_NAME, [this](const std::string& owner){
+            if (!owner.empty()) {
+                g_debug("%s %s owns %s now; let's ask for a new cookie", G_STRLOC, owner.c_str(), BUS_POWERD_NAME);
+                // a new powerd doesn't know about our old cookie
+                m_cookie.clear();
+                m_hw_time = DateTime();
+                update_cookie();
+            }
+        }));
     }
 
     static void
@@ -129,17 +125,84 @@ private:
                      gpointer          gself)
     {
         g_debug("%s %s broadcast a hw wakeup signal", G_STRLOC, sender_name);
-        static_cast<Impl*>(gself)->emit_timeout();
+        static_cast<Impl*>(gself)->on_hw_wakeup();
     }
 
-    static void
-    on_name_appeared_static(GDBusConnection * /*connection*/,
-                            const gchar     * name,
-                            const gchar     * name_owner,
-                            gpointer          gself)
+    void on_hw_wakeup()
+    {
+        // powerd broadcasts every wakeup, so only count the ones that were ours
+        const auto now = m_clock->localtime();
+        if (m_hw_time.is_set() && (m_hw_time - now <= WAKEUP_TOLERANCE_USEC))
+        {
+            m_woken_at = now;
+            m_hw_time = DateTime();
+
+            const auto t = g_get_real_time();
+            while (!m_hw_wakeups.empty() && (m_hw_wakeups.front() <= t - DAY_USEC))
+                m_hw_wakeups.pop_front();
+            m_hw_wakeups.push_back(t);
+            g_debug("%s %u hardware wakeups in the last day", G_STRLOC, unsigned(m_hw_wakeups.size()));
+
+            // if this wakeup was coalesced with a later one, stay up for it
+            if (m_wakeup_time.is_set() && (now < m_wakeup_time))
+            {
+                arm_bridge(now, m_wakeup_time);
+                return;
+            }
+        }
+
+        emit_timeout();
+    }
+
+    /***
+    ****  Coalescing: rather than requesting a second hardware wakeup
+    ****  a few seconds after the one that just fired, stay awake.
+    ***/
+
+    bool within_slack(const DateTime& from, const DateTime& to) const
+    {
+        return (from <= to) && (to - from <= m_slack_usec);
+    }
+
+    bool just_woke(const DateTime& now) const
+    {
+        return m_woken_at.is_set() && (m_woken_at <= now)
+            && (now - m_woken_at <= WAKEUP_TOLERANCE_USEC);
+    }
+
+    void arm_bridge(const DateTime& now, const DateTime& until)
+    {
+        g_debug("%s staying awake until %s instead of requesting another hardware wakeup",
+                G_STRLOC, until.format("%F %T").c_str());
+
+        if (!m_bridge_awake)
+            m_bridge_awake.reset(new unity::indicator::notifications::Awake(m_bus, GETTEXT_PACKAGE));
+
+        if (m_bridge_tag != 0)
+            g_source_remove(m_bridge_tag);
+        const auto msec = std::max(int64_t(0), (until - now) / 1000);
+        m_bridge_tag = g_timeout_add_full(G_PRIORITY_HIGH, guint(msec), on_bridge_timeout, this, nullptr);
+    }
+
+    void cancel_bridge()
+    {
+        if (m_bridge_tag != 0)
+        {
+            g_source_remove(m_bridge_tag);
+            m_bridge_tag = 0;
+        }
+        m_bridge_awake.reset();
+    }
+
+    static gboolean on_bridge_timeout(gpointer gself)
     {
-        g_debug("%s %s owns %s now; let's ask for a new cookie", G_STRLOC, name, name_owner);
-        static_cast<Impl*>(gself)->update_cookie();
+        auto self = static_cast<Impl*>(gself);
+        self->m_bridge_tag = 0;
+
+        // keep the system up until listeners have had a chance to hold it up themselves
+        auto awake = std::move(self->m_bridge_awake);
+        self->emit_timeout();
+        return G_SOURCE_REMOVE;
     }
 
     /***
@@ -151,40 +214,72 @@ private:
         if (!m_bus)
             return;
 
-        // if we've already got a cookie, clear it
-        clear_current_cookie();
-        g_warn_if_fail(m_cookie.empty());
+        const auto now = m_clock->localtime();
 
-        // get a new cookie, if necessary
-        if (m_wakeup_time.is_set())
+        if (m_wakeup_time.is_set() && (now < m_wakeup_time) && (m_bridge_tag || just_woke(now))
+            && within_slack(now, m_wakeup_time))
         {
-            g_debug("%s calling %s::requestWakeup(%s)",
-                    G_STRLOC, BUS_POWERD_NAME,
-                    m_wakeup_time.format("%F %T").c_str());
+            arm_bridge(now, m_wakeup_time);
+            return;
+        }
+        cancel_bridge();
 
-            auto args = g_variant_new("(st)",
-                                      GETTEXT_PACKAGE,
-                                      uint64_t(m_wakeup_time.to_unix()));
+        if (!m_wakeup_time.is_set())
+        {
+            // forget any requests in flight and clear the current cookie
+            ++m_serial;
+            m_hw_time = DateTime();
+            clear_cookie(m_cookie);
+            m_cookie.clear();
+            return;
+        }
 
-            g_dbus_connection_call(m_bus.get(),
-                                   BUS_POWERD_NAME,
-                                   BUS_POWERD_PATH,
-                                   BUS_POWERD_INTERFACE,
-                                   "requestWakeup", // method_name
-                                   args,
-                                   G_VARIANT_TYPE("(s)"), // reply_type
-                                   G_DBUS_CALL_FLAGS_NONE,
-                                   -1, // use default timeout
-                                   m_cancellable,
-                                   on_request_wakeup_done,
-                                   this);
+        // a pending hardware wakeup at or a little before this time will do
+        if (m_hw_time.is_set() && (now < m_hw_time) && within_slack(m_hw_time, m_wakeup_time))
+        {
+            g_debug("%s wakeup at %s is already covered by the one at %s",
+                    G_STRLOC,
+                    m_wakeup_time.format("%F %T").c_str(),
+                    m_hw_time.format("%F %T").c_str());
+            return;
         }
+
+        g_debug("%s calling %s::requestWakeup(%s)",
+                G_STRLOC, BUS_POWERD_NAME,
+                m_wakeup_time.format("%F %T").c_str());
+
+        m_hw_time = m_wakeup_time;
+
+        auto args = g_variant_new("(st)",
+                                  GETTEXT_PACKAGE,
+                                  uint64_t(m_wakeup_time.to_unix()));
+
+        // keep the current cookie until the new one arrives
+        g_dbus_connection_call(m_bus,
+                               BUS_POWERD_NAME,
+                               BUS_POWERD_PATH,
+                               BUS_POWERD_INTERFACE,
+                               "requestWakeup", // method_name
+                               args,
+                               G_VARIANT_TYPE("(s)"), // reply_type
+                               G_DBUS_CALL_FLAGS_NONE,
+                               -1, // use default timeout
+                               m_cancellable,
+                               on_request_wakeup_done,
+                               new Request{this, ++m_serial});
     }
 
+    struct Request
+    {
+        Impl* self;
+        unsigned int serial;
+    };
+
     static void on_request_wakeup_done(GObject      * o,
                                        GAsyncResult * res,
-                                       gpointer       gself)
+                                       gpointer       grequest)
     {
+        auto request = static_cast<Request*>(grequest);
         GError * error;
         GVariant * ret;
 
@@ -192,12 +287,17 @@ private:
         ret = g_dbus_connection_call_finish(G_DBUS_CONNECTION(o), res, &error);
         if (ret == nullptr)
         {
-            /* powerd isn't on the desktop, but we don't need hardware wakeups there
-               anyway... so no need to warn on SERVICE_UNKNOWN */
-            if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED) &&
-                !g_error_matches(error, G_DBUS_ERROR, G_DBUS_ERROR_SERVICE_UNKNOWN))
+            if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
             {
-                g_warning("%s Could not set hardware wakeup: %s", G_STRLOC, error->message);
+                /* powerd isn't on the desktop, but we don't need hardware wakeups there
+                   anyway... so no need to warn on SERVICE_UNKNOWN */
+                if (!g_error_matches(error, G_DBUS_ERROR, G_DBUS_ERROR_SERVICE_UNKNOWN))
+                    g_warning("%s Could not set hardware wakeup: %s", G_STRLOC, error->message);
+
+                // let the next request try again
+                auto self = request->self;
+                if (request->serial == self->m_serial)
+                    self->m_hw_time = DateTime();
             }
         }
         else
@@ -207,42 +307,52 @@ private:
             g_debug("%s %s::requestWakeup() sent cookie %s",
                     G_STRLOC, BUS_POWERD_NAME, s);
 
-            auto& cookie = static_cast<Impl*>(gself)->m_cookie;
-            if (s != nullptr)
-                cookie = s;
-            else
-                cookie.clear();
+            auto self = request->self;
+            const std::string cookie = s != nullptr ? s : "";
+            if (request->serial == self->m_serial)
+            {
+                // swap in the new cookie, then retire the old one
+                const auto old = self->m_cookie;
+                self->m_cookie = cookie;
+                if (old != cookie)
+                    self->clear_cookie(old);
+            }
+            else if (cookie != self->m_cookie)
+            {
+                // superseded while it was in flight
+                self->clear_cookie(cookie);
+            }
         }
 
         // cleanup
         g_clear_pointer(&ret, g_variant_unref);
         g_clear_error(&error);
+        delete request;
     }
 
     /***
     ****  clearWakeup
     ***/
 
-    void clear_current_cookie()
+    void clear_cookie(const std::string& cookie)
     {
-        if (!m_cookie.empty())
+        if (!cookie.empty())
         {
             g_debug("%s calling %s::clearWakeup(%s)",
-                    G_STRLOC, BUS_POWERD_NAME, m_cookie.c_str());
+                    G_STRLOC, BUS_POWERD_NAME, cookie.c_str());
 
-            g_dbus_connection_call(m_bus.get(),
+            g_dbus_connection_call(m_bus,
                                    BUS_POWERD_NAME,
                                    BUS_POWERD_PATH,
                                    BUS_POWERD_INTERFACE,
                                    "clearWakeup", // method_name
-                                   g_variant_new("(s)", m_cookie.c_str()),
+                                   g_variant_new("(s)", cookie.c_str()),
                                    nullptr, // no response type
                                    G_DBUS_CALL_FLAGS_NONE,
                                    -1, // use default timeout
                                    nullptr, // cancellable
                                    on_clear_wakeup_done,
                                    nullptr);
-            m_cookie.clear();
         }
     }
 
@@ -268,23 +378,38 @@ private:
     ****
     ***/
 
+    static constexpr int64_t DAY_USEC {int64_t(24) * 60 * 60 * G_USEC_PER_SEC};
+
+    // how early a hardware wakeup can arrive and still be considered ours
+    static constexpr int64_t WAKEUP_TOLERANCE_USEC {5 * G_USEC_PER_SEC};
+
     core::Signal<> m_timeout;
-    const std::shared_ptr<Clock>& m_clock;
+    const std::shared_ptr<Clock> m_clock;
+    const int64_t m_slack_usec;
     DateTime m_wakeup_time;
 
-    std::shared_ptr<GDBusConnection> m_bus;
+    std::shared_ptr<unity::indicator::bus::BusRegistry> m_buses;
+    GDBusConnection* m_bus = nullptr; // owned by m_buses
     GCancellable * m_cancellable = nullptr;
     std::string m_cookie;
-    guint m_watch_tag = 0;
+    DateTime m_hw_time; // when the wakeup we've requested (or are requesting) fires
+    unsigned int m_serial = 0; // identifies the newest requestWakeup call
+    DateTime m_woken_at;
+    std::deque<int64_t> m_hw_wakeups; // g_get_real_time() of our recent hardware wakeups
+    std::unique_ptr<unity::indicator::notifications::Awake> m_bridge_awake;
+    guint m_bridge_tag = 0;
     guint m_sub_id = 0;
+    std::vector<core::ScopedConnection> m_connections;
 };
 
 /***
 ****
 ***/
 
-PowerdWakeupTimer::PowerdWakeupTimer(const std::shared_ptr<Clock>& clock):
-    p(new Impl(clock))
+PowerdWakeupTimer::PowerdWakeupTimer(const std::shared_ptr<Clock>& clock,
+                                     const std::shared_ptr<unity::indicator::bus::BusRegistry>& buses,
+                                     int slack_seconds):
+    p(new Impl(clock, buses, slack_seconds))
 {
 }
 
@@ -302,6 +427,11 @@ core::Signal<>& PowerdWakeupTimer::timeout()
     return p->timeout();
 }
 
+unsigned int PowerdWakeupTimer::hardware_wakeups_per_day() const
+{
+    return p->hardware_wakeups_per_day();
+}
+
 /***
 ****
 ***/
@@ -0,0 +1,190 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+
+#include <datetime/wakeup-timer-timerfd.h>
+
+#include <glib.h>
+#include <glib-unix.h> // g_unix_fd_add()
+
+#include <cerrno>
+#include <ctime>
+
+#include <sys/timerfd.h>
+#include <unistd.h> // read(), close()
+
+#ifndef CLOCK_REALTIME_ALARM
+#define CLOCK_REALTIME_ALARM 8
+#endif
+
+#ifndef TFD_TIMER_CANCEL_ON_SET
+#define TFD_TIMER_CANCEL_ON_SET (1 << 1)
+#endif
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/***
+****
+***/
+
+class TimerfdWakeupTimer::Impl
+{
+public:
+
+    Impl()
+    {
+        // CLOCK_REALTIME_ALARM needs CAP_WAKE_ALARM
+        m_fd = timerfd_create(CLOCK_REALTIME_ALARM, TFD_NONBLOCK|TFD_CLOEXEC);
+        if (m_fd != -1)
+        {
+            m_wakes_system = true;
+        }
+        else
+        {
+            g_debug("%s can't use CLOCK_REALTIME_ALARM (%s); falling back to CLOCK_REALTIME", G_STRLOC, g_strerror(errno));
+            m_fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK|TFD_CLOEXEC);
+        }
+
+        if (m_fd == -1)
+            g_warning("%s unable to create a timerfd: %s", G_STRLOC, g_strerror(errno));
+        else
+            m_fd_tag = g_unix_fd_add_full(G_PRIORITY_HIGH, m_fd, G_IO_IN, on_fd_ready, this, nullptr);
+    }
+
+    ~Impl()
+    {
+        if (m_fd_tag != 0)
+            g_source_remove(m_fd_tag);
+
+        if (m_fd != -1)
+            close(m_fd);
+    }
+
+    void set_wakeup_time(const DateTime& d)
+    {
+        m_wakeup_time = d;
+        arm();
+    }
+
+    core::Signal<>& timeout() { return m_timeout; }
+
+    bool wakes_system() const { return m_wakes_system; }
+
+private:
+
+    void arm()
+    {
+        if (m_fd == -1)
+            return;
+
+        // a zeroed it_value disarms the timer
+        struct itimerspec spec = {};
+        if (m_wakeup_time.is_set())
+        {
+            auto gdt = m_wakeup_time.get();
+            spec.it_value.tv_sec = g_date_time_to_unix(gdt);
+            spec.it_value.tv_nsec = g_date_time_get_microsecond(gdt) * 1000;
+            g_debug("%s setting timerfd to kick at %s",
+                    G_STRLOC, m_wakeup_time.format("%F %T").c_str());
+        }
+
+        // an absolute time that's already passed fires right away
+        if (timerfd_settime(m_fd, TFD_TIMER_ABSTIME|TFD_TIMER_CANCEL_ON_SET, &spec, nullptr) == -1)
+            g_warning("%s unable to set the timerfd: %s", G_STRLOC, g_strerror(errno));
+    }
+
+    static gboolean on_fd_ready(gint fd, GIOCondition, gpointer gself)
+    {
+        auto self = static_cast<Impl*>(gself);
+
+        uint64_t expirations = 0;
+        const auto n = read(fd, &expirations, sizeof(expirations));
+        if (n == sizeof(expirations))
+        {
+            g_debug("%s timerfd kicked", G_STRLOC);
+            self->m_timeout();
+        }
+        else if ((n == -1) && (errno == ECANCELED))
+        {
+            // the wall clock was set, so the timer was disarmed.
+            // re-arming it fires right away if the new time has passed.
+            g_debug("%s wall clock changed; re-arming the timerfd", G_STRLOC);
+            self->arm();
+        }
+        else if ((n == -1) && (errno != EAGAIN))
+        {
+            g_warning("%s unable to read the timerfd: %s", G_STRLOC, g_strerror(errno));
+        }
+
+        return G_SOURCE_CONTINUE;
+    }
+
+    core::Signal<> m_timeout;
+    DateTime m_wakeup_time;
+    int m_fd = -1;
+    guint m_fd_tag = 0;
+    bool m_wakes_system = false;
+};
+
+/***
+****
+***/
+
+TimerfdWakeupTimer::TimerfdWakeupTimer():
+    p(new Impl())
+{
+}
+
+TimerfdWakeupTimer::~TimerfdWakeupTimer()
+{
+}
+
+void TimerfdWakeupTimer::set_wakeup_time(const DateTime& d)
+{
+    p->set_wakeup_time(d);
+}
+
+core::Signal<>& TimerfdWakeupTimer::timeout()
+{
+    return p->timeout();
+}
+
+bool TimerfdWakeupTimer::wakes_system() const
+{
+    return p->wakes_system();
+}
+
+bool TimerfdWakeupTimer::is_supported()
+{
+    const auto fd = timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC);
+    if (fd == -1)
+        return false;
+    close(fd);
+    return true;
+}
+
+/***
+****
+***/
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
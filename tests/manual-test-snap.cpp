@@ -93,14 +93,17 @@ int main(int argc, const char* argv[])
     auto settings = std::make_shared<LiveSettings>();
     settings->alarm_volume.set(volume);
 
-    auto notification_engine = std::make_shared<uin::Engine>("indicator-datetime-service");
-    auto sound_builder = std::make_shared<uin::DefaultSoundBuilder>();
     auto system_bus = g_bus_get_sync(G_BUS_TYPE_SYSTEM, nullptr, nullptr);
-    Snap snap (notification_engine, sound_builder, settings, system_bus);
+    auto session_bus = g_bus_get_sync(G_BUS_TYPE_SESSION, nullptr, nullptr);
+    auto buses = std::make_shared<unity::indicator::bus::BusRegistry>(system_bus, session_bus);
+    auto notification_engine = std::make_shared<uin::Engine>("indicator-datetime-service", buses);
+    auto sound_builder = std::make_shared<uin::DefaultSoundBuilder>();
+    Snap snap (notification_engine, sound_builder, settings, buses);
     snap(a, a.alarms.front(), on_response);
     g_main_loop_run(loop);
 
     g_main_loop_unref(loop);
+    g_clear_object(&session_bus);
     g_clear_object(&system_bus);
     return 0;
 }
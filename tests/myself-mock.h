@@ -0,0 +1,48 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#ifndef INDICATOR_DATETIME_MYSELF_MOCK_H
+#define INDICATOR_DATETIME_MYSELF_MOCK_H
+
+#include <datetime/myself.h>
+
+namespace unity {
+namespace indicator {
+namespace datetime {
+
+/**
+ * A Myself whose emails are set by the test instead of by libaccounts
+ */
+class MockMyself: public Myself
+{
+public:
+    MockMyself() =default;
+    explicit MockMyself(const std::set<std::string>& emails) {my_emails.set(emails);}
+    ~MockMyself() =default;
+
+    const core::Property<std::set<std::string>>& emails() override {return my_emails;}
+
+    core::Property<std::set<std::string>> my_emails;
+};
+
+} // namespace datetime
+} // namespace indicator
+} // namespace unity
+
+#endif // INDICATOR_DATETIME_MYSELF_MOCK_H
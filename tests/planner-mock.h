@@ -36,15 +36,20 @@ public:
     MockRangePlanner():
         m_range(std::pair<DateTime,DateTime>(DateTime::NowLocal(), DateTime::NowLocal()))
     {
+        m_appointments.changed().connect([this](const std::vector<Appointment>& a){
+            m_index.reset(a);
+        });
     }
 
     ~MockRangePlanner() =default;
 
     core::Property<std::vector<Appointment>>& appointments() { return m_appointments; }
+    const AppointmentIndex& index() { return m_index; }
     core::Property<std::pair<DateTime,DateTime>>& range() { return m_range; }
 
 private:
     core::Property<std::vector<Appointment>> m_appointments;
+    AppointmentIndex m_index;
     core::Property<std::pair<DateTime,DateTime>> m_range;
 };
  
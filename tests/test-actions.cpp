@@ -329,3 +329,47 @@ TEST_F(ActionsFixture, ActivatingTheCalendarResetsItsDate)
     g_clear_pointer(&calendar_state, g_variant_unref);
 
 }
+
+TEST_F(ActionsFixture, CalendarStateMarksEveryDayOfMultiDayEvents)
+{
+    auto action_group = m_actions->action_group();
+
+    int changes = 0;
+    auto tag = g_signal_connect_swapped(action_group, "action-state-changed",
+                                        G_CALLBACK(+[](int* n){++*n;}), &changes);
+
+    // an event spanning the 2nd through the 4th of the calendar's month
+    const auto month = m_state->calendar_month->month().get().start_of_month();
+    Appointment a;
+    a.uid = "trip";
+    a.summary = "Trip";
+    a.type = Appointment::EVENT;
+    a.begin = month.add_full(0, 0, 1, 12, 0, 0);
+    a.end = month.add_full(0, 0, 3, 12, 0, 0);
+    m_mock_state->mock_range_planner->appointments().set(std::vector<Appointment>({a}));
+    EXPECT_EQ(1, changes);
+
+    auto calendar_state = g_action_group_get_action_state(action_group, "calendar");
+    auto v = g_variant_lookup_value(calendar_state, "appointment-days", G_VARIANT_TYPE("ai"));
+    ASSERT_TRUE(v != nullptr);
+    gsize n_days = 0;
+    auto days = static_cast<const gint32*>(g_variant_get_fixed_array(v, &n_days, sizeof(gint32)));
+    EXPECT_EQ(std::vector<gint32>({2, 3, 4}), std::vector<gint32>(days, days+n_days));
+    g_clear_pointer(&v, g_variant_unref);
+    g_clear_pointer(&calendar_state, g_variant_unref);
+
+    // adding an event on an already-busy day shouldn't touch the state
+    Appointment b;
+    b.uid = "lunch";
+    b.summary = "Lunch";
+    b.type = Appointment::EVENT;
+    b.begin = b.end = month.add_full(0, 0, 2, 13, 0, 0);
+    m_mock_state->mock_range_planner->appointments().set(std::vector<Appointment>({a, b}));
+    EXPECT_EQ(1, changes);
+
+    // ...but removing the trip should
+    m_mock_state->mock_range_planner->appointments().set(std::vector<Appointment>({b}));
+    EXPECT_EQ(2, changes);
+
+    g_signal_handler_disconnect(action_group, tag);
+}
@@ -0,0 +1,216 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+
+#include <datetime/alarm-latency.h>
+
+#include "glib-fixture.h"
+
+#include <glib/gstdio.h> // g_remove()
+
+#include <cstring> // strstr()
+#include <string>
+
+using namespace unity::indicator::datetime;
+
+/***
+****
+***/
+
+typedef GlibFixture AlarmLatencyFixture;
+
+namespace
+{
+    Appointment make_alarm(const std::string& uid, const DateTime& time)
+    {
+        Appointment appointment;
+        appointment.uid = uid;
+        appointment.begin = time;
+        appointment.end = time;
+        Alarm alarm;
+        alarm.time = time;
+        appointment.alarms.push_back(alarm);
+        return appointment;
+    }
+}
+
+TEST_F(AlarmLatencyFixture, RecordsEachStage)
+{
+    auto filename = g_build_filename(SANDBOX, "alarm-latency.txt", nullptr);
+    g_remove(filename);
+
+    AlarmLatency latency(filename);
+    const auto appointment = make_alarm("a", DateTime::NowLocal().add_full(0,0,0,0,0,-3));
+
+    // stages marked while nothing is being traced are ignored
+    latency.mark(AlarmLatency::SHOWN);
+    latency.finish();
+    EXPECT_TRUE(latency.records().empty());
+
+    latency.mark_pending(AlarmLatency::WAKEUP);
+    latency.mark_pending(AlarmLatency::REQUEUE);
+    latency.begin(appointment, appointment.alarms.front());
+    latency.mark(AlarmLatency::NOTIFYING);
+    latency.mark(AlarmLatency::SOUND);
+    latency.mark(AlarmLatency::SHOWN);
+    latency.finish();
+
+    const auto records = latency.records();
+    ASSERT_EQ(1u, records.size());
+    const auto& record = records.front();
+    EXPECT_EQ("a", record.uid);
+    EXPECT_LE(3 * G_USEC_PER_SEC, record.lateness_usec);
+    EXPECT_NE(0, record.stamps[AlarmLatency::WAKEUP]);
+    EXPECT_NE(0, record.stamps[AlarmLatency::REQUEUE]);
+    EXPECT_LE(record.stamps[AlarmLatency::WAKEUP], record.stamps[AlarmLatency::REACHED]);
+    EXPECT_LE(record.stamps[AlarmLatency::REACHED], record.stamps[AlarmLatency::SHOWN]);
+    EXPECT_EQ(0, record.stamps[AlarmLatency::AWAKE]);
+    EXPECT_EQ(0, record.stamps[AlarmLatency::HAPTIC]);
+
+    // every stage that ran lands in the histograms; skipped ones don't
+    auto total = [](const AlarmLatency::Histogram& h){
+        unsigned int n = 0;
+        for (const auto& count : h)
+            n += count;
+        return n;
+    };
+    EXPECT_EQ(1u, total(latency.histogram(AlarmLatency::SHOWN)));
+    EXPECT_EQ(0u, total(latency.histogram(AlarmLatency::HAPTIC)));
+    EXPECT_EQ(1u, latency.lateness_histogram()[AlarmLatency::NUM_BUCKETS-3]); // [2500..5000) msec
+
+    // the report is written after a moment
+    EXPECT_FALSE(g_file_test(filename, G_FILE_TEST_EXISTS));
+    EXPECT_TRUE(wait_for([filename](){return g_file_test(filename, G_FILE_TEST_EXISTS);}, 5000));
+    gchar* contents = nullptr;
+    EXPECT_TRUE(g_file_get_contents(filename, &contents, nullptr, nullptr));
+    EXPECT_TRUE(contents && strstr(contents, "shown"));
+    g_free(contents);
+
+    // each alarm only uses the pending stamps once
+    latency.begin(appointment, appointment.alarms.front());
+    latency.finish();
+    EXPECT_EQ(0, latency.records().back().stamps[AlarmLatency::WAKEUP]);
+
+    g_remove(filename);
+    g_free(filename);
+}
+
+TEST_F(AlarmLatencyFixture, KeepsOnlyRecentRecords)
+{
+    AlarmLatency latency("");
+    const auto now = DateTime::NowLocal();
+
+    for (int i=0; i<100; ++i)
+    {
+        const auto appointment = make_alarm(std::to_string(i), now);
+        latency.begin(appointment, appointment.alarms.front());
+        latency.finish();
+    }
+
+    const auto records = latency.records();
+    ASSERT_FALSE(records.empty());
+    EXPECT_GT(100u, records.size());
+    EXPECT_EQ("99", records.back().uid);
+    for (size_t i=1; i<records.size(); ++i)
+        EXPECT_EQ(std::stoi(records[i-1].uid)+1, std::stoi(records[i].uid));
+}
+
+TEST_F(AlarmLatencyFixture, SimultaneousAlarmsSharePendingStamps)
+{
+    AlarmLatency latency("");
+    const auto now = DateTime::NowLocal();
+    const auto a = make_alarm("a", now);
+    const auto b = make_alarm("b", now);
+
+    // two alarms reached in the same wakeup both get its stamps
+    latency.mark_pending(AlarmLatency::WAKEUP);
+    latency.mark_pending(AlarmLatency::REQUEUE);
+    latency.begin(a, a.alarms.front());
+    latency.finish();
+    latency.begin(b, b.alarms.front());
+    latency.finish();
+    auto records = latency.records();
+    ASSERT_EQ(2u, records.size());
+    EXPECT_NE(0, records[0].stamps[AlarmLatency::WAKEUP]);
+    EXPECT_EQ(records[0].stamps[AlarmLatency::WAKEUP], records[1].stamps[AlarmLatency::WAKEUP]);
+    EXPECT_EQ(records[0].stamps[AlarmLatency::REQUEUE], records[1].stamps[AlarmLatency::REQUEUE]);
+
+    // the next requeue starts a new batch without the old wakeup
+    latency.mark_pending(AlarmLatency::REQUEUE);
+    const auto c = make_alarm("c", now);
+    latency.begin(c, c.alarms.front());
+    latency.finish();
+    records = latency.records();
+    ASSERT_EQ(3u, records.size());
+    EXPECT_EQ(0, records[2].stamps[AlarmLatency::WAKEUP]);
+    EXPECT_NE(0, records[2].stamps[AlarmLatency::REQUEUE]);
+}
+
+TEST_F(AlarmLatencyFixture, StagesCanBeStampedAfterFinish)
+{
+    AlarmLatency latency("");
+    const auto now = DateTime::NowLocal();
+    const auto a = make_alarm("a", now);
+    const auto b = make_alarm("b", now);
+
+    latency.begin(a, a.alarms.front());
+    latency.finish();
+    latency.begin(b, b.alarms.front());
+    latency.finish();
+
+    // the server's reply for 'a' arrives after 'b' has been reached
+    latency.mark(a, a.alarms.front(), AlarmLatency::SHOWN);
+    auto records = latency.records();
+    ASSERT_EQ(2u, records.size());
+    EXPECT_NE(0, records[0].stamps[AlarmLatency::SHOWN]);
+    EXPECT_EQ(0, records[1].stamps[AlarmLatency::SHOWN]);
+    EXPECT_EQ(1u, latency.histogram(AlarmLatency::SHOWN)[0]);
+
+    // a stage is only stamped once
+    const auto shown = records[0].stamps[AlarmLatency::SHOWN];
+    latency.mark(a, a.alarms.front(), AlarmLatency::SHOWN);
+    EXPECT_EQ(shown, latency.records()[0].stamps[AlarmLatency::SHOWN]);
+    EXPECT_EQ(1u, latency.histogram(AlarmLatency::SHOWN)[0]);
+
+    // alarms that were never traced are ignored
+    const auto c = make_alarm("c", now);
+    latency.mark(c, c.alarms.front(), AlarmLatency::SHOWN);
+    EXPECT_EQ(2u, latency.records().size());
+}
+
+TEST_F(AlarmLatencyFixture, ReportsHardwareWakeups)
+{
+    auto filename = g_build_filename(SANDBOX, "alarm-latency-wakeups.txt", nullptr);
+    g_remove(filename);
+
+    AlarmLatency latency(filename);
+    latency.set_hardware_wakeups_func([](){return 3u;});
+    const auto appointment = make_alarm("a", DateTime::NowLocal());
+    latency.begin(appointment, appointment.alarms.front());
+    latency.finish();
+
+    EXPECT_TRUE(wait_for([filename](){return g_file_test(filename, G_FILE_TEST_EXISTS);}, 5000));
+    gchar* contents = nullptr;
+    EXPECT_TRUE(g_file_get_contents(filename, &contents, nullptr, nullptr));
+    EXPECT_TRUE(contents && strstr(contents, "# hardware wakeups in the last 24 hours\n3\n"));
+    g_free(contents);
+
+    g_remove(filename);
+    g_free(filename);
+}
@@ -36,6 +36,7 @@ protected:
 
     std::vector<std::string> m_triggered;
     std::shared_ptr<WakeupTimer> m_wakeup_timer;
+    std::shared_ptr<AlarmLatency> m_latency;
     std::unique_ptr<AlarmQueue> m_watcher;
     std::shared_ptr<RangePlanner> m_range_planner;
     std::shared_ptr<UpcomingPlanner> m_upcoming;
@@ -45,9 +46,10 @@ protected:
         super::SetUp();
 
         m_wakeup_timer.reset(new MainloopWakeupTimer(m_state->clock));
+        m_latency.reset(new AlarmLatency("")); // keep the trace in memory
         m_range_planner.reset(new MockRangePlanner);
         m_upcoming.reset(new UpcomingPlanner(m_range_planner, m_state->clock->localtime()));
-        m_watcher.reset(new SimpleAlarmQueue(m_state->clock, m_upcoming, m_wakeup_timer));
+        m_watcher.reset(new SimpleAlarmQueue(m_state->clock, m_upcoming, m_wakeup_timer, m_latency));
         m_watcher->alarm_reached().connect([this](const Appointment& appt, const Alarm& /*alarm*/){
             m_triggered.push_back(appt.uid);
         });
@@ -61,6 +63,7 @@ protected:
         m_watcher.reset();
         m_upcoming.reset();
         m_range_planner.reset();
+        m_latency.reset();
 
         super::TearDown();
     }
@@ -116,6 +119,21 @@ TEST_F(AlarmQueueFixture, AppointmentsChanged)
 }
 
 
+TEST_F(AlarmQueueFixture, ReachedAlarmsAreTraced)
+{
+    std::vector<Appointment> a = build_some_appointments();
+    a[0].begin = a[0].alarms.front().time = m_state->clock->localtime();
+    m_range_planner->appointments().set(a);
+    ASSERT_EQ(1, m_triggered.size());
+
+    // the injected tracer, not some process-wide one, recorded it
+    const auto records = m_latency->records();
+    ASSERT_EQ(1, records.size());
+    EXPECT_EQ(a[0].uid, records[0].uid);
+    EXPECT_NE(0, records[0].stamps[AlarmLatency::REQUEUE]);
+    EXPECT_NE(0, records[0].stamps[AlarmLatency::REACHED]);
+}
+
 TEST_F(AlarmQueueFixture, TimeChanged)
 {
     // Add some appointments to the planner.
@@ -166,3 +184,108 @@ TEST_F(AlarmQueueFixture, NoDuplicates)
     ASSERT_EQ(1, m_triggered.size());
     EXPECT_EQ(a[0].uid, m_triggered[0]);
 }
+
+
+TEST_F(AlarmQueueFixture, UpcomingIsEmittedShortlyBefore)
+{
+    std::vector<std::string> upcoming;
+    m_watcher->alarm_upcoming().connect([&upcoming](const Appointment& appt, const Alarm& /*alarm*/){
+        upcoming.push_back(appt.uid);
+    });
+
+    // an alarm that's a day away isn't upcoming yet
+    std::vector<Appointment> a = build_some_appointments();
+    m_range_planner->appointments().set(a);
+    EXPECT_TRUE(upcoming.empty());
+
+    // but an alarm that's a few seconds away is, even if it's not in this minute
+    const auto now = m_state->clock->localtime().start_of_minute().add_full(0,0,0,0,0,45);
+    m_mock_state->mock_clock->set_localtime(now);
+    a[0].alarms.front().time = now.add_full(0,0,0,0,0,20);
+    m_range_planner->appointments().set(a);
+    ASSERT_EQ(1, upcoming.size());
+    EXPECT_EQ(a[0].uid, upcoming[0]);
+    EXPECT_TRUE(m_triggered.empty());
+
+    // it's only emitted once
+    m_range_planner->appointments().set(std::vector<Appointment>({a[0]}));
+    EXPECT_EQ(1, upcoming.size());
+}
+
+TEST_F(AlarmQueueFixture, UpcomingIsCheckedOnMinuteTicks)
+{
+    std::vector<std::string> upcoming;
+    m_watcher->alarm_upcoming().connect([&upcoming](const Appointment& appt, const Alarm& /*alarm*/){
+        upcoming.push_back(appt.uid);
+    });
+
+    // an alarm that's a couple of minutes away isn't upcoming yet...
+    const auto now = m_state->clock->localtime().start_of_minute();
+    m_mock_state->mock_clock->set_localtime(now);
+    std::vector<Appointment> a = build_some_appointments();
+    a[0].alarms.front().time = now.add_full(0,0,0,0,0,100);
+    m_range_planner->appointments().set(a);
+    EXPECT_TRUE(upcoming.empty());
+
+    // ...but it is after the next minute tick, with no wakeup of its own
+    m_mock_state->mock_clock->set_localtime(now.add_full(0,0,0,0,1,0));
+    ASSERT_EQ(1, upcoming.size());
+    EXPECT_EQ(a[0].uid, upcoming[0]);
+    EXPECT_TRUE(m_triggered.empty());
+}
+
+TEST_F(AlarmQueueFixture, UpcomingIsPreparedWithTheDisplayOff)
+{
+    std::vector<std::string> upcoming;
+    m_watcher->alarm_upcoming().connect([&upcoming](const Appointment& appt, const Alarm& /*alarm*/){
+        upcoming.push_back(appt.uid);
+    });
+
+    // with the display off, there are no minute ticks to check on it
+    m_mock_state->mock_clock->display_on.set(false);
+
+    // an alarm that'll be close in a couple of seconds isn't upcoming yet...
+    const auto now = m_state->clock->localtime();
+    m_mock_state->mock_clock->set_localtime(now);
+    std::vector<Appointment> a = build_some_appointments();
+    a[0].alarms.front().time = now.add_full(0,0,0,0,0,62);
+    m_range_planner->appointments().set(a);
+    EXPECT_TRUE(upcoming.empty());
+
+    // ...but it gets prepared anyway once it is
+    EXPECT_TRUE(wait_for([&upcoming](){return !upcoming.empty();}, 5000));
+    ASSERT_EQ(1, upcoming.size());
+    EXPECT_EQ(a[0].uid, upcoming[0]);
+    EXPECT_TRUE(m_triggered.empty());
+}
+
+TEST_F(AlarmQueueFixture, UpcomingIsWithdrawnWhenRemoved)
+{
+    std::vector<std::string> upcoming;
+    m_watcher->alarm_upcoming().connect([&upcoming](const Appointment& appt, const Alarm& /*alarm*/){
+        upcoming.push_back(appt.uid);
+    });
+    std::vector<std::string> withdrawn;
+    m_watcher->alarm_withdrawn().connect([&withdrawn](const Appointment& appt, const Alarm& /*alarm*/){
+        withdrawn.push_back(appt.uid);
+    });
+
+    // make an alarm upcoming
+    const auto now = m_state->clock->localtime().start_of_minute().add_full(0,0,0,0,0,45);
+    m_mock_state->mock_clock->set_localtime(now);
+    std::vector<Appointment> a = build_some_appointments();
+    a[0].alarms.front().time = now.add_full(0,0,0,0,0,20);
+    m_range_planner->appointments().set(a);
+    ASSERT_EQ(1, upcoming.size());
+    EXPECT_TRUE(withdrawn.empty());
+
+    // remove it from the planner, eg because it was disabled
+    m_range_planner->appointments().set(std::vector<Appointment>({a[1]}));
+    ASSERT_EQ(1, withdrawn.size());
+    EXPECT_EQ(a[0].uid, withdrawn[0]);
+    EXPECT_TRUE(m_triggered.empty());
+
+    // it's only withdrawn once
+    m_range_planner->appointments().set(std::vector<Appointment>({a[1]}));
+    EXPECT_EQ(1, withdrawn.size());
+}
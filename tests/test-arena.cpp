@@ -0,0 +1,90 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include <datetime/arena.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdint> // uintptr_t
+#include <string>
+
+using namespace unity::indicator::datetime;
+
+/***
+****
+***/
+
+TEST(ArenaTest, AllocationsAreAligned)
+{
+    Arena arena(64);
+
+    for (int i=0; i<100; ++i)
+    {
+        arena.allocate(1, 1);
+        auto p = arena.allocate(sizeof(double), alignof(double));
+        EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(p) % alignof(double));
+    }
+
+    EXPECT_EQ(100*(1+sizeof(double)), arena.bytes_used());
+    EXPECT_LE(arena.bytes_used(), arena.bytes_reserved());
+}
+
+TEST(ArenaTest, BigAllocationsGetTheirOwnBlock)
+{
+    Arena arena(64);
+
+    auto a = static_cast<char*>(arena.allocate(8, 1));
+    auto big = arena.allocate(1000, 1);
+    auto b = static_cast<char*>(arena.allocate(8, 1));
+    EXPECT_NE(nullptr, big);
+
+    // the small allocations still share a block
+    EXPECT_EQ(a+8, b);
+}
+
+TEST(ArenaTest, Containers)
+{
+    Arena arena;
+
+    ArenaVector<int> v{ArenaAllocator<int>(arena)};
+    for (int i=0; i<1000; ++i)
+        v.push_back(i);
+    EXPECT_EQ(1000u, v.size());
+    EXPECT_EQ(999, v.back());
+
+    typedef ArenaMap<int,std::string> Inner;
+    ArenaMap<std::string,Inner> m{std::less<std::string>(), ArenaAllocator<char>(arena)};
+    for (int i=0; i<100; ++i)
+    {
+        auto it = m.find(std::to_string(i%10));
+        if (it == m.end())
+            it = m.insert(std::make_pair(std::to_string(i%10), Inner{std::less<int>(), ArenaAllocator<char>(arena)})).first;
+        it->second[i] = std::to_string(i);
+    }
+    EXPECT_EQ(10u, m.size());
+    EXPECT_EQ(10u, m.at("3").size());
+    EXPECT_EQ("93", m.at("3").at(93));
+
+    ArenaSet<int> s{std::less<int>(), ArenaAllocator<char>(arena)};
+    s.insert(3);
+    s.insert(3);
+    EXPECT_EQ(1u, s.size());
+
+    EXPECT_GT(arena.bytes_used(), 1000*sizeof(int));
+}
@@ -21,6 +21,7 @@
 #include <datetime/clock-mock.h>
 #include <datetime/timezone.h>
 
+#include <bus/bus-registry.h>
 #include <notifications/dbus-shared.h>
 
 #include "test-dbus-fixture.h"
@@ -157,6 +158,39 @@ TEST_F(ClockFixture, SleepTriggersSkew)
     g_bus_unown_name(name_tag);
 }
 
+/**
+ * Confirm that a Clock sharing a BusRegistry's name watches
+ * still sees "PrepareForSleep"
+ */
+TEST_F(ClockFixture, SleepTriggersSkewWithSharedBuses)
+{
+    auto buses = std::make_shared<unity::indicator::bus::BusRegistry>(system_bus, nullptr);
+    auto timezone_ = std::make_shared<MockTimezone>();
+    timezone_->timezone.set("America/New_York");
+    LiveClock clock(timezone_, buses);
+
+    bool skewed = false;
+    clock.minute_changed.connect([&skewed, this](){
+                    skewed = true;
+                    g_main_loop_quit(loop);
+                    return G_SOURCE_REMOVE;
+                });
+
+    auto name_tag = g_bus_own_name(G_BUS_TYPE_SYSTEM,
+                                   "org.freedesktop.login1",
+                                   G_BUS_NAME_OWNER_FLAGS_NONE,
+                                   nullptr /* bus acquired */,
+                                   on_login1_name_acquired,
+                                   nullptr /* name lost */,
+                                   nullptr /* user_data */,
+                                   nullptr /* user_data closure */);
+    g_main_loop_run(loop);
+    EXPECT_TRUE(skewed);
+    EXPECT_FALSE(buses->name_owner(G_BUS_TYPE_SYSTEM, "org.freedesktop.login1").empty());
+
+    g_bus_unown_name(name_tag);
+}
+
 namespace
 {
   void on_powerd_name_acquired(GDBusConnection * /*connection*/,
@@ -214,3 +248,47 @@ TEST_F(ClockFixture, SysPowerStateChange)
   // cleanup
   g_bus_unown_name(tag);
 }
+
+/**
+ * Confirm that Unity.Screen's DisplayPowerStateChange
+ * is tracked by the clock's display_on property
+ */
+TEST_F(ClockFixture, DisplayPowerStateChange)
+{
+  auto clock = std::make_shared<MockClock>(DateTime::NowLocal());
+  EXPECT_TRUE(clock->display_on.get());
+
+  gboolean is_owned = false;
+  auto tag = g_bus_own_name_on_connection(system_bus,
+                                          BUS_SCREEN_NAME,
+                                          G_BUS_NAME_OWNER_FLAGS_NONE,
+                                          on_powerd_name_acquired,
+                                          nullptr,
+                                          &is_owned /* user_data */,
+                                          nullptr /* user_data closure */);
+  wait_msec();
+  ASSERT_TRUE(is_owned);
+
+  auto emit_state = [this](int state) {
+    g_dbus_connection_emit_signal(system_bus,
+                                  nullptr,
+                                  BUS_SCREEN_PATH,
+                                  BUS_SCREEN_INTERFACE,
+                                  "DisplayPowerStateChange",
+                                  g_variant_new("(ii)", state, 0),
+                                  nullptr);
+    wait_msec();
+  };
+
+  emit_state(0);
+  EXPECT_FALSE(clock->display_on.get());
+  emit_state(1);
+  EXPECT_TRUE(clock->display_on.get());
+  emit_state(0);
+  EXPECT_FALSE(clock->display_on.get());
+
+  // if the screen service goes away, assume the display is on
+  g_bus_unown_name(tag);
+  wait_msec();
+  EXPECT_TRUE(clock->display_on.get());
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include <datetime/engine-eds.h>
+#include <datetime/myself.h>
+#include <datetime/planner-range.h>
+
+#include <gtest/gtest.h>
+
+#include "glib-fixture.h"
+#include "print-to.h"
+#include "timezone-mock.h"
+
+using namespace unity::indicator::datetime;
+using VAlarmFixture = GlibFixture;
+
+/***
+****
+***/
+
+TEST_F(VAlarmFixture, AlarmsAheadOfTheWindow)
+{
+    // start the EDS engine
+    auto engine = std::make_shared<EdsEngine>(std::make_shared<Myself>());
+
+    // we need a consistent timezone for the planner and our local DateTimes
+    constexpr char const * zone_str {"America/Chicago"};
+    auto tz = std::make_shared<MockTimezone>(zone_str);
+    auto gtz = g_time_zone_new(zone_str);
+
+    // give EDS a moment to load
+    auto planner = std::make_shared<SimpleRangePlanner>(engine, tz);
+    planner->range().set(std::make_pair(DateTime{gtz, 2015,6,1, 0,0,0.0}, DateTime{gtz, 2015,7,1, 0,0,0.0}));
+    EXPECT_TRUE(wait_for([planner](){return !planner->appointments().get().empty();}, 10000));
+
+    // ask for a single day's alarms, as the alarm planner does when it's busy.
+    // the meeting on the 11th is outside of it, but its alarm isn't.
+    std::vector<Appointment> alarms;
+    bool fetched = false;
+    engine->get_alarms(DateTime{gtz, 2015,6,9, 0,0,0.0},
+                       DateTime{gtz, 2015,6,10, 0,0,0.0},
+                       *tz,
+                       [&alarms, &fetched](const std::vector<Appointment>& a){
+                           alarms = a;
+                           fetched = true;
+                       });
+    EXPECT_TRUE(wait_for([&fetched](){return fetched;}, 5000));
+
+    ASSERT_EQ(1u, alarms.size());
+    EXPECT_EQ("20150601T120000Z-1234-32011-2036-1@ubuntu-phablet", alarms[0].uid);
+    EXPECT_EQ(DateTime(gtz, 2015, 6, 11, 9, 0, 0), alarms[0].begin);
+    ASSERT_EQ(1u, alarms[0].alarms.size());
+    EXPECT_EQ(DateTime(gtz, 2015, 6, 9, 9, 0, 0), alarms[0].alarms[0].time);
+
+    // cleanup
+    g_time_zone_unref(gtz);
+}
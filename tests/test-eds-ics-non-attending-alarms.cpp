@@ -28,6 +28,7 @@
 #include <gtest/gtest.h>
 
 #include "glib-fixture.h"
+#include "myself-mock.h"
 #include "print-to.h"
 #include "timezone-mock.h"
 #include "wakeup-timer-mock.h"
@@ -77,3 +78,37 @@ TEST_F(VAlarmFixture, NonAttendingEvent)
     // cleanup
     g_time_zone_unref(gtz);
 }
+
+TEST_F(VAlarmFixture, UnrelatedEmailChangeDoesNotRebuild)
+{
+    // start the EDS engine
+    // the account that declined the detached instance
+    auto myself = std::make_shared<MockMyself>(std::set<std::string>{"uphablet@ubuntu.com"});
+    auto engine = std::make_shared<EdsEngine>(myself);
+
+    constexpr char const * zone_str {"America/Recife"};
+    auto tz = std::make_shared<MockTimezone>(zone_str);
+    auto gtz = g_time_zone_new(zone_str);
+
+    auto planner = std::make_shared<SimpleRangePlanner>(engine, tz);
+    const DateTime range_begin {gtz, 2016,1, 1, 0, 0, 0.0};
+    const DateTime range_end   {gtz, 2016,6,30,23,59,59.5};
+    planner->range().set(std::make_pair(range_begin, range_end));
+    EXPECT_TRUE(wait_for([planner](){return planner->appointments().get().size() == 2;}, 10000));
+
+    int rebuilds = 0;
+    core::ScopedConnection conn(engine->changed().connect([&rebuilds](){++rebuilds;}));
+
+    // a new account that isn't attending anything doesn't change anyone's status
+    myself->my_emails.set({"uphablet@ubuntu.com", "someone-else@example.com"});
+    wait_msec(2000);
+    EXPECT_EQ(0, rebuilds);
+
+    // but losing the account that declined the detached instance does,
+    // even though the series it belongs to has the same uid
+    myself->my_emails.set({"someone-else@example.com"});
+    EXPECT_TRUE(wait_for([&rebuilds](){return rebuilds > 0;}, 3000));
+
+    // cleanup
+    g_time_zone_unref(gtz);
+}
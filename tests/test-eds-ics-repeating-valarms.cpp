@@ -33,70 +33,90 @@
 #include "wakeup-timer-mock.h"
 
 using namespace unity::indicator::datetime;
-using VAlarmFixture = GlibFixture;
 
 /***
 ****
 ***/
 
-TEST_F(VAlarmFixture, MultipleAppointments)
+class VAlarmFixture: public GlibFixture
 {
-    // start the EDS engine
-    auto engine = std::make_shared<EdsEngine>(std::make_shared<Myself>());
-
-    // we need a consistent timezone for the planner and our local DateTimes
-    constexpr char const * zone_str {"America/Chicago"};
-    auto tz = std::make_shared<MockTimezone>(zone_str);
-    auto gtz = g_time_zone_new(zone_str);
-
-    // make a planner that looks at the first half of 2015 in EDS
-    auto planner = std::make_shared<SimpleRangePlanner>(engine, tz);
-    const DateTime range_begin {gtz, 2015,1, 1, 0, 0, 0.0};
-    const DateTime range_end   {gtz, 2015,6,30,23,59,59.5};
-    planner->range().set(std::make_pair(range_begin, range_end));
-
-    // give EDS a moment to load
-    if (planner->appointments().get().empty()) {
-        g_message("waiting a moment for EDS to load...");
-        auto on_appointments_changed = [this](const std::vector<Appointment>& appointments){
-            g_message("ah, they loaded");
-            if (!appointments.empty())
-                g_main_loop_quit(loop);
-        };
-        core::ScopedConnection conn(planner->appointments().changed().connect(on_appointments_changed));
-        constexpr int max_wait_sec = 10;
-        wait_msec(max_wait_sec * G_TIME_SPAN_MILLISECOND);
+private:
+
+    typedef GlibFixture super;
+
+protected:
+
+    void check_multiple_appointments(const std::shared_ptr<Engine>& engine)
+    {
+        // we need a consistent timezone for the planner and our local DateTimes
+        constexpr char const * zone_str {"America/Chicago"};
+        auto tz = std::make_shared<MockTimezone>(zone_str);
+        auto gtz = g_time_zone_new(zone_str);
+
+        // make a planner that looks at the first half of 2015 in EDS
+        auto planner = std::make_shared<SimpleRangePlanner>(engine, tz);
+        const DateTime range_begin {gtz, 2015,1, 1, 0, 0, 0.0};
+        const DateTime range_end   {gtz, 2015,6,30,23,59,59.5};
+        planner->range().set(std::make_pair(range_begin, range_end));
+
+        // give EDS a moment to load
+        if (planner->appointments().get().empty()) {
+            g_message("waiting a moment for EDS to load...");
+            auto on_appointments_changed = [this](const std::vector<Appointment>& appointments){
+                g_message("ah, they loaded");
+                if (!appointments.empty())
+                    g_main_loop_quit(loop);
+            };
+            core::ScopedConnection conn(planner->appointments().changed().connect(on_appointments_changed));
+            constexpr int max_wait_sec = 10;
+            wait_msec(max_wait_sec * G_TIME_SPAN_MILLISECOND);
+        }
+
+        // the planner should match what we've got in the calendar.ics file
+        const auto appts = planner->appointments().get();
+        ASSERT_EQ(1, appts.size());
+        const auto& appt = appts.front();
+        ASSERT_EQ(8, appt.alarms.size());
+        EXPECT_EQ(Alarm({"Time to pack!",      "file://" CALENDAR_DEFAULT_SOUND, DateTime(gtz,2015,4,23,13,35,0)}), appt.alarms[0]);
+        EXPECT_EQ(Alarm({"Time to pack!",      "file://" CALENDAR_DEFAULT_SOUND, DateTime(gtz,2015,4,23,13,37,0)}), appt.alarms[1]);
+        EXPECT_EQ(Alarm({"Time to pack!",      "file://" CALENDAR_DEFAULT_SOUND, DateTime(gtz,2015,4,23,13,39,0)}), appt.alarms[2]);
+        EXPECT_EQ(Alarm({"Time to pack!",      "file://" CALENDAR_DEFAULT_SOUND, DateTime(gtz,2015,4,23,13,41,0)}), appt.alarms[3]);
+        EXPECT_EQ(Alarm({"Go to the airport!", "file://" CALENDAR_DEFAULT_SOUND, DateTime(gtz,2015,4,24,10,35,0)}), appt.alarms[4]);
+        EXPECT_EQ(Alarm({"Go to the airport!", "file://" CALENDAR_DEFAULT_SOUND, DateTime(gtz,2015,4,24,10,37,0)}), appt.alarms[5]);
+        EXPECT_EQ(Alarm({"Go to the airport!", "file://" CALENDAR_DEFAULT_SOUND, DateTime(gtz,2015,4,24,10,39,0)}), appt.alarms[6]);
+        EXPECT_EQ(Alarm({"Go to the airport!", "file://" CALENDAR_DEFAULT_SOUND, DateTime(gtz,2015,4,24,10,41,0)}), appt.alarms[7]);
+
+        // now let's try this out with AlarmQueue...
+        // hook the planner up to a SimpleAlarmQueue and confirm that it triggers for each of the reminders
+        auto mock_clock = std::make_shared<MockClock>(range_begin);
+        std::shared_ptr<Clock> clock = mock_clock;
+        std::shared_ptr<WakeupTimer> wakeup_timer = std::make_shared<MockWakeupTimer>(clock);
+        auto alarm_queue = std::make_shared<SimpleAlarmQueue>(clock, planner, wakeup_timer);
+        int triggered_count = 0;
+        alarm_queue->alarm_reached().connect([&triggered_count, appt](const Appointment&, const Alarm& active_alarm) {
+            EXPECT_TRUE(std::find(appt.alarms.begin(), appt.alarms.end(), active_alarm) != appt.alarms.end());
+            ++triggered_count;
+        });
+        for (auto now=range_begin; now<range_end; now+=std::chrono::minutes{1})
+          mock_clock->set_localtime(now);
+        EXPECT_EQ(appt.alarms.size(), triggered_count);
+
+        // cleanup
+        g_time_zone_unref(gtz);
     }
+};
 
-    // the planner should match what we've got in the calendar.ics file
-    const auto appts = planner->appointments().get();
-    ASSERT_EQ(1, appts.size());
-    const auto& appt = appts.front();
-    ASSERT_EQ(8, appt.alarms.size());
-    EXPECT_EQ(Alarm({"Time to pack!",      "file://" CALENDAR_DEFAULT_SOUND, DateTime(gtz,2015,4,23,13,35,0)}), appt.alarms[0]);
-    EXPECT_EQ(Alarm({"Time to pack!",      "file://" CALENDAR_DEFAULT_SOUND, DateTime(gtz,2015,4,23,13,37,0)}), appt.alarms[1]);
-    EXPECT_EQ(Alarm({"Time to pack!",      "file://" CALENDAR_DEFAULT_SOUND, DateTime(gtz,2015,4,23,13,39,0)}), appt.alarms[2]);
-    EXPECT_EQ(Alarm({"Time to pack!",      "file://" CALENDAR_DEFAULT_SOUND, DateTime(gtz,2015,4,23,13,41,0)}), appt.alarms[3]);
-    EXPECT_EQ(Alarm({"Go to the airport!", "file://" CALENDAR_DEFAULT_SOUND, DateTime(gtz,2015,4,24,10,35,0)}), appt.alarms[4]);
-    EXPECT_EQ(Alarm({"Go to the airport!", "file://" CALENDAR_DEFAULT_SOUND, DateTime(gtz,2015,4,24,10,37,0)}), appt.alarms[5]);
-    EXPECT_EQ(Alarm({"Go to the airport!", "file://" CALENDAR_DEFAULT_SOUND, DateTime(gtz,2015,4,24,10,39,0)}), appt.alarms[6]);
-    EXPECT_EQ(Alarm({"Go to the airport!", "file://" CALENDAR_DEFAULT_SOUND, DateTime(gtz,2015,4,24,10,41,0)}), appt.alarms[7]);
-
-    // now let's try this out with AlarmQueue...
-    // hook the planner up to a SimpleAlarmQueue and confirm that it triggers for each of the reminders
-    auto mock_clock = std::make_shared<MockClock>(range_begin);
-    std::shared_ptr<Clock> clock = mock_clock;
-    std::shared_ptr<WakeupTimer> wakeup_timer = std::make_shared<MockWakeupTimer>(clock);
-    auto alarm_queue = std::make_shared<SimpleAlarmQueue>(clock, planner, wakeup_timer);
-    int triggered_count = 0;
-    alarm_queue->alarm_reached().connect([&triggered_count, appt](const Appointment&, const Alarm& active_alarm) {
-        EXPECT_TRUE(std::find(appt.alarms.begin(), appt.alarms.end(), active_alarm) != appt.alarms.end());
-        ++triggered_count;
-    });
-    for (auto now=range_begin; now<range_end; now+=std::chrono::minutes{1})
-      mock_clock->set_localtime(now);
-    EXPECT_EQ(appt.alarms.size(), triggered_count);
-
-    // cleanup
-    g_time_zone_unref(gtz);
+/***
+****
+***/
+
+TEST_F(VAlarmFixture, MultipleAppointments)
+{
+    check_multiple_appointments(std::make_shared<EdsEngine>(std::make_shared<Myself>()));
+}
+
+TEST_F(VAlarmFixture, MultipleAppointmentsSliced)
+{
+    // convert the components on the main loop instead of in workers
+    check_multiple_appointments(std::make_shared<EdsEngine>(std::make_shared<Myself>(), false));
 }
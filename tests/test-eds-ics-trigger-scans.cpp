@@ -0,0 +1,220 @@
+/*
+ * Copyright 2015 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include <datetime/engine-eds.h>
+#include <datetime/myself.h>
+
+#include <libecal/libecal.h>
+#include <libedataserver/libedataserver.h>
+
+#include <gtest/gtest.h>
+
+#include "glib-fixture.h"
+
+using namespace unity::indicator::datetime;
+
+/***
+****
+***/
+
+class TriggerScanFixture: public GlibFixture
+{
+private:
+
+    typedef GlibFixture super;
+
+protected:
+
+    static constexpr char const * SOURCE_UID {"system-task-list"};
+
+    ESourceRegistry* m_registry {};
+    ECalClient* m_client {};
+
+    void SetUp() override
+    {
+        super::SetUp();
+
+        GError* error = nullptr;
+        m_registry = e_source_registry_new_sync(nullptr, &error);
+        g_assert_no_error(error);
+
+        auto source = e_source_registry_ref_source(m_registry, SOURCE_UID);
+        ASSERT_NE(nullptr, source);
+        auto client = e_cal_client_connect_sync(source,
+                                                E_CAL_CLIENT_SOURCE_TYPE_TASKS,
+#if EDS_CHECK_VERSION(3,13,90)
+                                                -1,
+#endif
+                                                nullptr,
+                                                &error);
+        g_assert_no_error(error);
+        m_client = E_CAL_CLIENT(client);
+        g_object_unref(source);
+    }
+
+    void TearDown() override
+    {
+        g_clear_object(&m_client);
+        g_clear_object(&m_registry);
+
+        super::TearDown();
+    }
+
+    std::string get_revision()
+    {
+        gchar* revision = nullptr;
+        GError* error = nullptr;
+        e_client_get_backend_property_sync(E_CLIENT(m_client), CLIENT_BACKEND_PROPERTY_REVISION, &revision, nullptr, &error);
+        g_assert_no_error(error);
+        std::string ret = revision ? revision : "";
+        g_free(revision);
+        return ret;
+    }
+
+    static std::string get_marker_filename()
+    {
+        auto filename = g_build_filename(g_get_user_cache_dir(), "indicator-datetime", "alarm-triggers.ini", nullptr);
+        std::string ret = filename;
+        g_free(filename);
+        return ret;
+    }
+
+    // pretend that a previous scan found the source clean as of this revision
+    static void set_marker(const std::string& revision)
+    {
+        const auto filename = get_marker_filename();
+        auto dirname = g_path_get_dirname(filename.c_str());
+        g_mkdir_with_parents(dirname, 0700);
+        g_free(dirname);
+
+        auto keyfile = g_key_file_new();
+        g_key_file_set_string(keyfile, "revisions", SOURCE_UID, revision.c_str());
+        gsize length = 0;
+        auto data = g_key_file_to_data(keyfile, &length, nullptr);
+        GError* error = nullptr;
+        g_file_set_contents(filename.c_str(), data, length, &error);
+        g_assert_no_error(error);
+        g_free(data);
+        g_key_file_free(keyfile);
+    }
+
+    static std::string get_marker()
+    {
+        std::string ret;
+        auto keyfile = g_key_file_new();
+        if (g_key_file_load_from_file(keyfile, get_marker_filename().c_str(), G_KEY_FILE_NONE, nullptr))
+        {
+            auto str = g_key_file_get_string(keyfile, "revisions", SOURCE_UID, nullptr);
+            if (str != nullptr)
+                ret = str;
+            g_free(str);
+        }
+        g_key_file_free(keyfile);
+        return ret;
+    }
+
+    // add a clock-app alarm whose VALARM is missing its TRIGGER
+    std::string add_alarm_without_trigger(const char* summary)
+    {
+        auto str = g_strdup_printf("BEGIN:VTODO\r\n"
+                                   "DTSTART:20150618T100000\r\n"
+                                   "SUMMARY:%s\r\n"
+                                   "CATEGORIES:x-canonical-alarm\r\n"
+                                   "BEGIN:VALARM\r\n"
+                                   "ACTION:AUDIO\r\n"
+                                   "END:VALARM\r\n"
+                                   "END:VTODO\r\n", summary);
+        auto icc = icalcomponent_new_from_string(str);
+        g_free(str);
+
+        gchar* uid = nullptr;
+        GError* error = nullptr;
+        e_cal_client_create_object_sync(m_client, icc, &uid, nullptr, &error);
+        g_assert_no_error(error);
+        icalcomponent_free(icc);
+
+        std::string ret = uid ? uid : "";
+        g_free(uid);
+        return ret;
+    }
+
+    bool has_triggers(const std::string& uid)
+    {
+        icalcomponent* icc = nullptr;
+        GError* error = nullptr;
+        e_cal_client_get_object_sync(m_client, uid.c_str(), nullptr, &icc, nullptr, &error);
+        g_assert_no_error(error);
+
+        bool ret = true;
+        for (auto valarm = icalcomponent_get_first_component(icc, ICAL_VALARM_COMPONENT);
+             valarm != nullptr;
+             valarm = icalcomponent_get_next_component(icc, ICAL_VALARM_COMPONENT))
+        {
+            if (icalcomponent_get_first_property(valarm, ICAL_TRIGGER_PROPERTY) == nullptr)
+                ret = false;
+        }
+
+        icalcomponent_free(icc);
+        return ret;
+    }
+};
+
+/***
+****
+***/
+
+TEST_F(TriggerScanFixture, UnchangedRevisionSkipsScan)
+{
+    const auto uid = add_alarm_without_trigger("Skipped");
+    const auto revision = get_revision();
+    ASSERT_FALSE(revision.empty());
+    set_marker(revision);
+
+    // the revision matches the marker, so the engine shouldn't scan
+    auto engine = std::make_shared<EdsEngine>(std::make_shared<Myself>());
+    wait_msec(3000);
+    EXPECT_FALSE(has_triggers(uid));
+    EXPECT_EQ(revision, get_marker());
+}
+
+TEST_F(TriggerScanFixture, ChangedRevisionRescans)
+{
+    const auto uid = add_alarm_without_trigger("Rescanned");
+    set_marker("stale");
+
+    // the revision doesn't match the marker, so the engine should scan and repair
+    auto engine = std::make_shared<EdsEngine>(std::make_shared<Myself>());
+    EXPECT_TRUE(wait_for([this, &uid](){return has_triggers(uid);}, 10000));
+
+    // the repair bumped the revision, so the marker isn't written until a clean scan
+    EXPECT_NE(get_revision(), get_marker());
+}
+
+TEST_F(TriggerScanFixture, ViewPayloadIsRepaired)
+{
+    set_marker(get_revision());
+
+    // let the engine skip its scan and start watching the source...
+    auto engine = std::make_shared<EdsEngine>(std::make_shared<Myself>());
+    wait_msec(3000);
+
+    // ...then add an alarm, which it should repair from the view's payload
+    const auto uid = add_alarm_without_trigger("Added Later");
+    EXPECT_TRUE(wait_for([this, &uid](){return has_triggers(uid);}, 10000));
+}
@@ -247,3 +247,40 @@ TEST_F(ExporterFixture, AlarmProperties)
     // cleanup
     g_clear_object(&proxy);
 }
+
+TEST_F(ExporterFixture, LazyMenus)
+{
+    auto state = std::make_shared<MockState>();
+    auto actions = std::make_shared<MockActions>(state);
+    auto settings = std::make_shared<Settings>();
+    auto menu_factory = std::make_shared<MenuFactory>(actions, state);
+
+    constexpr unsigned int suspend_delay_msec {100};
+    Exporter exporter(settings);
+    exporter.publish(actions, menu_factory, suspend_delay_msec);
+    wait_msec();
+
+    // nothing's subscribed yet, so no menus should be built
+    for(int i=0; i<Menu::NUM_PROFILES; i++)
+        EXPECT_FALSE(exporter.active_menu(Menu::Profile(i)));
+
+    // subscribe to the desktop menu
+    auto connection = g_bus_get_sync(G_BUS_TYPE_SESSION, nullptr, nullptr);
+    const auto path = std::string(BUS_DATETIME_PATH) + "/" + Menu::profile_name(Menu::Desktop);
+    auto model = G_MENU_MODEL(g_dbus_menu_model_get(connection, BUS_DATETIME_NAME, path.c_str()));
+    g_menu_model_get_n_items(model);
+    EXPECT_TRUE(wait_for([&exporter](){return bool(exporter.active_menu(Menu::Desktop));}));
+    EXPECT_TRUE(wait_for([model](){return g_menu_model_get_n_items(model) == 1;}));
+
+    // the other profiles should still be unbuilt
+    EXPECT_FALSE(exporter.active_menu(Menu::DesktopGreeter));
+    EXPECT_FALSE(exporter.active_menu(Menu::Phone));
+    EXPECT_FALSE(exporter.active_menu(Menu::PhoneGreeter));
+
+    // unsubscribe; the menu should be suspended after the grace period
+    g_clear_object(&model);
+    EXPECT_TRUE(wait_for([&exporter](){return !exporter.active_menu(Menu::Desktop);}, 2000));
+
+    // cleanup
+    g_clear_object(&connection);
+}
@@ -166,3 +166,31 @@ TEST_F(LocationsFixture, ChangeLocationVisibility)
     EXPECT_EQ("New York", l[1].name());
     EXPECT_EQ(nyc, l[1].zone());
 }
+
+TEST_F(LocationsFixture, NextTransition)
+{
+    const auto now = time(nullptr);
+
+    // Chicago observes DST, so its offset changes within the year
+    const Location chi(chicago, "Chicago");
+    const auto t = chi.next_transition();
+    EXPECT_LT(now, t);
+    EXPECT_GT(now + 366*24*60*60, t);
+
+    auto gtz = g_time_zone_new(chicago.c_str());
+    auto before = g_date_time_new_from_unix_utc(t-1);
+    auto after = g_date_time_new_from_unix_utc(t);
+    auto before_local = g_date_time_to_timezone(before, gtz);
+    auto after_local = g_date_time_to_timezone(after, gtz);
+    EXPECT_EQ(chi.offset(), g_date_time_get_utc_offset(before_local));
+    EXPECT_NE(chi.offset(), g_date_time_get_utc_offset(after_local));
+    g_date_time_unref(after_local);
+    g_date_time_unref(before_local);
+    g_date_time_unref(after);
+    g_date_time_unref(before);
+    g_time_zone_unref(gtz);
+
+    // UTC never changes
+    const Location utc("UTC", "Greenwich");
+    EXPECT_EQ(0, utc.next_transition());
+}
@@ -509,10 +509,12 @@ TEST_F(MenuFixture, Sections)
 TEST_F(MenuFixture, Calendar)
 {
     m_state->settings->show_calendar.set(true);
+    wait_msec();
     for(auto& menu : m_menus)
       InspectCalendar(menu->menu_model(), menu->profile());
 
     m_state->settings->show_calendar.set(false);
+    wait_msec();
     for(auto& menu : m_menus)
       InspectCalendar(menu->menu_model(), menu->profile());
 }
@@ -542,4 +544,28 @@ TEST_F(MenuFixture, Settings)
       InspectSettings(menu->menu_model(), menu->profile());
 }
 
-
+TEST_F(MenuFixture, RebuildsAreCoalesced)
+{
+    auto& menu = m_menus[Menu::Desktop];
+    wait_msec();
+    const auto emitted_before = menu->rebuilds_emitted();
+    const auto coalesced_before = menu->rebuilds_coalesced();
+
+    // a burst of changes that each dirty the Locations section...
+    std::vector<Location> locations;
+    locations.push_back(Location("America/Chicago", "Oklahoma City"));
+    m_state->locations->locations.set(locations);
+    locations.push_back(Location("Europe/London", "London"));
+    m_state->locations->locations.set(locations);
+    locations.push_back(Location("Asia/Tokyo", "Tokyo"));
+    m_state->locations->locations.set(locations);
+
+    // ...shouldn't touch the menu until the main loop goes idle
+    EXPECT_EQ(emitted_before, menu->rebuilds_emitted());
+    EXPECT_EQ(coalesced_before + 2, menu->rebuilds_coalesced());
+
+    // and then they should be flushed in a single rebuild
+    wait_msec();
+    EXPECT_EQ(emitted_before + 1, menu->rebuilds_emitted());
+    CompareLocationsTo(menu->menu_model(), locations);
+}
@@ -0,0 +1,324 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include <bus/bus-registry.h>
+#include <notifications/dbus-shared.h>
+#include <notifications/notifications.h>
+
+#include "test-dbus-fixture.h"
+
+#include <string>
+#include <vector>
+
+/***
+****
+***/
+
+using namespace unity::indicator;
+
+namespace
+{
+  static constexpr char const * APP_NAME {"indicator-datetime-service"};
+
+  static const char * NOTIFY_XML =
+    "<node>"
+    "  <interface name='" BUS_NOTIFY_INTERFACE "'>"
+    "    <method name='GetCapabilities'>"
+    "      <arg direction='out' type='as'/>"
+    "    </method>"
+    "    <method name='Notify'>"
+    "      <arg direction='in' type='s'/>"
+    "      <arg direction='in' type='u'/>"
+    "      <arg direction='in' type='s'/>"
+    "      <arg direction='in' type='s'/>"
+    "      <arg direction='in' type='s'/>"
+    "      <arg direction='in' type='as'/>"
+    "      <arg direction='in' type='a{sv}'/>"
+    "      <arg direction='in' type='i'/>"
+    "      <arg direction='out' type='u'/>"
+    "    </method>"
+    "    <method name='CloseNotification'>"
+    "      <arg direction='in' type='u'/>"
+    "    </method>"
+    "    <signal name='NotificationClosed'>"
+    "      <arg type='u'/>"
+    "      <arg type='u'/>"
+    "    </signal>"
+    "  </interface>"
+    "</node>";
+}
+
+/**
+ * Runs a minimal notification server on its own bus connection,
+ * so that tests can stop it and start a new one with a different
+ * unique name, just like a real server restart.
+ */
+class NotificationEngineFixture: public TestDBusFixture
+{
+private:
+
+  typedef TestDBusFixture super;
+
+  static void on_method_call(GDBusConnection       * connection,
+                             const gchar           * /*sender*/,
+                             const gchar           * /*object_path*/,
+                             const gchar           * /*interface_name*/,
+                             const gchar           * method_name,
+                             GVariant              * parameters,
+                             GDBusMethodInvocation * invocation,
+                             gpointer                gself)
+  {
+    auto self = static_cast<NotificationEngineFixture*>(gself);
+
+    if (!g_strcmp0(method_name, "GetCapabilities"))
+    {
+      ++self->caps_calls;
+      GVariantBuilder builder;
+      g_variant_builder_init(&builder, G_VARIANT_TYPE_STRING_ARRAY);
+      for (const auto& cap : self->caps)
+        g_variant_builder_add(&builder, "s", cap.c_str());
+      g_dbus_method_invocation_return_value(invocation, g_variant_new("(as)", &builder));
+    }
+    else if (!g_strcmp0(method_name, "Notify"))
+    {
+      g_dbus_method_invocation_return_value(invocation, g_variant_new("(u)", self->next_id++));
+    }
+    else if (!g_strcmp0(method_name, "CloseNotification"))
+    {
+      guint32 id = 0;
+      g_variant_get(parameters, "(u)", &id);
+      self->closed_ids.push_back(id);
+      g_dbus_connection_emit_signal(connection,
+                                    nullptr,
+                                    BUS_NOTIFY_PATH,
+                                    BUS_NOTIFY_INTERFACE,
+                                    "NotificationClosed",
+                                    g_variant_new("(uu)", id, NOTIFICATION_CLOSED_API),
+                                    nullptr);
+      g_dbus_method_invocation_return_value(invocation, nullptr);
+    }
+  }
+
+protected:
+
+  static constexpr guint32 FIRST_NOTIFY_ID {1000};
+  static constexpr guint32 NOTIFICATION_CLOSED_API {3};
+
+  std::shared_ptr<bus::BusRegistry> buses;
+  GDBusNodeInfo * node_info = nullptr;
+  GDBusConnection * server_bus = nullptr;
+  guint object_tag = 0;
+  guint name_tag = 0;
+
+  std::vector<std::string> caps;
+  std::vector<guint32> closed_ids;
+  guint32 next_id = FIRST_NOTIFY_ID;
+  unsigned int caps_calls = 0;
+
+  void SetUp() override
+  {
+    super::SetUp();
+
+    GError * error = nullptr;
+    node_info = g_dbus_node_info_new_for_xml(NOTIFY_XML, &error);
+    g_assert_no_error(error);
+
+    buses = std::make_shared<bus::BusRegistry>(system_bus, system_bus);
+  }
+
+  void TearDown() override
+  {
+    stop_server();
+    buses.reset();
+    g_clear_pointer(&node_info, g_dbus_node_info_unref);
+
+    super::TearDown();
+  }
+
+  void start_server(const std::vector<std::string>& server_caps)
+  {
+    GError * error = nullptr;
+
+    caps = server_caps;
+    server_bus = g_dbus_connection_new_for_address_sync(g_test_dbus_get_bus_address(test_dbus),
+                                                        GDBusConnectionFlags(G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                                                             G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION),
+                                                        nullptr,
+                                                        nullptr,
+                                                        &error);
+    g_assert_no_error(error);
+
+    static const GDBusInterfaceVTable vtable = { on_method_call, nullptr, nullptr };
+    object_tag = g_dbus_connection_register_object(server_bus,
+                                                   BUS_NOTIFY_PATH,
+                                                   node_info->interfaces[0],
+                                                   &vtable,
+                                                   this,
+                                                   nullptr,
+                                                   &error);
+    g_assert_no_error(error);
+
+    name_tag = g_bus_own_name_on_connection(server_bus,
+                                            BUS_NOTIFY_NAME,
+                                            G_BUS_NAME_OWNER_FLAGS_NONE,
+                                            nullptr,
+                                            nullptr,
+                                            nullptr,
+                                            nullptr);
+    ASSERT_NAME_OWNED_EVENTUALLY(system_bus, BUS_NOTIFY_NAME);
+  }
+
+  void stop_server()
+  {
+    if (server_bus == nullptr)
+      return;
+
+    g_bus_unown_name(name_tag);
+    name_tag = 0;
+    g_dbus_connection_unregister_object(server_bus, object_tag);
+    object_tag = 0;
+    g_dbus_connection_close_sync(server_bus, nullptr, nullptr);
+    g_clear_object(&server_bus);
+    wait_msec();
+  }
+
+  int show(notifications::Engine& ne,
+           std::function<void(const std::string&)> on_closed,
+           std::function<void(int,bool)> on_shown)
+  {
+    notifications::Builder b;
+    b.set_title("Wakeup");
+    b.set_body("It's time");
+    b.set_show_notification_bubble(true);
+    b.set_post_to_messaging_menu(false);
+    b.set_closed_callback(on_closed);
+    return ne.show(b, on_shown);
+  }
+};
+
+/***
+****
+***/
+
+TEST_F(NotificationEngineFixture, ActionsAreAssumedUntilTheServerReplies)
+{
+  // no server yet, so we don't know its caps
+  notifications::Engine ne(APP_NAME, buses);
+  EXPECT_TRUE(ne.supports_actions());
+  wait_msec();
+  EXPECT_TRUE(ne.supports_actions());
+
+  // when a server shows up, use what it tells us
+  start_server({"body"});
+  EXPECT_TRUE(wait_for([&ne](){return !ne.supports_actions();}));
+}
+
+TEST_F(NotificationEngineFixture, CapsSurviveServerRestart)
+{
+  start_server({"actions", "body"});
+  notifications::Engine ne(APP_NAME, buses);
+  EXPECT_TRUE(wait_for([this](){return caps_calls > 0;}));
+  wait_msec();
+  EXPECT_TRUE(ne.supports_actions());
+
+  // while the server is gone, keep the caps we knew
+  stop_server();
+  EXPECT_TRUE(ne.supports_actions());
+
+  // when it comes back, ask it again
+  const auto calls_before = caps_calls;
+  start_server({"actions", "body"});
+  EXPECT_TRUE(wait_for([this, calls_before](){return caps_calls > calls_before;}));
+  wait_msec();
+  EXPECT_TRUE(ne.supports_actions());
+}
+
+TEST_F(NotificationEngineFixture, CapsAreRefreshedByNewServer)
+{
+  start_server({"body"});
+  notifications::Engine ne(APP_NAME, buses);
+  EXPECT_TRUE(wait_for([&ne](){return !ne.supports_actions();}));
+
+  stop_server();
+  start_server({"actions", "body"});
+  EXPECT_TRUE(wait_for([&ne](){return ne.supports_actions();}));
+
+  stop_server();
+  start_server({"body"});
+  EXPECT_TRUE(wait_for([&ne](){return !ne.supports_actions();}));
+}
+
+TEST_F(NotificationEngineFixture, CloseBeforeIdIsKnown)
+{
+  start_server({"actions", "body"});
+  notifications::Engine ne(APP_NAME, buses);
+
+  int closed_count = 0;
+  int shown_count = 0;
+  int server_closed_count = 0;
+  const auto key = show(ne,
+                        [&closed_count](const std::string&){++closed_count;},
+                        [&shown_count](int, bool){++shown_count;});
+  EXPECT_NE(0, key);
+
+  // close it before Notify has returned the server's id
+  ne.close(key, [&server_closed_count](bool closed){
+    EXPECT_TRUE(closed);
+    ++server_closed_count;
+  });
+  EXPECT_EQ(1, closed_count);
+
+  // once the id is known, the server is told to close it
+  EXPECT_TRUE(wait_for([&server_closed_count](){return server_closed_count > 0;}));
+  EXPECT_EQ(std::vector<guint32>{FIRST_NOTIFY_ID}, closed_ids);
+  EXPECT_EQ(1, shown_count);
+
+  // and the server's NotificationClosed signal doesn't close it twice
+  wait_msec();
+  EXPECT_EQ(1, closed_count);
+  EXPECT_EQ(1, server_closed_count);
+}
+
+TEST_F(NotificationEngineFixture, CloseBeforeConnected)
+{
+  start_server({"actions", "body"});
+
+  // with no buses given, the engine connects to the session bus asynchronously
+  notifications::Engine ne(APP_NAME);
+
+  int closed_count = 0;
+  std::vector<bool> shown;
+  std::vector<bool> server_closed;
+  const auto key = show(ne,
+                        [&closed_count](const std::string&){++closed_count;},
+                        [&shown](int, bool was_shown){shown.push_back(was_shown);});
+  EXPECT_NE(0, key);
+
+  // close it before the engine has even connected
+  ne.close(key, [&server_closed](bool closed){server_closed.push_back(closed);});
+  EXPECT_EQ(1, closed_count);
+
+  // once connected, the callbacks are called without bothering the server
+  EXPECT_TRUE(wait_for([&shown](){return !shown.empty();}));
+  EXPECT_EQ(std::vector<bool>{false}, shown);
+  EXPECT_EQ(std::vector<bool>{true}, server_closed);
+  EXPECT_EQ(FIRST_NOTIFY_ID, next_id);
+  EXPECT_TRUE(closed_ids.empty());
+  EXPECT_EQ(1, closed_count);
+}
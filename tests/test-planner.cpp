@@ -21,14 +21,20 @@
 #include "timezone-mock.h"
 
 #include <datetime/appointment.h>
+#include <datetime/appointment-index.h>
 #include <datetime/clock-mock.h>
 #include <datetime/date-time.h>
 #include <datetime/planner.h>
+#include <datetime/planner-alarms.h>
 #include <datetime/planner-range.h>
+#include <datetime/planner-upcoming.h>
 
 #include <langinfo.h>
 #include <locale.h>
 
+#include <algorithm> // std::any_of(), std::find()
+#include <string> // std::to_string()
+
 using namespace unity::indicator::datetime;
 
 /***
@@ -66,3 +72,327 @@ TEST_F(PlannerFixture, HelloWorld)
     EXPECT_EQ(d.end, a.end);
 }
 
+
+TEST_F(PlannerFixture, IndexOverlaps)
+{
+    const auto day = DateTime::Local(2020, 6, 10, 0, 0, 0);
+
+    std::vector<Appointment> appointments;
+    for (int i=0; i<100; ++i)
+    {
+        Appointment a;
+        a.uid = std::to_string(i);
+        a.begin = day.add_full(0,0,0,i,0,0);
+        a.end = a.begin.add_full(0,0,0,0,30,0);
+        a.alarms.push_back(Alarm{"", "", a.begin.add_full(0,0,0,0,-5,0)});
+        appointments.push_back(a);
+    }
+
+    // a long event spanning three days, added out of order
+    Appointment trip;
+    trip.uid = "trip";
+    trip.begin = day.add_full(0,0,0,12,0,0);
+    trip.end = day.add_days(3);
+    appointments.push_back(trip);
+
+    const AppointmentIndex index(appointments);
+    ASSERT_EQ(101, index.appointments().size());
+    for (size_t i=1; i<index.appointments().size(); ++i)
+        EXPECT_LE(index.appointments()[i-1].begin, index.appointments()[i].begin);
+
+    // the half-hour events at 10:00 and 11:00 overlap [10:15..11:00], as does nothing else
+    auto hits = index.overlapping(day.add_full(0,0,0,10,15,0), day.add_full(0,0,0,11,0,0));
+    ASSERT_EQ(2, hits.size());
+    EXPECT_EQ("10", hits[0].uid);
+    EXPECT_EQ("11", hits[1].uid);
+
+    // the trip overlaps everything from noon on day 1 until the end of day 3
+    hits = index.overlapping(day.add_full(0,0,2,6,45,0), day.add_full(0,0,2,6,50,0));
+    ASSERT_EQ(1, hits.size());
+    EXPECT_EQ("trip", hits[0].uid);
+
+    // the trip should be bucketed under each day it touches, but not the day it ends
+    for (int i=0; i<3; ++i)
+    {
+        hits = index.on_day(day.add_days(i));
+        EXPECT_NE(hits.end(), std::find(hits.begin(), hits.end(), trip)) << i;
+    }
+    EXPECT_EQ(0, index.on_day(day.add_days(5)).size());
+    EXPECT_EQ(24, index.on_day(day.add_days(1)).size() - 1);
+
+    // "starts after" should be a suffix of the sorted list
+    hits = index.starting_after(day.add_full(0,0,0,98,0,0));
+    ASSERT_EQ(2, hits.size());
+    EXPECT_EQ("98", hits[0].uid);
+    EXPECT_EQ("99", hits[1].uid);
+
+    // alarms should be visited in trigger order
+    std::vector<std::string> uids;
+    index.foreach_alarm_after(day.add_full(0,0,0,50,0,0), [&uids](const Appointment& a, const Alarm&){
+        uids.push_back(a.uid);
+        return uids.size() < 3;
+    });
+    EXPECT_EQ(std::vector<std::string>({"51", "52", "53"}), uids);
+}
+
+TEST_F(PlannerFixture, IndexLookups)
+{
+    const auto day = DateTime::Local(2020, 6, 10, 0, 0, 0);
+
+    // three instances of a daily event from one source and an alarm from another
+    std::vector<Appointment> appointments;
+    for (int i=2; i>=0; --i)
+    {
+        Appointment a;
+        a.uid = "standup";
+        a.source_uid = "work";
+        a.begin = a.end = day.add_full(0,0,i,9,0,0);
+        appointments.push_back(a);
+    }
+    Appointment alarm;
+    alarm.uid = "wakeup";
+    alarm.source_uid = "alarms";
+    alarm.type = Appointment::UBUNTU_ALARM;
+    alarm.begin = alarm.end = day.add_full(0,0,0,7,0,0);
+    appointments.push_back(alarm);
+
+    const AppointmentIndex index(appointments);
+
+    // looking up a recurring uid yields its earliest instance
+    auto found = index.find_uid("standup");
+    ASSERT_TRUE(found != nullptr);
+    EXPECT_EQ(day.add_full(0,0,0,9,0,0), found->begin);
+    found = index.find_uid("wakeup");
+    ASSERT_TRUE(found != nullptr);
+    EXPECT_EQ(alarm, *found);
+    EXPECT_EQ(nullptr, index.find_uid("nope"));
+
+    EXPECT_EQ(3, index.from_source("work").size());
+    EXPECT_EQ(std::vector<Appointment>({alarm}), index.from_source("alarms"));
+    EXPECT_TRUE(index.from_source("nope").empty());
+}
+
+namespace
+{
+    // an Engine that hands out a fixed list and counts how often it's asked
+    class CountingEngine: public Engine
+    {
+    public:
+        std::vector<Appointment> appointments;
+        int n_queries = 0;
+        DateTime last_begin;
+        DateTime last_end;
+
+        void get_appointments(const DateTime& begin,
+                              const DateTime& end,
+                              const Timezone& /*default_timezone*/,
+                              std::function<void(const std::vector<Appointment>&)> func) override {
+            ++n_queries;
+            last_begin = begin;
+            last_end = end;
+            std::vector<Appointment> found;
+            for (const auto& appointment : appointments)
+                if ((appointment.begin < end) && (begin < appointment.end))
+                    found.push_back(appointment);
+            func(found);
+        }
+
+        core::Signal<>& changed() override {
+            return m_changed;
+        }
+
+        void disable_ubuntu_alarm(const Appointment&) override {
+        }
+
+    private:
+        core::Signal<> m_changed;
+    };
+}
+
+TEST_F(PlannerFixture, TimezoneChangeReprojects)
+{
+    auto engine = std::make_shared<CountingEngine>();
+    auto tz = std::make_shared<MockTimezone>("America/Chicago");
+
+    const auto begin = DateTime::Local(2020, 10, 31, 18, 30, 0).to_timezone("America/Chicago");
+    Appointment a;
+    a.uid = "party";
+    a.begin = begin;
+    a.end = begin.add_full(0,0,0,3,0,0);
+    Alarm alarm;
+    alarm.text = "Party";
+    alarm.time = begin.add_full(0,0,0,0,-15,0);
+    a.alarms.push_back(alarm);
+    engine->appointments.push_back(a);
+
+    SimpleRangePlanner planner(engine, tz);
+    planner.range().set(std::make_pair(begin.start_of_day(), begin.end_of_day()));
+    wait_msec(300);
+    ASSERT_EQ(1, engine->n_queries);
+    ASSERT_EQ(1, planner.appointments().get().size());
+
+    // changing the zone should move the times without asking the engine
+    bool changed = false;
+    planner.appointments().changed().connect([&changed](const std::vector<Appointment>&){changed = true;});
+    tz->timezone.set("Europe/Berlin");
+    EXPECT_TRUE(changed);
+    auto got = planner.appointments().get().front();
+    EXPECT_EQ(a.begin, got.begin);
+    EXPECT_EQ(begin.to_timezone("Europe/Berlin").format("%F %T %z"), got.begin.format("%F %T %z"));
+    EXPECT_EQ(alarm.time.to_timezone("Europe/Berlin").format("%F %T %z"), got.alarms.front().time.format("%F %T %z"));
+    wait_msec(300);
+    EXPECT_EQ(1, engine->n_queries);
+
+    // but floating times have to be resolved again
+    engine->appointments.front().floating = true;
+    planner.range().set(std::make_pair(begin.start_of_day(), begin.add_days(1).end_of_day()));
+    wait_msec(300);
+    ASSERT_EQ(2, engine->n_queries);
+    tz->timezone.set("Asia/Tokyo");
+    wait_msec(300);
+    EXPECT_EQ(3, engine->n_queries);
+}
+
+TEST_F(PlannerFixture, UpcomingPlannerSlidesForward)
+{
+    auto engine = std::make_shared<CountingEngine>();
+    auto tz = std::make_shared<MockTimezone>("America/Chicago");
+
+    const auto day = DateTime::Local(2020, 10, 1, 12, 0, 0);
+    Appointment today;
+    today.uid = "today";
+    today.begin = day.start_of_day().add_full(0,0,0,9,0,0);
+    today.end = today.begin.add_full(0,0,0,1,0,0);
+    Appointment later;
+    later.uid = "later";
+    later.begin = day.start_of_day().add_full(0,1,0,12,0,0);
+    later.end = later.begin.add_full(0,0,0,1,0,0);
+    engine->appointments = std::vector<Appointment>({today, later});
+
+    auto range_planner = std::make_shared<SimpleRangePlanner>(engine, tz);
+    UpcomingPlanner upcoming(range_planner, day);
+    wait_msec(300);
+    ASSERT_EQ(1, engine->n_queries);
+    EXPECT_EQ(std::vector<Appointment>({today}), upcoming.appointments().get());
+
+    // moving to the next day should only fetch the day that was added,
+    // and drop the appointments that are over
+    upcoming.date().set(day.add_days(1));
+    wait_msec(300);
+    ASSERT_EQ(2, engine->n_queries);
+    EXPECT_EQ(day.start_of_day().add_full(0,1,0,0,0,0), engine->last_begin);
+    EXPECT_EQ(day.add_days(1).start_of_day().add_full(0,1,0,0,0,0), engine->last_end);
+    EXPECT_EQ(std::vector<Appointment>({later}), upcoming.appointments().get());
+
+    // but if the engine changes, we need the whole window again
+    engine->changed()();
+    wait_msec(300);
+    ASSERT_EQ(3, engine->n_queries);
+    EXPECT_EQ(day.add_days(1).start_of_day(), engine->last_begin);
+    EXPECT_EQ(std::vector<Appointment>({later}), upcoming.appointments().get());
+
+    // going back a day isn't a slide
+    upcoming.date().set(day);
+    wait_msec(300);
+    ASSERT_EQ(4, engine->n_queries);
+    EXPECT_EQ(day.start_of_day(), engine->last_begin);
+    EXPECT_EQ(std::vector<Appointment>({today}), upcoming.appointments().get());
+}
+
+TEST_F(PlannerFixture, AlarmPlannerGrowsItsHorizon)
+{
+    auto engine = std::make_shared<CountingEngine>();
+    auto tz = std::make_shared<MockTimezone>("America/Chicago");
+    auto clock = std::make_shared<MockClock>(DateTime::Local(2020, 10, 1, 12, 0, 0));
+
+    auto make_appointment = [](const char* uid, const DateTime& begin, bool has_alarm){
+        Appointment a;
+        a.uid = uid;
+        a.begin = begin;
+        a.end = begin.add_full(0,0,0,1,0,0);
+        if (has_alarm) {
+            Alarm alarm;
+            alarm.text = uid;
+            alarm.time = begin;
+            a.alarms.push_back(alarm);
+        }
+        return a;
+    };
+    engine->appointments.push_back(make_appointment("soon", DateTime::Local(2020, 10, 1, 13, 0, 0), true));
+    engine->appointments.push_back(make_appointment("no-alarm", DateTime::Local(2020, 10, 1, 14, 0, 0), false));
+    engine->appointments.push_back(make_appointment("later", DateTime::Local(2020, 10, 20, 9, 0, 0), true));
+    engine->appointments.push_back(make_appointment("much-later", DateTime::Local(2020, 12, 1, 9, 0, 0), true));
+
+    // the horizon should keep doubling until it holds three alarms
+    AlarmPlanner planner(engine, tz, clock);
+    wait_msec(300);
+    EXPECT_EQ(5, engine->n_queries); // 7, 14, 28, 56, 112 days
+    EXPECT_EQ(112, planner.horizon_days());
+    const auto& appointments = planner.appointments().get();
+    ASSERT_EQ(3u, appointments.size());
+    for (const auto& appointment : appointments)
+        EXPECT_FALSE(appointment.alarms.empty());
+
+    // plenty of alarms left, so nothing to do
+    planner.refill();
+    wait_msec(300);
+    EXPECT_EQ(5, engine->n_queries);
+
+    // once one goes off, look further ahead, but not forever
+    clock->set_localtime_quietly(DateTime::Local(2020, 10, 1, 13, 30, 0));
+    planner.refill();
+    wait_msec(300);
+    EXPECT_EQ(7, engine->n_queries); // 224, 366 days
+    EXPECT_EQ(366, planner.horizon_days());
+    EXPECT_EQ(3u, planner.appointments().get().size());
+}
+
+TEST_F(PlannerFixture, AlarmPlannerHorizonReachesEarlyAlarms)
+{
+    auto engine = std::make_shared<CountingEngine>();
+    auto tz = std::make_shared<MockTimezone>("America/Chicago");
+    auto clock = std::make_shared<MockClock>(DateTime::Local(2020, 10, 1, 12, 0, 0));
+
+    auto make_appointment = [](const std::string& uid, const DateTime& begin, const DateTime& alarm_time){
+        Appointment a;
+        a.uid = uid;
+        a.begin = begin;
+        a.end = begin.add_full(0,0,0,1,0,0);
+        Alarm alarm;
+        alarm.text = uid;
+        alarm.time = alarm_time;
+        a.alarms.push_back(alarm);
+        return a;
+    };
+
+    // plenty of alarms, so that the horizon wants to shrink...
+    for (int day=1; day<=31; ++day) {
+        for (int hour=13; hour<23; ++hour) {
+            const auto begin = DateTime::Local(2020, 10, day, hour, 0, 0);
+            engine->appointments.push_back(make_appointment("busy-" + std::to_string(day) + "-" + std::to_string(hour), begin, begin));
+        }
+    }
+
+    // ...and a weekly meeting whose alarms trigger two days ahead of it
+    for (int day=4; day<=31; day+=7) {
+        const auto begin = DateTime::Local(2020, 10, day, 9, 0, 0);
+        engine->appointments.push_back(make_appointment("weekly-" + std::to_string(day), begin, begin.add_days(-2)));
+    }
+
+    AlarmPlanner planner(engine, tz, clock);
+    wait_msec(300);
+    EXPECT_EQ(3, planner.horizon_days()); // 7 halved, and just enough for the weekly alarm
+
+    // it would shrink to a day without the weekly meeting's alarms
+    for (int day=2; day<=6; ++day) {
+        planner.date().set(DateTime::Local(2020, 10, day, 12, 0, 0));
+        wait_msec(300);
+        EXPECT_EQ(3, planner.horizon_days());
+    }
+
+    // so the alarm for the 11th's meeting is found on the 9th
+    planner.date().set(DateTime::Local(2020, 10, 9, 0, 0, 0));
+    wait_msec(300);
+    const auto& appointments = planner.appointments().get();
+    EXPECT_TRUE(std::any_of(appointments.begin(), appointments.end(), [](const Appointment& a){return a.uid == "weekly-11";}));
+}
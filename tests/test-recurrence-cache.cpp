@@ -0,0 +1,238 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include <datetime/recurrence-cache.h>
+
+#include "glib-fixture.h"
+
+#include <string>
+#include <vector>
+
+using namespace unity::indicator::datetime;
+
+/***
+****
+***/
+
+class RecurrenceCacheFixture: public GlibFixture
+{
+private:
+
+    typedef GlibFixture super;
+
+protected:
+
+    std::vector<icalcomponent*> m_components;
+
+    void TearDown() override
+    {
+        for (auto& icc : m_components)
+            icalcomponent_free(icc);
+        m_components.clear();
+
+        super::TearDown();
+    }
+
+    icalcomponent* parse(const std::string& rules, const char* uid="series")
+    {
+        const std::string str = std::string("BEGIN:VEVENT\r\n")
+                              + "UID:" + uid + "\r\n"
+                              + "SUMMARY:Standup\r\n"
+                              + rules
+                              + "END:VEVENT\r\n";
+        auto icc = icalparser_parse_string(str.c_str());
+        EXPECT_TRUE(icc != nullptr);
+        m_components.push_back(icc);
+        return icc;
+    }
+
+    static time_t utc(int year, int month, int day, int hour=0)
+    {
+        auto gdt = g_date_time_new_utc(year, month, day, hour, 0, 0);
+        const auto ret = time_t(g_date_time_to_unix(gdt));
+        g_date_time_unref(gdt);
+        return ret;
+    }
+
+    static std::vector<std::string> to_strings(const std::vector<RecurrenceCache::Occurrence>& occurrences)
+    {
+        std::vector<std::string> ret;
+        for (const auto& o : occurrences)
+            ret.push_back(icaltime_as_ical_string(o.begin));
+        return ret;
+    }
+};
+
+/***
+****
+***/
+
+TEST_F(RecurrenceCacheFixture, ExdatesAndRdates)
+{
+    auto icc = parse("DTSTART:20200101T090000Z\r\n"
+                     "DTEND:20200101T100000Z\r\n"
+                     "RRULE:FREQ=DAILY;COUNT=5\r\n"
+                     "EXDATE:20200103T090000Z\r\n"
+                     "RDATE:20200110T090000Z\r\n");
+    EXPECT_TRUE(RecurrenceCache::is_recurring(icc));
+
+    RecurrenceCache cache;
+    const auto utc_zone = icaltimezone_get_utc_timezone();
+    const auto occurrences = cache.occurrences("source", icc, utc_zone, utc(2020,1,1), utc(2020,2,1));
+    const std::vector<std::string> expected = { "20200101T090000Z", "20200102T090000Z",
+                                                "20200104T090000Z", "20200105T090000Z",
+                                                "20200110T090000Z" };
+    EXPECT_EQ(expected, to_strings(occurrences));
+    ASSERT_EQ(expected.size(), occurrences.size());
+    EXPECT_STREQ("20200101T100000Z", icaltime_as_ical_string(occurrences.front().end));
+}
+
+TEST_F(RecurrenceCacheFixture, WindowsCanMoveForward)
+{
+    auto icc = parse("DTSTART:20200101T090000Z\r\n"
+                     "DTEND:20200101T100000Z\r\n"
+                     "RRULE:FREQ=WEEKLY\r\n");
+
+    RecurrenceCache cache;
+    const auto zone = icaltimezone_get_utc_timezone();
+    const auto january = to_strings(cache.occurrences("source", icc, zone, utc(2020,1,1), utc(2020,2,1)));
+    const auto february = to_strings(cache.occurrences("source", icc, zone, utc(2020,2,1), utc(2020,3,1)));
+    EXPECT_EQ(5u, january.size());
+    EXPECT_EQ(4u, february.size());
+    EXPECT_EQ("20200205T090000Z", february.front());
+
+    // going back to an earlier window gives the same answer
+    EXPECT_EQ(january, to_strings(cache.occurrences("source", icc, zone, utc(2020,1,1), utc(2020,2,1))));
+
+    // an occurrence that's still running when the window opens is included
+    const auto overlap = to_strings(cache.occurrences("source", icc, zone, utc(2020,1,1,9), utc(2020,1,1,12)));
+    EXPECT_EQ(std::vector<std::string>{"20200101T090000Z"}, overlap);
+}
+
+TEST_F(RecurrenceCacheFixture, ChangedSeriesAreRebuilt)
+{
+    RecurrenceCache cache;
+    const auto zone = icaltimezone_get_utc_timezone();
+
+    auto before = parse("DTSTART:20200101T090000Z\r\n"
+                        "RRULE:FREQ=DAILY;COUNT=3\r\n");
+    EXPECT_EQ(3u, cache.occurrences("source", before, zone, utc(2020,1,1), utc(2020,2,1)).size());
+
+    auto after = parse("DTSTART:20200101T090000Z\r\n"
+                       "RRULE:FREQ=DAILY;COUNT=2\r\n");
+    EXPECT_EQ(2u, cache.occurrences("source", after, zone, utc(2020,1,1), utc(2020,2,1)).size());
+
+    cache.retain("source", [](const std::string&){return false;});
+    EXPECT_EQ(2u, cache.occurrences("source", after, zone, utc(2020,1,1), utc(2020,2,1)).size());
+}
+
+TEST_F(RecurrenceCacheFixture, EditStampsAreTheFingerprint)
+{
+    RecurrenceCache cache;
+    const auto zone = icaltimezone_get_utc_timezone();
+
+    auto v1 = parse("DTSTART:20200101T090000Z\r\n"
+                    "LAST-MODIFIED:20200101T000000Z\r\n"
+                    "RRULE:FREQ=DAILY;COUNT=3\r\n");
+    EXPECT_EQ(3u, cache.occurrences("source", v1, zone, utc(2020,1,1), utc(2020,2,1)).size());
+
+    // the component isn't compared, just the stamps that editors bump
+    auto unstamped = parse("DTSTART:20200101T090000Z\r\n"
+                           "LAST-MODIFIED:20200101T000000Z\r\n"
+                           "RRULE:FREQ=DAILY;COUNT=2\r\n");
+    EXPECT_EQ(3u, cache.occurrences("source", unstamped, zone, utc(2020,1,1), utc(2020,2,1)).size());
+
+    auto v2 = parse("DTSTART:20200101T090000Z\r\n"
+                    "LAST-MODIFIED:20200101T000000Z\r\n"
+                    "SEQUENCE:1\r\n"
+                    "RRULE:FREQ=DAILY;COUNT=2\r\n");
+    EXPECT_EQ(2u, cache.occurrences("source", v2, zone, utc(2020,1,1), utc(2020,2,1)).size());
+
+    auto v3 = parse("DTSTART:20200101T090000Z\r\n"
+                    "LAST-MODIFIED:20200102T000000Z\r\n"
+                    "SEQUENCE:1\r\n"
+                    "RRULE:FREQ=DAILY;COUNT=4\r\n");
+    EXPECT_EQ(4u, cache.occurrences("source", v3, zone, utc(2020,1,1), utc(2020,2,1)).size());
+}
+
+TEST_F(RecurrenceCacheFixture, EndedSeriesAreSkipped)
+{
+    RecurrenceCache cache;
+    const auto zone = icaltimezone_get_utc_timezone();
+
+    auto until = parse("DTSTART:20190101T090000Z\r\n"
+                       "RRULE:FREQ=DAILY;UNTIL=20190201T090000Z\r\n", "until");
+    EXPECT_TRUE(cache.occurrences("source", until, zone, utc(2020,1,1), utc(2020,2,1)).empty());
+    EXPECT_EQ(1u, cache.occurrences("source", until, zone, utc(2019,2,1), utc(2019,2,2)).size());
+
+    auto count = parse("DTSTART:20200101T090000Z\r\n"
+                       "RRULE:FREQ=DAILY;COUNT=3\r\n", "count");
+    EXPECT_EQ(3u, cache.occurrences("source", count, zone, utc(2020,1,1), utc(2020,2,1)).size());
+    EXPECT_TRUE(cache.occurrences("source", count, zone, utc(2020,6,1), utc(2020,7,1)).empty());
+    EXPECT_TRUE(cache.occurrences("source", count, zone, utc(2020,7,1), utc(2020,8,1)).empty());
+}
+
+TEST_F(RecurrenceCacheFixture, AllDaySeries)
+{
+    auto icc = parse("DTSTART;VALUE=DATE:20200101\r\n"
+                     "DTEND;VALUE=DATE:20200102\r\n"
+                     "RRULE:FREQ=MONTHLY;COUNT=3\r\n");
+
+    RecurrenceCache cache;
+    const auto zone = icaltimezone_get_utc_timezone();
+    const auto occurrences = cache.occurrences("source", icc, zone, utc(2020,1,1), utc(2021,1,1));
+    const std::vector<std::string> expected = { "20200101", "20200201", "20200301" };
+    EXPECT_EQ(expected, to_strings(occurrences));
+    ASSERT_FALSE(occurrences.empty());
+    EXPECT_STREQ("20200102", icaltime_as_ical_string(occurrences.front().end));
+}
+
+TEST_F(RecurrenceCacheFixture, OldBusySeriesStillFillLaterWindows)
+{
+    // more occurrences between DTSTART and the window than one window may hold
+    auto icc = parse("DTSTART:20000101T000000Z\r\n"
+                     "RRULE:FREQ=HOURLY\r\n");
+
+    RecurrenceCache cache;
+    const auto zone = icaltimezone_get_utc_timezone();
+    const auto january = cache.occurrences("source", icc, zone, utc(2020,1,1), utc(2020,2,1));
+    EXPECT_EQ(31u*24u, january.size());
+    const auto february = cache.occurrences("source", icc, zone, utc(2020,2,1), utc(2020,3,1));
+    EXPECT_EQ(29u*24u, february.size());
+    ASSERT_FALSE(february.empty());
+    EXPECT_STREQ("20200201T000000Z", icaltime_as_ical_string(february.front().begin));
+}
+
+TEST_F(RecurrenceCacheFixture, ForgottenWindowsAreWalkedAgain)
+{
+    auto icc = parse("DTSTART:20200101T090000Z\r\n"
+                     "RRULE:FREQ=DAILY\r\n");
+
+    RecurrenceCache cache;
+    const auto zone = icaltimezone_get_utc_timezone();
+    const auto january = to_strings(cache.occurrences("source", icc, zone, utc(2020,1,1), utc(2020,2,1)));
+    EXPECT_EQ(31u, january.size());
+
+    // move ahead far enough for january's occurrences to be dropped...
+    for (int month=2; month<=12; ++month)
+        EXPECT_FALSE(cache.occurrences("source", icc, zone, utc(2020,month,1), utc(2020,month,28)).empty());
+
+    // ...then go back to it
+    EXPECT_EQ(january, to_strings(cache.occurrences("source", icc, zone, utc(2020,1,1), utc(2020,2,1))));
+}
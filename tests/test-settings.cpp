@@ -22,6 +22,10 @@
 #include <datetime/settings-live.h>
 #include <datetime/settings-shared.h>
 
+#include <set>
+#include <string>
+#include <vector>
+
 using namespace unity::indicator::datetime;
 
 /***
@@ -239,3 +243,40 @@ TEST_F(SettingsFixture, MutedApps)
     TestBoolProperty(m_gsettings_cal_notification, m_settings->cal_notification_bubbles, SETTINGS_NOTIFY_BUBBLES_KEY);
     TestBoolProperty(m_gsettings_cal_notification, m_settings->cal_notification_list, SETTINGS_NOTIFY_LIST_KEY);
 }
+
+TEST_F(SettingsFixture, ChangedKeysAreBatched)
+{
+    std::vector<std::set<std::string>> emitted;
+    m_settings->changed_keys.connect([&emitted](const std::set<std::string>& keys){
+        emitted.push_back(keys);
+    });
+
+    // a delayed-apply batch in GSettings arrives as a single change-event
+    const bool show_day = m_settings->show_day.get();
+    const bool show_date = m_settings->show_date.get();
+    g_settings_delay(m_gsettings);
+    g_settings_set_boolean(m_gsettings, SETTINGS_SHOW_DAY_S, !show_day);
+    g_settings_set_boolean(m_gsettings, SETTINGS_SHOW_DATE_S, !show_date);
+    g_settings_apply(m_gsettings);
+    EXPECT_EQ(!show_day, m_settings->show_day.get());
+    EXPECT_EQ(!show_date, m_settings->show_date.get());
+    ASSERT_EQ(1u, emitted.size());
+    EXPECT_EQ(std::set<std::string>({SETTINGS_SHOW_DAY_S, SETTINGS_SHOW_DATE_S}), emitted[0]);
+
+    // so does a transaction on the Settings side
+    emitted.clear();
+    {
+        Settings::Transaction transaction(*m_settings);
+        m_settings->show_year.set(!m_settings->show_year.get());
+        m_settings->show_seconds.set(!m_settings->show_seconds.get());
+        EXPECT_TRUE(emitted.empty());
+    }
+    ASSERT_EQ(1u, emitted.size());
+    EXPECT_EQ(std::set<std::string>({SETTINGS_SHOW_YEAR_S, SETTINGS_SHOW_SECONDS_S}), emitted[0]);
+
+    // a change outside of a transaction is emitted right away
+    emitted.clear();
+    m_settings->show_clock.set(!m_settings->show_clock.get());
+    ASSERT_EQ(1u, emitted.size());
+    EXPECT_EQ(std::set<std::string>({SETTINGS_SHOW_CLOCK_S}), emitted[0]);
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+#include <datetime/date-time.h>
+#include <datetime/timezone-registry.h>
+
+#include "glib-fixture.h"
+
+using namespace unity::indicator::datetime;
+
+/***
+****
+***/
+
+typedef GlibFixture TimezoneRegistryFixture;
+
+TEST_F(TimezoneRegistryFixture, ZonesAreInterned)
+{
+    auto& registry = TimezoneRegistry::instance();
+
+    auto a = registry.get("America/Chicago");
+    auto b = registry.get("America/Chicago");
+    auto c = registry.get("Europe/Berlin");
+    EXPECT_EQ(a.get(), b.get());
+    EXPECT_NE(a.get(), c.get());
+
+    // zones handed out before a flush must remain usable
+    registry.clear();
+    auto d = registry.get("America/Chicago");
+    const auto now = DateTime::NowLocal();
+    EXPECT_EQ(DateTime(a.get(), now.to_unix()).format("%F %T %z"),
+              DateTime(d.get(), now.to_unix()).format("%F %T %z"));
+}
+
+TEST_F(TimezoneRegistryFixture, NextTransition)
+{
+    auto& registry = TimezoneRegistry::instance();
+
+    // America/Chicago went from CST to CDT at 2020-03-08 08:00:00 UTC
+    const int64_t new_years = 1577836800; // 2020-01-01 00:00:00 UTC
+    const auto t = registry.next_transition("America/Chicago", new_years);
+    auto gdt = g_date_time_new_from_unix_utc(t);
+    auto str = g_date_time_format(gdt, "%F %T");
+    EXPECT_STREQ("2020-03-08 08:00:00", str);
+    g_free(str);
+    g_date_time_unref(gdt);
+
+    // ...and back again at 2020-11-01 07:00:00 UTC
+    const auto t2 = registry.next_transition("America/Chicago", t);
+    EXPECT_EQ(int64_t(1604214000), t2);
+
+    // UTC never changes
+    EXPECT_EQ(0, registry.next_transition("UTC", new_years));
+}
+
+TEST_F(TimezoneRegistryFixture, NextTransitionNearTheEndOfTheTable)
+{
+    auto& registry = TimezoneRegistry::instance();
+    registry.clear();
+
+    // build the table on new year's day, then ask about new year's eve:
+    // the answer is in the following spring, not "no transition"
+    const int64_t new_years = 1577836800; // 2020-01-01 00:00:00 UTC
+    const int64_t new_years_eve = 1609372800; // 2020-12-31 00:00:00 UTC
+    EXPECT_EQ(int64_t(1583654400), registry.next_transition("America/Chicago", new_years));
+    EXPECT_EQ(int64_t(1615708800), registry.next_transition("America/Chicago", new_years_eve));
+}
@@ -0,0 +1,252 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+
+#include <datetime/clock-mock.h>
+#include <datetime/wakeup-timer-auto.h>
+#include <datetime/wakeup-timer-mainloop.h>
+#include <datetime/wakeup-timer-powerd.h>
+
+#include <bus/bus-registry.h>
+#include <notifications/dbus-shared.h>
+
+#include "libdbusmock-fixture.h"
+
+using namespace unity::indicator::datetime;
+namespace uin = unity::indicator::notifications;
+
+/***
+****
+***/
+
+class PowerdWakeupTimerFixture: public LibdbusmockFixture
+{
+private:
+
+  typedef LibdbusmockFixture super;
+
+protected:
+
+  static constexpr char const * METHOD_REQUEST_WAKEUP {"requestWakeup"};
+  static constexpr char const * METHOD_CLEAR_WAKEUP {"clearWakeup"};
+  static constexpr char const * METHOD_REQUEST_SYS_STATE {"requestSysState"};
+  static constexpr char const * METHOD_CLEAR_SYS_STATE {"clearSysState"};
+
+  DbusTestDbusMock * powerd_mock = nullptr;
+  DbusTestDbusMockObject * powerd_obj = nullptr;
+  std::shared_ptr<MockClock> clock;
+  std::shared_ptr<unity::indicator::bus::BusRegistry> buses;
+
+  void SetUp() override
+  {
+    GError * error = nullptr;
+
+    super::SetUp();
+
+    powerd_mock = dbus_test_dbus_mock_new(BUS_POWERD_NAME);
+    powerd_obj = dbus_test_dbus_mock_get_object(powerd_mock,
+                                                BUS_POWERD_PATH,
+                                                BUS_POWERD_INTERFACE,
+                                                &error);
+    g_assert_no_error(error);
+
+    // hand out a different cookie for each wakeup time
+    dbus_test_dbus_mock_object_add_method(powerd_mock,
+                                          powerd_obj,
+                                          METHOD_REQUEST_WAKEUP,
+                                          G_VARIANT_TYPE("(st)"),
+                                          G_VARIANT_TYPE("(s)"),
+                                          "ret = 'cookie-%d' % args[1]",
+                                          &error);
+    g_assert_no_error(error);
+
+    dbus_test_dbus_mock_object_add_method(powerd_mock,
+                                          powerd_obj,
+                                          METHOD_CLEAR_WAKEUP,
+                                          G_VARIANT_TYPE("(s)"),
+                                          nullptr,
+                                          "",
+                                          &error);
+    g_assert_no_error(error);
+
+    dbus_test_dbus_mock_object_add_method(powerd_mock,
+                                          powerd_obj,
+                                          METHOD_REQUEST_SYS_STATE,
+                                          G_VARIANT_TYPE("(si)"),
+                                          G_VARIANT_TYPE("(s)"),
+                                          "ret = 'awake'",
+                                          &error);
+    g_assert_no_error(error);
+
+    dbus_test_dbus_mock_object_add_method(powerd_mock,
+                                          powerd_obj,
+                                          METHOD_CLEAR_SYS_STATE,
+                                          G_VARIANT_TYPE("(s)"),
+                                          nullptr,
+                                          "",
+                                          &error);
+    g_assert_no_error(error);
+
+    dbus_test_service_add_task(service, DBUS_TEST_TASK(powerd_mock));
+    startDbusMock();
+
+    clock = std::make_shared<MockClock>(DateTime::NowLocal());
+    buses = std::make_shared<unity::indicator::bus::BusRegistry>(system_bus, session_bus);
+  }
+
+  void TearDown() override
+  {
+    buses.reset();
+    clock.reset();
+    g_clear_object(&powerd_mock);
+
+    super::TearDown();
+  }
+
+  guint count_calls(const gchar* method)
+  {
+    GError * error = nullptr;
+    guint n = 0;
+    dbus_test_dbus_mock_object_get_method_calls(powerd_mock, powerd_obj, method, &n, &error);
+    g_assert_no_error(error);
+    return n;
+  }
+
+  void emit_wakeup()
+  {
+    // ask dbusmock to broadcast powerd's Wakeup signal
+    GError * error = nullptr;
+    auto ret = g_dbus_connection_call_sync(session_bus,
+                                           BUS_POWERD_NAME,
+                                           BUS_POWERD_PATH,
+                                           "org.freedesktop.DBus.Mock",
+                                           "EmitSignal",
+                                           g_variant_new("(sss@av)",
+                                                         BUS_POWERD_INTERFACE,
+                                                         "Wakeup",
+                                                         "",
+                                                         g_variant_new_array(G_VARIANT_TYPE_VARIANT, nullptr, 0)),
+                                           nullptr,
+                                           G_DBUS_CALL_FLAGS_NONE,
+                                           -1,
+                                           nullptr,
+                                           &error);
+    g_assert_no_error(error);
+    g_clear_pointer(&ret, g_variant_unref);
+  }
+};
+
+/***
+****
+***/
+
+TEST_F(PowerdWakeupTimerFixture, IdenticalRequestsAreSkipped)
+{
+  PowerdWakeupTimer timer(clock, buses);
+
+  const auto t = clock->localtime().add_full(0,0,0,1,0,0);
+  for (int i=0; i<5; ++i)
+    timer.set_wakeup_time(t);
+
+  EXPECT_METHOD_CALLED_EVENTUALLY(powerd_mock, powerd_obj, METHOD_REQUEST_WAKEUP);
+  wait_msec(200);
+  EXPECT_EQ(1u, count_calls(METHOD_REQUEST_WAKEUP));
+  EXPECT_EQ(0u, count_calls(METHOD_CLEAR_WAKEUP));
+}
+
+TEST_F(PowerdWakeupTimerFixture, CookiesAreReplacedAtomically)
+{
+  PowerdWakeupTimer timer(clock, buses);
+
+  const auto a = clock->localtime().add_full(0,0,0,1,0,0);
+  timer.set_wakeup_time(a);
+  EXPECT_METHOD_CALLED_EVENTUALLY(powerd_mock, powerd_obj, METHOD_REQUEST_WAKEUP);
+  wait_msec(200);
+
+  const auto b = clock->localtime().add_full(0,0,0,2,0,0);
+  timer.set_wakeup_time(b);
+  auto cookie = g_strdup_printf("cookie-%d", int(a.to_unix()));
+  EXPECT_METHOD_CALLED_EVENTUALLY(powerd_mock, powerd_obj, METHOD_CLEAR_WAKEUP, g_variant_new("(s)", cookie));
+  g_free(cookie);
+
+  // the old cookie wasn't cleared until the new one was requested
+  GError * error = nullptr;
+  guint n_requests = 0;
+  guint n_clears = 0;
+  const auto requests = dbus_test_dbus_mock_object_get_method_calls(powerd_mock, powerd_obj, METHOD_REQUEST_WAKEUP, &n_requests, &error);
+  const auto clears = dbus_test_dbus_mock_object_get_method_calls(powerd_mock, powerd_obj, METHOD_CLEAR_WAKEUP, &n_clears, &error);
+  g_assert_no_error(error);
+  ASSERT_EQ(2u, n_requests);
+  ASSERT_EQ(1u, n_clears);
+  EXPECT_LE(requests[1].timestamp, clears[0].timestamp);
+}
+
+TEST_F(PowerdWakeupTimerFixture, NearbyWakeupsAreCoalesced)
+{
+  PowerdWakeupTimer timer(clock, buses, 60);
+
+  const auto t = clock->localtime().add_full(0,0,0,1,0,0);
+  timer.set_wakeup_time(t);
+  timer.set_wakeup_time(t.add_full(0,0,0,0,0,30));
+  EXPECT_METHOD_CALLED_EVENTUALLY(powerd_mock, powerd_obj, METHOD_REQUEST_WAKEUP);
+  wait_msec(200);
+  EXPECT_EQ(1u, count_calls(METHOD_REQUEST_WAKEUP));
+
+  // outside of the slack, we need another wakeup
+  timer.set_wakeup_time(t.add_full(0,0,0,0,2,0));
+  wait_for([this](){return count_calls(METHOD_REQUEST_WAKEUP) > 1;});
+  EXPECT_EQ(2u, count_calls(METHOD_REQUEST_WAKEUP));
+}
+
+TEST_F(PowerdWakeupTimerFixture, CoalescedWakeupStaysAwake)
+{
+  PowerdWakeupTimer timer(clock, buses, 60);
+  bool timed_out = false;
+  timer.timeout().connect([&timed_out](){timed_out = true;});
+
+  const auto hw_time = clock->localtime().add_full(0,0,0,1,0,0);
+  timer.set_wakeup_time(hw_time);
+  timer.set_wakeup_time(hw_time.add_full(0,0,0,0,0,1));
+  EXPECT_METHOD_CALLED_EVENTUALLY(powerd_mock, powerd_obj, METHOD_REQUEST_WAKEUP);
+  EXPECT_EQ(0u, timer.hardware_wakeups_per_day());
+
+  // the hardware wakes up a second before the real wakeup time,
+  // so the timer should keep the system awake until then
+  clock->set_localtime_quietly(hw_time);
+  emit_wakeup();
+  EXPECT_METHOD_CALLED_EVENTUALLY(powerd_mock, powerd_obj, METHOD_REQUEST_SYS_STATE);
+  EXPECT_FALSE(timed_out);
+  EXPECT_TRUE(wait_for([&timed_out](){return timed_out;}, 3000));
+  EXPECT_METHOD_CALLED_EVENTUALLY(powerd_mock, powerd_obj, METHOD_CLEAR_SYS_STATE);
+  EXPECT_EQ(1u, timer.hardware_wakeups_per_day());
+  EXPECT_EQ(1u, count_calls(METHOD_REQUEST_WAKEUP));
+}
+
+TEST_F(PowerdWakeupTimerFixture, AutoTimerSwitchesToPowerd)
+{
+  auto fallback = std::make_shared<MainloopWakeupTimer>(clock);
+  AutoWakeupTimer timer(clock, buses, fallback);
+
+  // a wakeup time set before powerd is found is carried over to it
+  const auto t = clock->localtime().add_full(0,0,0,1,0,0);
+  timer.set_wakeup_time(t);
+  EXPECT_TRUE(wait_for([&timer](){return timer.uses_powerd();}, 2000));
+  EXPECT_METHOD_CALLED_EVENTUALLY(powerd_mock, powerd_obj, METHOD_REQUEST_WAKEUP);
+  EXPECT_EQ(1u, count_calls(METHOD_REQUEST_WAKEUP));
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *   Charles Kerr <charles.kerr@canonical.com>
+ */
+
+
+#include <datetime/wakeup-timer-timerfd.h>
+
+#include "glib-fixture.h"
+
+using namespace unity::indicator::datetime;
+
+/***
+****
+***/
+
+typedef GlibFixture TimerfdWakeupTimerFixture;
+
+TEST_F(TimerfdWakeupTimerFixture, FiresAtAbsoluteTime)
+{
+    if (!TimerfdWakeupTimer::is_supported())
+        return;
+
+    TimerfdWakeupTimer timer;
+    int64_t fired_at = 0;
+    timer.timeout().connect([&fired_at](){fired_at = g_get_real_time();});
+
+    const auto wakeup_time = DateTime::NowLocal().add_full(0,0,0,0,0,1);
+    timer.set_wakeup_time(wakeup_time);
+    EXPECT_TRUE(wait_for([&fired_at](){return fired_at != 0;}, 3000));
+    EXPECT_LE(wakeup_time.to_unix(), fired_at / G_USEC_PER_SEC);
+}
+
+TEST_F(TimerfdWakeupTimerFixture, PastTimesFireRightAway)
+{
+    if (!TimerfdWakeupTimer::is_supported())
+        return;
+
+    TimerfdWakeupTimer timer;
+    bool fired = false;
+    timer.timeout().connect([&fired](){fired = true;});
+
+    timer.set_wakeup_time(DateTime::NowLocal().add_full(0,0,0,0,-1,0));
+    EXPECT_TRUE(wait_for([&fired](){return fired;}, 1000));
+}
+
+TEST_F(TimerfdWakeupTimerFixture, UnsetDisarms)
+{
+    if (!TimerfdWakeupTimer::is_supported())
+        return;
+
+    TimerfdWakeupTimer timer;
+    bool fired = false;
+    timer.timeout().connect([&fired](){fired = true;});
+
+    timer.set_wakeup_time(DateTime::NowLocal().add_full(0,0,0,0,0,1));
+    timer.set_wakeup_time(DateTime());
+    wait_msec(1500);
+    EXPECT_FALSE(fired);
+}